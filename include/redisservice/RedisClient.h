@@ -5,6 +5,10 @@
 
 (C) 2016 n.lee
 */
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 #include "io/RedisClientTrunkQueue.hpp"
 #include "io/KjRedisClientWorkQueue.hpp"
 
@@ -13,6 +17,14 @@
 //------------------------------------------------------------------------------
 /**
 @brief CRedisClient
+
+//!
+//! commands are built into a buffer of the calling thread, so any thread may build and commit
+//! pipelines, reply callbacks always run in RunOnce()
+//!
+//! auto-pipelining ("_bAutoPipeline"): commits on the main thread wait in the batch of their pipe
+//! worker and go as one pipeline, RunOnce() sends what is left at the end of the frame
+//!
 */
 class MY_REDIS_EXTERN  CRedisClient : public IRedisClient {
 public:
@@ -21,206 +33,283 @@ public:
 
 public:
 	virtual void				RunOnce() override {
-		_trunkQueue->RunOnce();
+		for (auto& slot : _vWorkerSlot) {
+			slot._trunkQueue->RunOnce();
+		}
+
+		// commits of this frame, callbacks above included
+		if (_nAutoCommitNum > 0)
+			FlushAutoPipeline();
 	}
+
+	//! send the auto-pipelining batches now, main thread only
+	void						FlushAutoPipeline();
 	
-	virtual void				Commit(redis_reply_cb_t&& rcb) override;
-	virtual CRedisReply			BlockingCommit() override;
+	virtual void				Commit(redis_reply_cb_t&& rcb, uint32_t uCaller = 0) override;
+	virtual CRedisReply			BlockingCommit(uint32_t uCaller = 0) override {
+		return BeginBlockingCommit(uCaller)();
+	}
+
+	virtual blocking_wait_t		BeginBlockingCommit(uint32_t uCaller = 0) override;
+	virtual CRedisFuture		AsyncCommit(uint32_t uCaller = 0) override;
+
+	virtual void				ReadFromReplica() override {
+		LocalCommandBuffer()._bReplica = true;
+	}
+
+	virtual void				SetDeadline(uint32_t uTimeoutMs) override {
+		LocalCommandBuffer()._timeoutMs = uTimeoutMs;
+	}
+
+	virtual void				StreamReply(redis_element_cb_t&& visitor) override {
+		LocalCommandBuffer()._elementCb = std::move(visitor);
+	}
+
+	virtual void				StreamBulkString(redis_bulk_chunk_cb_t&& sink) override {
+		LocalCommandBuffer()._chunkCb = std::move(sink);
+	}
+
+	virtual void				GetStats(redis_client_stats_t& stats) override;
 
 	virtual void				Watch(const std::string& key) override {
-		BuildCommand({ "WATCH", key });
+		EncodeCommand("WATCH", key);
 	}
 
 	virtual void				Multi() override {
-		BuildCommand({ "MULTI" });
+		EncodeCommand("MULTI");
 	}
 
 	virtual void				Exec() override {
-		BuildCommand({ "EXEC" });
+		EncodeCommand("EXEC");
 	}
 
 	virtual void				Dump(const std::string& key) override {
-		BuildCommand({ "DUMP", key });
+		EncodeReadOnlyCommand("DUMP", key);
 	}
 
 	virtual void				Restore(const std::string& key, std::string& val) override {
-		BuildCommand({ "RESTORE", key, std::move(val) });
+		EncodeCommand("RESTORE", key, val);
 	}
 
 	virtual void				Set(const std::string& key, std::string& val) override {
-		BuildCommand({ "SET", key, std::move(val) });
+		EncodeCommand("SET", key, val);
 	}
 
 	virtual void				Get(const std::string& key) override {
-		BuildCommand({ "GET", key });
+		EncodeReadOnlyCommand("GET", key);
 	}
 
 	virtual void				GetSet(const std::string& key, std::string& val) override {
-		BuildCommand({ "GETSET", key, std::move(val) });
+		EncodeCommand("GETSET", key, val);
 	}
 
 	virtual void				Del(const std::vector<std::string>& vKey) override {
-		std::vector<std::string> vPiece(1 + vKey.size());
-		vPiece.assign({ std::string("DEL") });
-		vPiece.insert(vPiece.end(), vKey.begin(), vKey.end());
-		BuildCommand(vPiece);
+		EncodeCommand("DEL", vKey);
 	}
 
 	virtual void				LPush(const std::string& key, std::vector<std::string>& vVal) override {
-		std::vector<std::string> vPiece(2 + vVal.size());
-		vPiece.assign({ std::string("LPUSH"), key });
-		vPiece.insert(vPiece.end(), vVal.begin(), vVal.end());
-		BuildCommand(vPiece);
+		EncodeCommand("LPUSH", key, vVal);
 	}
 
 	virtual void				RPush(const std::string& key, std::vector<std::string>& vVal) override {
-		std::vector<std::string> vPiece(2 + vVal.size());
-		vPiece.assign({ "RPUSH", key });
-		vPiece.insert(vPiece.end(), vVal.begin(), vVal.end());
-		BuildCommand(vPiece);
+		EncodeCommand("RPUSH", key, vVal);
 	}
 
 	virtual void				LPop(const std::string& key) override {
-		BuildCommand({ "LPOP", key });
+		EncodeCommand("LPOP", key);
 	}
 
 	virtual void				RPop(const std::string& key) override {
-		BuildCommand({ "RPOP", key });
+		EncodeCommand("RPOP", key);
 	}
 
 	virtual void				LLen(const std::string& key) override {
-		BuildCommand({ "LLEN", key });
+		EncodeReadOnlyCommand("LLEN", key);
 	}
 
 	virtual void				LIndex(const std::string& key, int nIndex) override {
-		BuildCommand({ "LINDEX", key, std::to_string(nIndex) });
+		EncodeReadOnlyCommand("LINDEX", key, nIndex);
 	}
 
 	virtual void				LRange(const std::string& key, int nStart, int nStop) override {
-		BuildCommand({ "LRANGE", key, std::to_string(nStart), std::to_string(nStop) });
+		EncodeReadOnlyCommand("LRANGE", key, nStart, nStop);
 	}
 
 	virtual void				LTrim(const std::string& key, int nStart, int nStop) override {
-		BuildCommand({ "LTRIM", key, std::to_string(nStart), std::to_string(nStop) });
+		EncodeCommand("LTRIM", key, nStart, nStop);
 	}
 
 	virtual void				HKeys(const std::string& key) override {
-		BuildCommand({ "HKEYS", key });
+		EncodeReadOnlyCommand("HKEYS", key);
 	}
 
 	virtual void				HVals(const std::string& key) override {
-		BuildCommand({ "HVals", key });
+		EncodeReadOnlyCommand("HVals", key);
 	}
 
 	virtual void				HDel(const std::string& key, const std::vector<std::string>& vField) override {
-		std::vector<std::string> vPiece(2 + vField.size());
-		vPiece.assign({ "HDEL", key });
-		vPiece.insert(vPiece.end(), vField.begin(), vField.end());
-		BuildCommand(vPiece);
+		EncodeCommand("HDEL", key, vField);
 	}
 
 	virtual void				HGetAll(const std::string& key) override {
-		BuildCommand({ "HGETALL", key });
+		EncodeReadOnlyCommand("HGETALL", key);
 	}
 
 	virtual void				HGet(const std::string& key, const std::string& field) override {
-		BuildCommand({ "HGET", key, field });
+		EncodeReadOnlyCommand("HGET", key, field);
 	}
 
 	virtual void				HSet(const std::string& key, const std::string& field, std::string& val) override {
-		BuildCommand({ "HSET", key, field, std::move(val) });
+		EncodeCommand("HSET", key, field, val);
 	}
 
 	virtual void				ZAdd(const std::string& key, std::string& score, std::string& member) override {
-		BuildCommand({ "ZADD", key, score, member });
+		EncodeCommand("ZADD", key, score, member);
 	}
 
 	virtual void				ZRem(const std::string& key, std::vector<std::string>& vMember) override {
-		std::vector<std::string> vPiece(2 + vMember.size());
-		vPiece.assign({ "ZREM", key });
-		vPiece.insert(vPiece.end(), vMember.begin(), vMember.end());
-		BuildCommand(vPiece);
+		EncodeCommand("ZREM", key, vMember);
 	}
 
 	virtual void				ZScore(const std::string& key, std::string& member) override {
-		BuildCommand({ "ZSCORE", key, member });
+		EncodeReadOnlyCommand("ZSCORE", key, member);
 	}
 
 	virtual void				ZRange(const std::string& key, std::string& start, std::string& stop, bool bWithScores = false) override {
 		if (bWithScores) {
-			BuildCommand({ "ZRANGE", key, start, stop, "WITHSCORES" });
+			EncodeReadOnlyCommand("ZRANGE", key, start, stop, "WITHSCORES");
 		}
 		else {
-			BuildCommand({ "ZRANGE", key, start, stop });
+			EncodeReadOnlyCommand("ZRANGE", key, start, stop);
 		}
 	}
 
 	virtual void				ZRank(const std::string& key, std::string& member) override {
-		BuildCommand({ "ZRANK", key, member });
+		EncodeReadOnlyCommand("ZRANK", key, member);
 	}
 
 	virtual void				SAdd(const std::string& key, std::vector<std::string>& vMember) override {
-		std::vector<std::string> vPiece(2 + vMember.size());
-		vPiece.assign({ "SADD", key });
-		vPiece.insert(vPiece.end(), vMember.begin(), vMember.end());
-		BuildCommand(vPiece);
+		EncodeCommand("SADD", key, vMember);
 	}
 
 	virtual void				SMembers(const std::string& key) override {
-		BuildCommand({ "SMEMBERS", key });
+		EncodeReadOnlyCommand("SMEMBERS", key);
 	}
 
 	virtual void				ScriptLoad(const std::string& script) override {
-		BuildCommand({ "SCRIPT", "LOAD", script });
+		EncodeCommand("SCRIPT", "LOAD", script);
 	}
 
 	virtual void				Eval(const std::string& script, const std::vector<std::string>& vKey, std::vector<std::string>& vArg) override {
-		size_t szNumKeys = vKey.size();
-		size_t szNumArgs = vArg.size();
-		std::vector<std::string> vPiece(3 + szNumKeys + szNumArgs);
-		vPiece.assign({ "EVAL", script, std::to_string(szNumKeys) });
-		vPiece.insert(vPiece.end(), vKey.begin(), vKey.end());
-		vPiece.insert(vPiece.end(), vArg.begin(), vArg.end());
-		BuildCommand(vPiece);
+		EncodeCommand("EVAL", script, vKey.size(), vKey, vArg);
 	}
 
 	virtual void				EvalSha(const std::string& sha, const std::vector<std::string>& vKey, std::vector<std::string>& vArg) override {
-		size_t szNumKeys = vKey.size();
-		size_t szNumArgs = vArg.size();
-		std::vector<std::string> vPiece(3 + szNumKeys + szNumArgs);
-		vPiece.assign({ "EVALSHA", sha, std::to_string(szNumKeys) });
-		vPiece.insert(vPiece.end(), vKey.begin(), vKey.end());
-		vPiece.insert(vPiece.end(), vArg.begin(), vArg.end());
-		BuildCommand(vPiece);
+		EncodeCommand("EVALSHA", sha, vKey.size(), vKey, vArg);
 	}
 
 	virtual void				Shutdown() override;
 
+	//! blocking commits issued on the thread which created the client (counted in _DEBUG only),
+	//! each one stalls RunOnce() for a full round trip
+	uint64_t					BlockingOnMainThreadCount() const {
+		return _nBlockingOnMainThread;
+	}
+
 private:
-	void						BuildCommand(const std::vector<std::string>& vPiece) {
-		CRedisCommandBuilder::Build(vPiece, _singleCommand, _allCommands, _builtNum);
-		_singleCommand.resize(0);
+	template<typename... Args>
+	void						EncodeCommand(const Args&... args) {
+		command_buffer_t& buf = LocalCommandBuffer();
+		CRedisCommandBuilder::Encode(buf._allCommands, buf._builtNum, args...);
+		buf._bReadOnly = false;
+	}
+
+	//! commands a replica can serve
+	template<typename... Args>
+	void						EncodeReadOnlyCommand(const Args&... args) {
+		command_buffer_t& buf = LocalCommandBuffer();
+		CRedisCommandBuilder::Encode(buf._allCommands, buf._builtNum, args...);
 	}
 
 	void						StartPipeWorker();
 
 public:
+	//! merged pipelines of the main thread go by lanes, one per pool connection of the pipe worker. A
+	//! caller always takes the same lane, so its commits stay in order, and each lane is routed on its
+	//! own as caller id "AUTO_PIPELINE_CALLER - lane"
+	static const uint32_t AUTO_PIPELINE_CALLER = 0xffffffff;
+
+	//! commits of the main thread merged for one pipe worker, see "_bAutoPipeline"
+	struct auto_batch_t {
+		std::string _allCommands;
+		int _builtNum = 0;
+		std::vector<int> _vEnd;				// command num at the end of each commit
+		std::vector<redis_reply_cb_t> _vReplyCb;
+	};
+
+	//! pipe worker thread with its own work queue and trunk queue
+	struct worker_slot_t {
+		CRedisClientTrunkQueuePtr _trunkQueue;
+		CKjRedisClientWorkQueuePtr _workQueue;
+		std::vector<auto_batch_t> _vAutoBatch;
+	};
+
+	//! per-thread command building buffer
+	struct command_buffer_t {
+		std::string _allCommands;
+		int _builtNum = 0;
+		bool _bReadOnly = true;
+		bool _bReplica = false;
+		uint32_t _timeoutMs = 0;
+		redis_element_cb_t _elementCb;
+		redis_bulk_chunk_cb_t _chunkCb;
+	};
+
+	command_buffer_t&			LocalCommandBuffer();
+
+	//! replica routing, deadline and streaming of the pipeline built in "buf", the flags are reset for the next one
+	void						TakePipelineFlags(command_buffer_t& buf, redis_cmd_pipepline_t& cp) {
+		cp._replica = buf._bReplica && buf._bReadOnly && !_refParam._vReplica.empty();
+		cp._timeout_ms = (buf._timeoutMs > 0) ? buf._timeoutMs : _refParam._nPipelineTimeoutMs;
+		cp._element_cb = std::move(buf._elementCb);
+		cp._chunk_cb = std::move(buf._chunkCb);
+		buf._bReplica = false;
+		buf._bReadOnly = true;
+		buf._timeoutMs = 0;
+	}
+
+	worker_slot_t&				WorkerSlot(uint32_t uCaller) {
+		// the same caller always goes through the same pipe worker
+		return _vWorkerSlot[uCaller % _vWorkerSlot.size()];
+	}
+
+	size_t						AutoLane(const worker_slot_t& slot, uint32_t uCaller) const {
+		// callers of one pipe worker share "uCaller % worker num", spread them by the rest
+		return (uCaller / _vWorkerSlot.size()) % slot._vAutoBatch.size();
+	}
+
 	redis_stub_param_t& _refParam;
 
-	CRedisClientTrunkQueuePtr _trunkQueue;
-	CKjRedisClientWorkQueuePtr _workQueue;
+	std::vector<worker_slot_t> _vWorkerSlot;
 
-	//! threads
-	svrcore_pipeworker_t *_refPipeWorker = nullptr;
-	char _trunkOpCodeSend = 0;
-	char _trunkOpCodeRecvBuf[1024];
+private:
+	//! auto-pipelining applies to this commit: main thread, no flag of its own
+	bool						IsAutoPipelined(const command_buffer_t& buf) const;
+
+	void						AddToAutoBatch(command_buffer_t& buf, redis_reply_cb_t&& rcb, uint32_t uCaller);
+	void						FlushAutoBatch(worker_slot_t& slot, size_t lane);
 
 private:
-	std::string _singleCommand;
-	std::string _allCommands;
-	int _builtNum = 0;
+	uint64_t _clientId;
+	std::atomic<int> _nextSn;
+
+	std::thread::id _mainThreadId;
+	std::atomic<uint64_t> _nBlockingOnMainThread;
 
-	int _nextSn = 0;
+	//! "_bAutoPipeline", main thread only
+	bool _bAutoPipeline;
+	int _nAutoCommitNum = 0;
+	std::chrono::steady_clock::time_point _tpAutoFirst;
 };
 
 /*EOF*/
\ No newline at end of file
@@ -6,6 +6,7 @@
 (C) 2016 n.lee
 */
 #include <string>
+#include <vector>
 
 #include "base/redis_service_def.h"
 #include "base/IRedisService.h"
@@ -23,28 +24,72 @@ public:
 
 public:
 	virtual void				OnUpdate() override {
-		_redisClient->RunOnce();
-		_redisSubscriber->RunOnce();
+		if (_writeBehind
+			&& _writeBehind->IsDue())
+			FlushWriteBehind();
+
+		for (auto& shard : _vShard) {
+			shard._redisClient->RunOnce();
+			shard._redisSubscriber->RunOnce();
+		}
 	}
 
 	virtual IRedisClient&		Client() override {
-		return *_redisClient;
+		return *_vShard[0]._redisClient;
 	}
 
 	virtual IRedisSubscriber&	Subscriber() override {
-		return *_redisSubscriber;
+		return *_vShard[0]._redisSubscriber;
+	}
+
+	virtual size_t				ShardNum() override {
+		return _vShard.size();
+	}
+
+	virtual size_t				ShardIndex(uint32_t uKeyHash) override {
+		return _ring.Locate(uKeyHash);
+	}
+
+	virtual IRedisClient&		ShardClient(size_t nShard) override {
+		return *_vShard[nShard]._redisClient;
+	}
+
+	virtual IRedisSubscriber&	ShardSubscriber(size_t nShard) override {
+		return *_vShard[nShard]._redisSubscriber;
+	}
+
+	virtual CRedisNearCache *	NearCache() override {
+		return _nearCache;
+	}
+
+	virtual CRedisWriteBehind *	WriteBehind() override {
+		return _writeBehind;
 	}
 
 	virtual int					ParseDumpedData(const std::string& sDump, std::function<int(rdb_object_t *)>&& cb) override;
+	virtual redis_bulk_chunk_cb_t DumpedDataSink(std::function<int(rdb_object_t *)>&& cb, std::function<void(int)>&& overCb = nullptr) override;
 
 	virtual void				Shutdown() override;
 
 private:
+	void						FlushWriteBehind();
+
+private:
+	struct shard_t {
+		redis_stub_param_t _param;
+		IRedisClient *_redisClient = nullptr;
+		IRedisSubscriber *_redisSubscriber = nullptr;
+	};
+
 	redis_stub_param_t _param;
 	bool _bShutdown = false;
 
-	IRedisClient *_redisClient;
-	IRedisSubscriber *_redisSubscriber;
+	// reserved up front and never resized, client and subscriber keep a reference to "_param"
+	std::vector<shard_t> _vShard;
+	CRedisShardRing _ring;
+
+	CRedisNearCache *_nearCache = nullptr;
+	CRedisWriteBehind *_writeBehind = nullptr;
 
 	rdb_parser_t *_rp = nullptr;
 
@@ -9,6 +9,7 @@
 #include <functional>
 
 #include "concurrent/readerwriterqueue.h"
+#include "RedisCallback.h"
 
 //------------------------------------------------------------------------------
 /**
@@ -19,12 +20,12 @@ public:
 	CCamelReaderWriterQueue();
 	~CCamelReaderWriterQueue();
 
-	using CallbackEntry = std::function<void()>;
+	using CallbackEntry = CRedisCallback<void()>;
 
 	void RunOnce();
 	void Close();
 
-	bool Add(std::function<void()>&& workCb);
+	bool Add(CallbackEntry&& workCb);
 
 private:
 	bool _close = false;
@@ -8,7 +8,9 @@
 #include <map>
 #include <vector>
 #include <string>
+#include <memory>
 #include <functional>
+#include <stdint.h>
 
 #ifdef _WIN32
 #pragma comment(lib, "WS2_32.Lib")
@@ -20,6 +22,10 @@
 
 #include "redis_extern.h"
 #include "RedisReply.h"
+#include "RedisFuture.h"
+#include "RedisNearCache.h"
+#include "RedisWriteBehind.h"
+#include "RedisShardRing.h"
 
 #ifdef __cplusplus 
 extern "C" {
@@ -32,6 +38,16 @@ extern "C" {
 class IRedisClient;
 class IRedisSubscriber;
 
+//! backpressure counters of IRedisClient::GetStats(), summed over pipe workers
+struct redis_client_stats_t {
+	int64_t _pendingNum = 0;		// committed and not called back yet
+	int64_t _inflightBytes = 0;		// written and not replied yet
+	uint64_t _blockedNum = 0;		// commits which waited for room
+	uint64_t _failedNum = 0;		// commits failed at once
+	uint64_t _droppedNum = 0;		// oldest pipelines dropped for new ones
+	uint64_t _heldWriteNum = 0;		// writes held back by "_nMaxInflightBytes"
+};
+
 //------------------------------------------------------------------------------
 /**
 	@brief IRedisService
@@ -45,8 +61,32 @@ public:
 	virtual IRedisClient&		Client() = 0;
 	virtual IRedisSubscriber&	Subscriber() = 0;
 
+	//! nullptr when "_nNearCacheBytes" is 0
+	virtual CRedisNearCache *	NearCache() = 0;
+
+	//! nullptr when "_nWriteBehindMs" is 0
+	virtual CRedisWriteBehind *	WriteBehind() = 0;
+
+	//! shards of "_vShard", "Client()" and "Subscriber()" are shard 0
+	virtual size_t				ShardNum() = 0;
+	virtual size_t				ShardIndex(uint32_t uKeyHash) = 0;
+	virtual IRedisClient&		ShardClient(size_t nShard) = 0;
+	virtual IRedisSubscriber&	ShardSubscriber(size_t nShard) = 0;
+
+	//! client of the shard owning the key hash -- see CRedisShardRing::KeyHash()
+	IRedisClient&				ShardClientOf(uint32_t uKeyHash) {
+		return ShardClient(ShardIndex(uKeyHash));
+	}
+
+	//! OB_OVER when the whole DUMP is parsed, the errcode otherwise -- OB_ERROR_PREMATURE means truncated
 	virtual int					ParseDumpedData(const std::string& sDump, std::function<int(rdb_object_t *)>&& cb) = 0;
 
+	//! sink for IRedisClient::StreamBulkString() which parses a DUMP reply while it arrives, with a parser of
+	//! its own. "cb" gets the objects on the pipe worker thread. "overCb" is called once on the same thread with
+	//! the result of the whole parse: OB_OVER, or the errcode of the first failure -- a truncated DUMP fails
+	//! with OB_ERROR_PREMATURE
+	virtual redis_bulk_chunk_cb_t DumpedDataSink(std::function<int(rdb_object_t *)>&& cb, std::function<void(int)>&& overCb = nullptr) = 0;
+
 	virtual void				Shutdown() = 0;
 };
 
@@ -56,8 +96,40 @@ public:
 
 	virtual void				RunOnce() = 0;
 
-	virtual void				Commit(redis_reply_cb_t&& rcb) = 0;
-	virtual CRedisReply			BlockingCommit() = 0;
+	//! pipelines committed with the same caller id are processed in order, caller 0 (the default) keeps no order
+	virtual void				Commit(redis_reply_cb_t&& rcb, uint32_t uCaller = 0) = 0;
+	virtual CRedisReply			BlockingCommit(uint32_t uCaller = 0) = 0;
+
+	//! blocking commit in two steps: the pipeline is sent at once and the returned function waits for
+	//! its reply, so one thread can wait on several clients in parallel
+	using blocking_wait_t = std::function<CRedisReply()>;
+	virtual blocking_wait_t		BeginBlockingCommit(uint32_t uCaller = 0) = 0;
+
+	//! non-blocking, the future is resolved in RunOnce()
+	virtual CRedisFuture		AsyncCommit(uint32_t uCaller = 0) = 0;
+
+	//! the pipeline being built may be served by a replica, which takes effect only when all of its
+	//! commands are read-only -- replicas lag behind, reads may not see the latest writes
+	virtual void				ReadFromReplica() = 0;
+
+	//! the pipeline being built calls back with a "TIMEOUT" error reply if it is not replied in "uTimeoutMs",
+	//! a late reply is dropped. 0 falls back to "_nPipelineTimeoutMs"
+	virtual void				SetDeadline(uint32_t uTimeoutMs) = 0;
+
+	//! the tail reply of the pipeline being built is streamed: "visitor" gets its elements one by one while
+	//! they are parsed and none of them is kept, so a huge LRANGE or HGETALL takes constant memory. It runs
+	//! on the pipe worker thread and must not block. The callback then gets an integer reply, the element
+	//! num of the reply. Error replies are not streamed, neither are replies in cluster mode
+	virtual void				StreamReply(redis_element_cb_t&& visitor) = 0;
+
+	//! the tail reply of the pipeline being built, when it is a bulk string, goes to "sink" piece by piece as it
+	//! arrives and is never held whole, "remain" is the byte num still to come -- 0 on the last piece, which
+	//! always comes. It runs on the pipe worker thread and must not block. The callback then gets an integer
+	//! reply, the length of the string. Not in cluster mode. See IRedisService::DumpedDataSink() for DUMP
+	virtual void				StreamBulkString(redis_bulk_chunk_cb_t&& sink) = 0;
+
+	//! backpressure counters, see "_nMaxPendingPipelines" and "_nMaxInflightBytes"
+	virtual void				GetStats(redis_client_stats_t& stats) = 0;
 
 	virtual void				Watch(const std::string& key) = 0;
 	virtual void				Multi() = 0;
@@ -105,6 +177,61 @@ public:
 
 };
 
+//! one commit path for blocking and non-blocking proxy calls: "rcb" gets the reply at once when blocking,
+//! or in RunOnce() otherwise
+inline void
+redis_dispatch_commit(IRedisClient& client, uint32_t uCaller, bool bBlocking, redis_reply_cb_t&& rcb) {
+	if (bBlocking) {
+		rcb(client.BlockingCommit(uCaller));
+	}
+	else {
+		client.Commit(std::move(rcb), uCaller);
+	}
+}
+
+//! commit every client of "vClient" at once, each already holds its own commands. "rcb" gets the
+//! replies in "vClient" order after the last one arrives -- non-blocking replies are all delivered in
+//! RunOnce() of the same thread, so the shared state needs no lock
+inline void
+redis_dispatch_fanout(const std::vector<IRedisClient *>& vClient, uint32_t uCaller, bool bBlocking, std::function<void(std::vector<CRedisReply>&)>&& rcb) {
+	if (bBlocking) {
+		std::vector<IRedisClient::blocking_wait_t> vWait;
+		std::vector<CRedisReply> vReply;
+		vWait.reserve(vClient.size());
+		vReply.reserve(vClient.size());
+
+		for (auto& client : vClient) {
+			vWait.emplace_back(client->BeginBlockingCommit(uCaller));
+		}
+
+		for (auto& wait : vWait) {
+			vReply.emplace_back(wait());
+		}
+		rcb(vReply);
+		return;
+	}
+
+	struct fanout_t {
+		std::vector<CRedisReply> _vReply;
+		size_t _remain;
+		std::function<void(std::vector<CRedisReply>&)> _cb;
+	};
+
+	auto fanout = std::make_shared<fanout_t>();
+	fanout->_vReply.resize(vClient.size());
+	fanout->_remain = vClient.size();
+	fanout->_cb = std::move(rcb);
+
+	size_t i;
+	for (i = 0; i < vClient.size(); ++i) {
+		vClient[i]->Commit([fanout, i](CRedisReply&& reply) {
+			fanout->_vReply[i] = std::move(reply);
+			if (0 == --fanout->_remain)
+				fanout->_cb(fanout->_vReply);
+		}, uCaller);
+	}
+}
+
 class MY_REDIS_EXTERN IRedisSubscriber {
 public:
 	virtual ~IRedisSubscriber() noexcept {};
@@ -0,0 +1,98 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+/**
+@class CRedisFuture
+
+(C) 2016 n.lee
+*/
+#include <memory>
+#include <vector>
+#include <functional>
+#include <type_traits>
+
+#include "RedisReply.h"
+
+//------------------------------------------------------------------------------
+/**
+@brief CRedisFuture
+
+//!
+//! reply of an async committed pipeline. Resolved in IRedisClient::RunOnce() on the main thread,
+//! continuations run there too, so attach them on the main thread. The reply stays in the future,
+//! every continuation gets a copy of it -- attached before or after it is resolved, on any copy of the future.
+//!
+*/
+class MY_REDIS_EXTERN CRedisFuture {
+public:
+	struct state_t {
+		bool _ready = false;
+		CRedisReply _reply;
+		std::vector<redis_reply_cb_t> _vCont;
+
+		void Resolve(CRedisReply&& reply);
+		void OnReady(redis_reply_cb_t&& cb);
+	};
+	using state_ptr_t = std::shared_ptr<state_t>;
+
+	//! ctor & dtor
+	CRedisFuture() : _state(std::make_shared<state_t>()) {}
+	~CRedisFuture() = default;
+
+	//! copy ctor & assignment operator
+	CRedisFuture(const CRedisFuture&) = default;
+	CRedisFuture& operator=(const CRedisFuture&) = default;
+
+public:
+	bool IsReady() const {
+		return _state->_ready;
+	}
+
+	//! resolve by the pipeline reply callback
+	void Resolve(CRedisReply&& reply) {
+		_state->Resolve(std::move(reply));
+	}
+
+	//! run "f(CRedisReply&&)" when resolved, "f" returns:
+	//!   CRedisFuture -- the returned future resolves with it (chain another request),
+	//!   CRedisReply  -- the returned future resolves with it,
+	//!   void         -- the returned future resolves with null reply after "f".
+	template<typename F>
+	CRedisFuture Then(F f) {
+		using result_type = typename std::result_of<F&(CRedisReply&&)>::type;
+
+		CRedisFuture next;
+		state_ptr_t nextState = next._state;
+
+		_state->OnReady(std::bind([nextState](F& f, CRedisReply&& reply) {
+			Invoke(nextState, f, std::move(reply), std::is_void<result_type>());
+		}, std::move(f), std::placeholders::_1));
+		return next;
+	}
+
+	//! resolves with an array reply holding the replies of "vFuture" in order
+	static CRedisFuture WhenAll(std::vector<CRedisFuture>& vFuture);
+
+private:
+	template<typename F>
+	static void Invoke(const state_ptr_t& next, F& f, CRedisReply&& reply, std::true_type) {
+		f(std::move(reply));
+		next->Resolve(CRedisReply());
+	}
+
+	template<typename F>
+	static void Invoke(const state_ptr_t& next, F& f, CRedisReply&& reply, std::false_type) {
+		Forward(next, f(std::move(reply)));
+	}
+
+	static void Forward(const state_ptr_t& next, CRedisReply&& reply) {
+		next->Resolve(std::move(reply));
+	}
+
+	static void Forward(const state_ptr_t& next, CRedisFuture&& inner);
+
+private:
+	state_ptr_t _state;
+};
+
+/*EOF*/
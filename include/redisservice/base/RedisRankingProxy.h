@@ -3,6 +3,8 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <functional>
+#include <cfloat>
 
 #include "redis_extern.h"
 #include "redis_service_def.h"
@@ -28,6 +30,10 @@ public:
 	using RESULT_PAIR_LIST = std::vector<CRedisReply>;
 	using RESULT_LIST = std::vector<CRedisReply>;
 
+	//! non-blocking overloads call back in RunOnce()
+	using done_cb_t = std::function<void()>;
+	using double_cb_t = std::function<void(double)>;
+
 	const std::string&			MainId() const {
 		return _sMainId;
 	}
@@ -44,6 +50,11 @@ public:
 		_refEntry = entry;
 	}
 
+	//! GetScore() may be served by a replica, see IRedisClient::ReadFromReplica()
+	void						SetReadFromReplica(bool bFlag) {
+		_bReadFromReplica = bFlag;
+	}
+
 	void *						ServiceEntry() const {
 		return _refEntry;
 	}
@@ -54,7 +65,13 @@ public:
 	void						RemoveFromZSet(std::vector<std::string>& vMember);
 	void						ZScore(std::string& sMember);
 
-	void						Clear();
+	void						Clear() {
+		DispatchClear(true, nullptr);
+	}
+
+	void						Clear(done_cb_t&& cb) {
+		DispatchClear(false, std::move(cb));
+	}
 
 	void						Add(double dScore, std::string& sMember) {
 		AddToZSet(dScore, sMember);
@@ -66,11 +83,24 @@ public:
 		Commit();
 	}
 
-	double						GetScore(std::string& sMember);
+	double						GetScore(std::string& sMember) {
+		double dOut = DBL_MIN;
+		DispatchGetScore(sMember, true, [&dOut](double d) { dOut = d; });
+		return dOut;
+	}
+
+	void						GetScore(std::string& sMember, double_cb_t&& cb) {
+		DispatchGetScore(sMember, false, std::move(cb));
+	}
 
 public:
 	static const std::map<std::string, std::string>& MapScript();
 
+private:
+	//! shared by blocking and non-blocking overloads
+	void						DispatchClear(bool bBlocking, done_cb_t&& cb);
+	void						DispatchGetScore(std::string& sMember, bool bBlocking, double_cb_t&& cb);
+
 private:
 	void *_refEntry;
 
@@ -79,6 +109,9 @@ private:
 	std::string _sSubid;
 	std::string _sIdZSet;
 	std::string _sIdHashOfCAS; // check and set
+	uint32_t _uCaller;
+	uint32_t _uShardHash; // shard of "module:mainid:subid", for all keys of the object
+	bool _bReadFromReplica = false;
 
 };
 
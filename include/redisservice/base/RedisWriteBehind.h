@@ -0,0 +1,108 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+/**
+@class CRedisWriteBehind
+
+(C) 2016 n.lee
+*/
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <stdint.h>
+
+#include "redis_extern.h"
+
+//------------------------------------------------------------------------------
+/**
+@brief CRedisWriteBehind
+
+//!
+//! write-behind buffer of CRedisCacheProxy add/update/remove: writes to the same field of the
+//! same hash within the window collapse into one, the last value wins and a remove cancels a
+//! pending add. CRedisService::OnUpdate() flushes it once the oldest write is "_nWriteBehindMs"
+//! old, one cmd pipeline per object under the caller id of the object, see
+//! CRedisCacheProxy::FlushWriteBehind(). Filled by the callers, so all of it is under "_mtx"
+//!
+*/
+class MY_REDIS_EXTERN CRedisWriteBehind {
+public:
+	//! ctor & dtor
+	explicit CRedisWriteBehind(uint32_t nWindowMs);
+	~CRedisWriteBehind() = default;
+
+	//! copy ctor & assignment operator
+	CRedisWriteBehind(const CRedisWriteBehind&) = delete;
+	CRedisWriteBehind& operator=(const CRedisWriteBehind&) = delete;
+
+	//! same as the dirty states of CRedisCacheProxy
+	enum WRITE_OP {
+		WRITE_REMOVE = 2,
+		WRITE_UPDATE = 3,
+		WRITE_ADD = 4,
+	};
+
+	struct write_t {
+		int _op = WRITE_UPDATE;
+		std::string _sValue;
+	};
+
+	//! pending writes of one proxy object, with the keys its scripts need
+	struct object_t {
+		std::string _sIdHash;
+		std::string _sIdHashOfDirty;
+		std::string _sIdHashOfDirtyState;
+		std::string _sDirtyEntry;
+		uint32_t _uShardHash = 0;
+		uint32_t _uCaller = 0;		// the flush commits with it, in order with the direct commands of the object
+
+		// field -> last write
+		std::unordered_map<std::string, write_t> _mapWrite;
+	};
+
+	using object_map_t = std::unordered_map<std::string, object_t>;
+
+	struct stats_t {
+		uint64_t _puts = 0;
+		uint64_t _coalesced = 0;		// writes merged into a pending one
+		uint64_t _cancelled = 0;		// pending adds cancelled by a remove
+		uint64_t _flushes = 0;
+		size_t _pending = 0;			// fields waiting for the flush
+	};
+
+public:
+	//! "sIdHash" is the key of the object, the other keys are kept for the flush
+	void						Put(const std::string& sIdHash, const std::string& sIdHashOfDirty, const std::string& sIdHashOfDirtyState,
+									const std::string& sDirtyEntry, uint32_t uShardHash, uint32_t uCaller, const std::string& sField, int op, std::string&& sValue);
+
+	//! read-your-writes: true when "sField" of "sIdHash" is pending, a pending remove gives an empty "sOut"
+	bool						Lookup(const std::string& sIdHash, const std::string& sField, std::string& sOut);
+
+	//! moves out the pending writes of one object, false when there are none
+	bool						Take(const std::string& sIdHash, object_t& out);
+
+	//! moves out everything
+	void						TakeAll(object_map_t& out);
+
+	//! the oldest pending write is at least a window old
+	bool						IsDue();
+
+	bool						IsEmpty();
+
+	stats_t						Stats();
+
+private:
+	using clock_type = std::chrono::steady_clock;
+
+	std::mutex _mtx;
+	std::chrono::milliseconds _window;
+
+	// idhash -> object
+	object_map_t _mapObject;
+	clock_type::time_point _tpFirst;
+
+	stats_t _stats;
+};
+
+/*EOF*/
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint16_t crc16(const char *buf, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* EOF */
\ No newline at end of file
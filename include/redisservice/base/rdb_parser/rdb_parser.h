@@ -12,6 +12,12 @@ MY_REDIS_EXTERN int             rdb_parse_object_once(rdb_parser_t *rp, bip_buf_
 MY_REDIS_EXTERN int             rdb_parse_dumped_data_once(rdb_parser_t *rp, bip_buf_t *bb);
 MY_REDIS_EXTERN int             rdb_parse_dumped_data(rdb_parser_t *rp, func_walk_rdb_object cb, void *payload, const char *s, size_t len);
 
+/* dumped data arriving in pieces: "begin" once, then "feed" each piece in order, "remain" is the byte num
+   still to come after it. On the last piece ("remain" is 0) it returns OB_OVER only when the whole dumped
+   data is parsed, OB_ERROR_PREMATURE there means truncated */
+MY_REDIS_EXTERN void            rdb_parse_dumped_data_begin(rdb_parser_t *rp, func_walk_rdb_object cb, void *payload);
+MY_REDIS_EXTERN int             rdb_parse_dumped_data_feed(rdb_parser_t *rp, const char *s, size_t len, size_t remain);
+
 MY_REDIS_EXTERN int             rdb_parse_file(rdb_parser_t *rp, const char *path);
 
 /* EOF */
\ No newline at end of file
@@ -2,6 +2,24 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+
+class CRedisNearCache;
+
+struct redis_endpoint_t {
+	std::string _ip;
+	unsigned short _port;
+};
+
+struct redis_shard_endpoint_t {
+	std::string _ip;
+	unsigned short _port;
+
+	//! replicas of this shard, see "_vReplica" of redis_stub_param_t
+	std::vector<redis_endpoint_t> _vReplica;
+};
 
 struct redis_stub_param_t {
 	std::string _ip;
@@ -9,8 +27,91 @@ struct redis_stub_param_t {
 
 	std::string _sPassword;
 	std::map<std::string, std::string> _mapScript;
+
+	//! redis cluster: "_ip" and "_port" is the seed node, each pipe worker keeps one connection per master
+	//! and "_nConnPoolSize" is not used. A transaction or a multi-key command must keep its keys in one hash
+	//! slot, or it fails with "CROSSSLOT". CRedisCacheProxy and CRedisListProxy refuse it for that reason
+	bool _bCluster = false;
+
+	//! client side sharding over standalone servers, until the data moves to a cluster: the keys of
+	//! one proxy object stay on one shard of a ketama ring of these endpoints. Empty means a single
+	//! server at "_ip" and "_port"
+	std::vector<redis_shard_endpoint_t> _vShard;
+
+	//! replicas of the server at "_ip" and "_port": pipelines marked by IRedisClient::ReadFromReplica()
+	//! and made of read-only commands only go to the one with the lowest observed latency. Not for "_bCluster"
+	std::vector<redis_endpoint_t> _vReplica;
+
+	//! client connection pool: total connections, spread over pipe worker threads
+	int _nConnPoolSize = 1;
+	int _nPipeWorkerNum = 1;
+
+	//! reconnect backoff: the delay doubles from "_nReconnectMinMs" up to "_nReconnectMaxMs", each one
+	//! jittered into [1/2, 1] of it so that connections do not come back in lockstep
+	int _nReconnectMinMs = 100;
+	int _nReconnectMaxMs = 10000;
+
+	//! cmd pipelines kept for replay while disconnected, the oldest ones fail beyond it -- 0 means no limit
+	size_t _nReplayLimit = 0;
+
+	//! fast-fail after this many reconnects failed in a row: queued and new cmd pipelines fail at once with
+	//! a "CONNDOWN" error until the connection is back -- 0 means off
+	int _nFastFailAttempts = 0;
+
+	//! default timeout (ms) of cmd pipelines, 0 means none -- see IRedisClient::SetDeadline()
+	uint32_t _nPipelineTimeoutMs = 0;
+
+	//! max bytes of one batched (scatter-gather) write when committing cmd pipelines
+	size_t _nCommitBatchBytes = 256 * 1024;
+
+	//! auto-pipelining: Commit() on the thread which created the client is merged with the commits around
+	//! it into one cmd pipeline per pool connection of a pipe worker, sent by IRedisClient::RunOnce() -- once per frame from
+	//! CRedisService::OnUpdate() -- or as soon as the oldest of them is "_nAutoPipelineWindowMs" old (0 means
+	//! at the end of the frame only). Each commit still gets its own reply. Not for "_bCluster"
+	bool _bAutoPipeline = false;
+	uint32_t _nAutoPipelineWindowMs = 0;
+
+	//! what Commit() does when a pipe worker already has "_nMaxPendingPipelines"
+	enum BACKPRESSURE_POLICY {
+		BACKPRESSURE_BLOCK = 0,			// wait until some are called back
+		BACKPRESSURE_FAIL = 1,			// the new pipeline calls back with a "BUSY" error
+		BACKPRESSURE_DROP_OLDEST = 2,	// the oldest pipeline not written to redis yet calls back with "BUSY", the new one when all are written
+	};
+
+	//! backpressure: cmd pipelines committed to one pipe worker and not called back yet, 0 means no limit
+	size_t _nMaxPendingPipelines = 0;
+	BACKPRESSURE_POLICY _eBackpressurePolicy = BACKPRESSURE_BLOCK;
+
+	//! bytes written on one connection and not replied yet, later pipelines wait unsent -- 0 means no limit.
+	//! One pipeline is always written, however large
+	size_t _nMaxInflightBytes = 0;
+
+	//! bulk strings of replies are views into a shared slab instead of std::string copies
+	bool _bReplyView = false;
+
+	//! 3 sends "HELLO 3" on connect: replies may carry RESP3 types, tracking invalidations come as push
+	//! frames on the reading connection instead of the subscriber connection
+	int _nProtocol = 2;
+
+	//! bytes of the near cache of CRedisCacheProxy::Get(), 0 means off -- needs redis 6 (CLIENT TRACKING)
+	size_t _nNearCacheBytes = 0;
+
+	//! created by CRedisService when "_nNearCacheBytes" > 0, shared by client and subscriber connections
+	CRedisNearCache *_refNearCache = nullptr;
+
+	//! write-behind window (ms) of CRedisCacheProxy add/update/remove, 0 means off: writes to the same field
+	//! within it collapse into the last one and are flushed by CRedisService::OnUpdate(), one cmd pipeline per object
+	//! committed with the caller id of the object -- merged per pipe worker with "_bAutoPipeline"
+	uint32_t _nWriteBehindMs = 0;
 };
 
+//! caller id of a proxy object -- pipelines committed by one object are kept in order
+inline uint32_t
+redis_caller_id(const std::string& sId) {
+	uint32_t uCaller = (uint32_t)std::hash<std::string>()(sId);
+	return (uCaller != 0) ? uCaller : 1; // 0 keeps no order
+}
+
 struct redis_service_entry_t {
 	redis_service_entry_t() {
 		_nId = 0;
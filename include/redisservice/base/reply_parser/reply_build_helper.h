@@ -3,9 +3,12 @@
 #include "reply_parser_def.h"
 
 nx_chain_t *           alloc_simple_string_buf_chain_link(nx_pool_t *pool, nx_chain_t **ll);
+nx_buf_t *             alloc_bulk_string_buf(redis_reply_parser_t *rrp, size_t size);
 
 void                   redis_reply_as_string(redis_reply_t *r, char *buf, size_t *len);
 
+uint8_t                redis_reply_leading_type(uint8_t leading);
+
 size_t                 redis_reply_read_leading(redis_reply_parser_t *rrp, bip_buf_t *bb, uint8_t *out);
 size_t                 redis_reply_read_integer(redis_reply_parser_t *rrp, bip_buf_t *bb, int64_t *out);
 
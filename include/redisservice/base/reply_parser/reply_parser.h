@@ -5,6 +5,9 @@
 redis_reply_parser_t *  create_reply_parser(func_process_redis_reply cb, void *payload);
 void                    destroy_reply_parser(redis_reply_parser_t *rrp);
 void                    reset_reply_parser(redis_reply_parser_t *rrp);
+void                    set_reply_parser_bulk_alloc(redis_reply_parser_t *rrp, func_alloc_bulk_string alloc, void *payload);
+void                    set_reply_parser_element_visitor(redis_reply_parser_t *rrp, func_visit_redis_element cb, void *payload);
+void                    set_reply_parser_bulk_sink(redis_reply_parser_t *rrp, func_sink_bulk_string sink, void *payload);
 
 int                     redis_reply_parse_once(redis_reply_parser_t *rrp, bip_buf_t *bb);
 
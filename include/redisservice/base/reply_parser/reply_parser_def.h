@@ -12,8 +12,26 @@ enum REDIS_REPLY_LEADING_TYPE_TAG {
     REDIS_REPLY_LEADING_TYPE_INTEGER,
     REDIS_REPLY_LEADING_TYPE_BULK_STRING,
     REDIS_REPLY_LEADING_TYPE_ARRAY,
+
+    /* RESP3 */
+    REDIS_REPLY_LEADING_TYPE_NULL,
+    REDIS_REPLY_LEADING_TYPE_DOUBLE,
+    REDIS_REPLY_LEADING_TYPE_BOOLEAN,
+    REDIS_REPLY_LEADING_TYPE_BIG_NUMBER,
+    REDIS_REPLY_LEADING_TYPE_BLOB_ERROR,
+    REDIS_REPLY_LEADING_TYPE_VERBATIM_STRING,
+    REDIS_REPLY_LEADING_TYPE_MAP,
+    REDIS_REPLY_LEADING_TYPE_SET,
+    REDIS_REPLY_LEADING_TYPE_ATTRIBUTE,
+    REDIS_REPLY_LEADING_TYPE_PUSH,
 };
 
+/* map and attribute hold key and value pairs, "arrval" is flattened */
+#define redis_reply_type_is_aggregate(_t)                                           \
+    ((_t) == REDIS_REPLY_LEADING_TYPE_ARRAY || (_t) == REDIS_REPLY_LEADING_TYPE_MAP \
+    || (_t) == REDIS_REPLY_LEADING_TYPE_SET || (_t) == REDIS_REPLY_LEADING_TYPE_ATTRIBUTE \
+    || (_t) == REDIS_REPLY_LEADING_TYPE_PUSH)
+
 /* reply */
 typedef struct redis_reply_s        redis_reply_t;
 typedef struct redis_reply_chain_s  redis_reply_chain_t;
@@ -42,6 +60,16 @@ typedef struct redis_reply_builder_s  redis_reply_builder_t;
 typedef struct redis_reply_parser_s   redis_reply_parser_t;
 
 typedef int(*func_process_redis_reply)(redis_reply_t *r, void *payload);
+typedef void *(*func_alloc_bulk_string)(size_t size, void *payload);
+
+/* "depth" 0 is the reply itself (aggregate only), its return value tells whether the reply is streamed.
+   Aggregates are visited when their element num ("intval") is known, the rest when they are complete */
+typedef int(*func_visit_redis_element)(redis_reply_t *r, int depth, void *payload);
+
+/* top level bulk string given away in pieces as they arrive. First called with "data" NULL and the whole
+   length in "remain", its return value tells whether the string is sunk; then with each piece, "remain"
+   is the byte num still to come after it. A sunk reply keeps no "vall", "bytes" is the whole length */
+typedef int(*func_sink_bulk_string)(redis_reply_t *r, const char *data, size_t len, size_t remain, void *payload);
 
 struct redis_reply_builder_s {
     uint8_t                     depth;
@@ -68,6 +96,24 @@ struct redis_reply_parser_s {
 	nx_pool_t                  *r_pool;
     func_process_redis_reply    r_cb;
     void                       *r_payload;
+
+    /* bulk string storage, NULL means "r_pool" */
+    func_alloc_bulk_string      bulk_alloc;
+    void                       *bulk_payload;
+
+    /* streaming: elements are visited and dropped, not kept in the reply */
+    func_visit_redis_element    elem_cb;
+    void                       *elem_payload;
+    nx_pool_t                  *elem_pool;      /* element memory, reset after each element of the reply */
+    nx_pool_t                  *str_pool;       /* "r_pool", or "elem_pool" while streaming */
+    uint8_t                     streaming;
+    int                         elem_depth;     /* aggregates open */
+    int                         skip_depth;     /* inside an attribute, which is not visited */
+
+    /* sinking: the bytes of a top level bulk string are not kept in the reply */
+    func_sink_bulk_string       bulk_sink;
+    void                       *bulk_sink_payload;
+    uint8_t                     sinking;
 };
 
 #define redis_reply_init(_r)	 nx_memzero(_r, sizeof(redis_reply_t))
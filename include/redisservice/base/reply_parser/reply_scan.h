@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* first "\r\n" in [p, p + len), NULL if none */
+const char *           redis_reply_scan_crlf(const char *p, size_t len);
+
+/* "<int>\r\n" of ":", "$", "*" headers, parsed in the same pass that finds the "\r\n".
+   Returns bytes consumed with the "\r\n", 0 means premature */
+size_t                 redis_reply_scan_integer(const char *p, size_t len, int64_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* EOF */
@@ -5,12 +5,15 @@
 
 	(C) 2016 n.lee
 */
+#include <random>
+
 #include "servercore/base/IServerCore.h"
 #include "base/IRedisService.h"
 
 #include "KjRedisTcpConn.hpp"
 #include "KjReplyBuilder.hpp"
 #include "KjRedisClientWorkQueue.hpp"
+#include "RedisCmdPipelineList.hpp"
 
 //------------------------------------------------------------------------------
 /**
@@ -22,6 +25,8 @@
 */
 class KjRedisClientConn : public kj::Refcounted, public kj::TaskSet::ErrorHandler {
 public:
+	using PIPELINE_OVER_CB = std::function<void(KjRedisClientConn&, redis_cmd_pipepline_t&)>;
+
 	//! ctor & dtor
 	explicit KjRedisClientConn(kj::Own<KjPipeEndpointIoContext> endpointContext, redis_stub_param_t& param);
 	~KjRedisClientConn();
@@ -34,6 +39,12 @@ public:
 	virtual void OnClientDisconnect(KjRedisTcpConn&, uint64_t);
 	virtual void OnClientReceive(KjRedisTcpConn&, bip_buf_t& bb);
 
+	//! RESP3 push frame, only tracking invalidations are expected here
+	void OnPush(CRedisReply& reply);
+
+	//! "MOVED ..." or "ASK ..." error of redis cluster
+	static bool IsClusterRedirect(CRedisReply& reply);
+
 public:
 	void Open(redis_stub_param_t& param);
 	void Close();
@@ -45,12 +56,8 @@ public:
 		return _kjconn.IsConnected();
 	}
 
-	//! send cmd pipeline
-	KjRedisClientConn& Send(redis_cmd_pipepline_t& cp) {
-		cp._state = redis_cmd_pipepline_t::SENDING;
-		_dqCommon.emplace_back(std::move(cp));
-		return *this;
-	}
+	//! send cmd pipeline, it fails at once in fast-fail mode
+	KjRedisClientConn& Send(redis_cmd_pipepline_t& cp);
 
 	//! commit pipelined transaction
 	KjRedisClientConn& Commit();
@@ -60,6 +67,32 @@ public:
 		return _dqCommon.size();
 	}
 
+	bool IsFastFail() const {
+		return _bFastFail;
+	}
+
+	//! sn of the oldest common pipeline not sent yet, 0 when there is none
+	int OldestUnsentSn();
+
+	//! fail the unsent pipelines of "nSn" (a split one of redis cluster has several), returns their num
+	int DropUnsent(int nSn, const std::string& sDesc);
+
+	//! notified when a common cmd pipeline is process over
+	void SetPipelineOverCb(PIPELINE_OVER_CB&& cb) {
+		_pipelineOverCb = std::move(cb);
+	}
+
+	//! in-flight bytes and held writes are counted into the counters of "workQueue" too, command buffers
+	//! of finished pipelines go back to it
+	void SetWorkQueue(CKjRedisClientWorkQueue *workQueue) {
+		_refWorkQueue = workQueue;
+		_refCounters = workQueue ? &workQueue->Counters() : nullptr;
+	}
+
+	uint64_t GetConnId() {
+		return _kjconn.GetConnId();
+	}
+
 private:
 	//!
 	void Init();
@@ -67,9 +100,42 @@ private:
 	//! 
 	void DelayReconnect();
 
+	//! exponential backoff with jitter, by "_nReconnectAttempts"
+	int NextReconnectDelayMs();
+
+	//! complete the pipeline with an error reply, it is not sent (again)
+	void FailPipeline(redis_cmd_pipepline_t& cp, const std::string& sDesc);
+
+	//! fail the oldest unsent pipelines beyond "_nReplayLimit"
+	void TrimReplay();
+
+	//! fail every unsent pipeline, new ones fail in Send() until reconnected
+	void EnterFastFail();
+
 	//! 
 	kj::Promise<void> CommitLoop();
 
+	//! (re)turn on tracking for the near cache ahead of the pipelines not sent yet
+	void EnableTracking();
+
+	//! remove pipelines whose deadline fired before they were sent
+	void DropExpired();
+
+	//! pipeline streaming or sinking the n-th reply not popped yet, which is its tail reply
+	redis_cmd_pipepline_t * StreamingPipelineAt(size_t nth);
+
+	//! visitor of the n-th reply not popped yet, see KjReplyBuilder::SetStreamProvider()
+	const redis_element_cb_t * StreamVisitorAt(size_t nth);
+
+	//! sink of the n-th reply not popped yet, see KjReplyBuilder::SetSinkProvider()
+	const redis_bulk_chunk_cb_t * BulkSinkAt(size_t nth);
+
+	//! bytes written and not replied yet, negative to release
+	void AddInflight(int64_t nBytes) {
+		_nInflightBytes += nBytes;
+		if (_refCounters) _refCounters->_inflightBytes += nBytes;
+	}
+
 	//! 
 	void taskFailed(kj::Exception&& exception) override;
 
@@ -80,14 +146,36 @@ private:
 
 	//! redis service cmd pipelines need to be commit
 	std::deque<redis_cmd_pipepline_t> _dqInit;
-	std::deque<redis_cmd_pipepline_t> _dqCommon;
+	CRedisCmdPipelineList _dqCommon;
 
 	int _committing_num = 0;
 
+	//! one batched write in flight at a time, CommitLoop() goes on when it is done
+	bool _bWriting = false;
+
+	//! "_nMaxInflightBytes": pipelines are held back until replies make room
+	int64_t _nInflightBytes = 0;
+	bool _bInflightHeld = false;
+	CKjRedisClientWorkQueue *_refWorkQueue = nullptr;
+	CKjRedisClientWorkQueue::counters_t *_refCounters = nullptr;
+
+	//! pipelines in "_dqCommon" streaming or sinking their tail reply
+	int _nStreamingNum = 0;
+
+	//! redirect id "CLIENT TRACKING" is on with, 0 means off
+	int64_t _nTrackingRedirectId = 0;
+
 	KjRedisTcpConn _kjconn;
 	KjReplyBuilder _builder;
+
+	PIPELINE_OVER_CB _pipelineOverCb;
 	
 	bool _bDelayReconnecting = false;
+
+	//! reconnects failed in a row, reset when connected
+	int _nReconnectAttempts = 0;
+	bool _bFastFail = false;
+	std::minstd_rand _rand;
 };
 
 /*EOF*/
\ No newline at end of file
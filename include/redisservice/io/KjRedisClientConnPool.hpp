@@ -0,0 +1,81 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+	@class KjRedisClientConnPool
+
+	(C) 2016 n.lee
+*/
+#include <vector>
+#include <unordered_map>
+
+#include "KjRedisClientConn.hpp"
+
+//------------------------------------------------------------------------------
+/**
+	@brief KjRedisClientConnPool
+
+//!
+//! parallel redis connections owned by one pipe worker thread
+//!
+*/
+class KjRedisClientConnPool {
+public:
+	//! ctor & dtor
+	explicit KjRedisClientConnPool(kj::Own<KjPipeEndpointIoContext> endpointContext, redis_stub_param_t& param, int nPoolSize);
+	~KjRedisClientConnPool();
+
+	//! copy ctor & assignment operator
+	KjRedisClientConnPool(const KjRedisClientConnPool&) = delete;
+	KjRedisClientConnPool& operator=(const KjRedisClientConnPool&) = delete;
+
+	struct caller_route_t {
+		size_t _connIdx;
+		int _pending;
+	};
+
+public:
+	void Open(redis_stub_param_t& param);
+	void Close();
+
+	//! dispatch cmd pipeline -- the caller sticks to its connection while it still has pipelines in flight,
+	//! otherwise the least-loaded connection is chosen -- caller 0 carries no ordering and always goes least-loaded
+	KjRedisClientConnPool& Send(redis_cmd_pipepline_t& cp);
+
+	//! commit pipelined transaction on every connection which got new pipelines
+	KjRedisClientConnPool& Commit();
+
+	size_t Size() const {
+		return _vConn.size();
+	}
+
+	void SetWorkQueue(CKjRedisClientWorkQueue *workQueue) {
+		for (auto& conn : _vConn) {
+			conn->SetWorkQueue(workQueue);
+		}
+	}
+
+	KjRedisClientConn& ConnAt(size_t idx) {
+		return *_vConn[idx];
+	}
+
+	template<typename F>
+	void ForEachConn(F&& f) {
+		for (auto& conn : _vConn) {
+			f(*conn);
+		}
+	}
+
+private:
+	size_t SelectConn(uint32_t uCaller);
+
+	void OnPipelineOver(KjRedisClientConn& conn, redis_cmd_pipepline_t& cp);
+
+private:
+	std::vector<kj::Own<KjRedisClientConn>> _vConn;
+	std::vector<bool> _vNeedCommit;
+
+	std::unordered_map<uint32_t, caller_route_t> _mapCallerRoute;
+	size_t _nextIdx = 0;
+};
+
+/*EOF*/
@@ -0,0 +1,146 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+	@class KjRedisClusterConnPool
+
+	(C) 2016 n.lee
+*/
+#include <vector>
+#include <memory>
+#include <time.h>
+
+#include "KjRedisClientConn.hpp"
+
+//------------------------------------------------------------------------------
+/**
+	@brief KjRedisClusterConnPool
+
+//!
+//! redis cluster connections owned by one pipe worker thread, one connection per master. Every
+//! command of a cmd pipeline is routed by the hash slot of its key, a transaction (WATCH or MULTI
+//! up to EXEC or DISCARD) as a whole. MOVED and ASK are followed, and the pipeline callback fires
+//! with the tail reply after all of its commands are replied. A transaction or a multi-key command
+//! over more than one slot fails the pipeline with "CROSSSLOT", nothing of it is sent.
+//!
+*/
+class KjRedisClusterConnPool {
+public:
+	//! ctor & dtor
+	explicit KjRedisClusterConnPool(kj::Own<KjPipeEndpointIoContext> endpointContext, redis_stub_param_t& param);
+	~KjRedisClusterConnPool();
+
+	//! copy ctor & assignment operator
+	KjRedisClusterConnPool(const KjRedisClusterConnPool&) = delete;
+	KjRedisClusterConnPool& operator=(const KjRedisClusterConnPool&) = delete;
+
+	static const int SLOT_NUM = 16384;
+	static const int MAX_REDIRECT_NUM = 5;
+
+	//! at most one "CLUSTER SLOTS" in flight, a lost one is given up after this
+	static const int REFRESH_TIMEOUT_SECONDS = 5;
+
+	struct node_t {
+		std::string _sHost;
+		unsigned short _port = 0;
+		kj::Own<KjRedisClientConn> _conn;
+		bool _bNeedCommit = false;
+	};
+
+	//! one command of a cmd pipeline
+	struct command_t {
+		size_t _offset = 0;
+		size_t _len = 0;
+		int _slot = -1;					// slot of its keys, -1 means keyless
+		bool _bCrossSlot = false;		// keys in more than one slot
+		bool _bMulti = false;			// WATCH or MULTI, a transaction starts
+		bool _bExec = false;			// EXEC or DISCARD, the transaction is over
+	};
+
+	//! commands sent together to one node: one command, or a whole transaction
+	struct unit_t {
+		size_t _offset = 0;
+		size_t _len = 0;
+		int _num = 0;
+		int _slot = -1;
+		bool _bMulti = false;
+		bool _bOpen = false;
+
+		// MOVED or ASK of a command queued in the transaction, EXEC only replies EXECABORT
+		std::string _sRedirect;
+	};
+
+	//! cmd pipeline split into units, waiting for all of their replies -- "_cp" keeps the commands
+	//! and callbacks of the original, its "_built_num" is the command num
+	struct split_t {
+		redis_cmd_pipepline_t _cp;
+		std::vector<unit_t> _vUnit;
+		int _remain = 0;
+		CRedisReply _tailReply;
+	};
+	using split_ptr_t = std::shared_ptr<split_t>;
+
+public:
+	void Open(redis_stub_param_t& param);
+	void Close();
+
+	//! dispatch cmd pipeline by hash slots
+	KjRedisClusterConnPool& Send(redis_cmd_pipepline_t& cp);
+
+	//! commit pipelined transaction on every node which got new commands
+	KjRedisClusterConnPool& Commit();
+
+	size_t Size() const {
+		return _vNode.size();
+	}
+
+	//! nodes found later get them too
+	void SetWorkQueue(CKjRedisClientWorkQueue *workQueue);
+
+	template<typename F>
+	void ForEachConn(F&& f) {
+		for (auto& node : _vNode) {
+			f(*node._conn);
+		}
+	}
+
+	//! CRC16 of the key, or of its "{tag}" when the tag is not empty
+	static int KeySlot(const char *key, size_t len);
+
+	//! split encoded commands, the slot of every command is checked over all of its keys
+	static bool SplitCommands(const std::string& sCommands, std::vector<command_t>& vCmd);
+
+private:
+	size_t NodeAt(const std::string& sHost, unsigned short port);
+
+	//! unit "nUnit" of the split pipeline, "ASKING" ahead of it for ASK
+	void SendUnit(const split_ptr_t& split, int nUnit, size_t nodeIdx, bool bAsking, int nRedirect);
+
+	void OnUnitReply(const split_ptr_t& split, int nUnit, int nRedirect, CRedisReply&& reply);
+
+	//! "MOVED 3999 127.0.0.1:6381" or "ASK 3999 127.0.0.1:6381"
+	static bool ParseRedirect(const std::string& sError, bool& bAsk, int& nSlot, std::string& sHost, unsigned short& port);
+
+	void RefreshSlots();
+	void OnSlotsReply(CRedisReply&& reply);
+
+private:
+	kj::Own<KjPipeEndpointIoContext> _endpointContext;
+	redis_stub_param_t& _refParam;
+
+	std::vector<node_t> _vNode;
+
+	// slot -> node index, every slot goes to the seed node until "CLUSTER SLOTS" is replied
+	std::vector<uint16_t> _vSlotNode;
+
+	std::vector<command_t> _vCmd;
+
+	CKjRedisClientWorkQueue *_refWorkQueue = nullptr;
+
+	bool _bOpened = false;
+
+	bool _bRefreshing = false;
+	time_t _tmRefresh = 0;
+	size_t _refreshNodeIdx = 0;
+};
+
+/*EOF*/
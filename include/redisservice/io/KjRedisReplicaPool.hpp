@@ -0,0 +1,86 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+	@class KjRedisReplicaPool
+
+	(C) 2016 n.lee
+*/
+#include <vector>
+#include <memory>
+#include <chrono>
+
+#include "KjRedisClientConnPool.hpp"
+
+//------------------------------------------------------------------------------
+/**
+	@brief KjRedisReplicaPool
+
+//!
+//! connections to the replicas of one master, owned by one pipe worker thread. A read-only cmd
+//! pipeline goes to the connected replica with the lowest latency (moving average of reply time),
+//! weighted by its pipelines in flight. Replicas never replied yet are tried first.
+//!
+*/
+class KjRedisReplicaPool {
+public:
+	//! ctor & dtor
+	explicit KjRedisReplicaPool(kj::Own<KjPipeEndpointIoContext> endpointContext, redis_stub_param_t& param, int nPoolSize);
+	~KjRedisReplicaPool();
+
+	//! copy ctor & assignment operator
+	KjRedisReplicaPool(const KjRedisReplicaPool&) = delete;
+	KjRedisReplicaPool& operator=(const KjRedisReplicaPool&) = delete;
+
+	//! weight of a new sample in the moving average, in 1/8
+	static const int LATENCY_SAMPLE_WEIGHT = 2;
+
+	struct replica_t {
+		//! connections keep a reference to it
+		redis_stub_param_t _param;
+		kj::Own<KjRedisClientConnPool> _pool;
+
+		int64_t _latencyUs = 0;
+		int _pending = 0;
+		bool _bNeedCommit = false;
+	};
+
+public:
+	void Open();
+	void Close();
+
+	//! false when no replica is connected, the caller sends "cp" to the master then
+	bool Send(redis_cmd_pipepline_t& cp);
+
+	//! commit pipelined transaction on every replica which got new pipelines
+	KjRedisReplicaPool& Commit();
+
+	size_t Size() const {
+		return _vReplica.size();
+	}
+
+	void SetWorkQueue(CKjRedisClientWorkQueue *workQueue) {
+		for (auto& replica : _vReplica) {
+			replica->_pool->SetWorkQueue(workQueue);
+		}
+	}
+
+	template<typename F>
+	void ForEachConn(F&& f) {
+		for (auto& replica : _vReplica) {
+			replica->_pool->ForEachConn(f);
+		}
+	}
+
+private:
+	//! index of the replica, -1 when none is connected
+	int Select();
+
+	static bool IsConnected(replica_t& replica);
+
+	static void OnReply(replica_t& replica, std::chrono::steady_clock::time_point tmSend);
+
+private:
+	std::vector<std::unique_ptr<replica_t>> _vReplica;
+};
+
+/*EOF*/
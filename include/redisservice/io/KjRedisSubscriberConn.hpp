@@ -69,6 +69,9 @@ private:
 	//!
 	void Init();
 
+	//! keys of a tracking invalidation message
+	void OnInvalidate(CRedisReply& keys);
+
 	//! 
 	void DelayReconnect();
 
@@ -45,6 +45,13 @@ public:
 			_stream->write(buffer, size);
 	}
 
+	//! scatter-gather write, pieces must be kept alive until the promise is resolved
+	kj::Promise<void> Write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) {
+		if (_stream)
+			return _stream->write(pieces);
+		return kj::READY_NOW;
+	}
+
 	//! 
 	void Disconnect();
 
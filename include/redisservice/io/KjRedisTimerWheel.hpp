@@ -0,0 +1,96 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+	@class KjRedisTimerWheel
+
+	(C) 2016 n.lee
+*/
+#include <vector>
+#include <chrono>
+#include <stdint.h>
+
+#include "servercore/base/IServerCore.h"
+
+#include "base/RedisCallback.h"
+
+//------------------------------------------------------------------------------
+/**
+	@brief KjRedisTimerWheel
+
+//!
+//! hashed timer wheel of one pipe worker thread: a timer lands in slot (cursor + ticks) % SLOT_NUM
+//! with the full turns it still has to wait. One kj delay drives the whole wheel, and only while
+//! there are timers in it. Late ticks are caught up from the steady clock. Timers live in a pool
+//! and are cancelled in O(1), so a timer whose work is done early holds nothing until it would expire.
+//!
+*/
+class KjRedisTimerWheel {
+public:
+	using expire_cb_t = CRedisCallback<void()>;
+
+	//! ctor & dtor
+	explicit KjRedisTimerWheel(kj::Own<KjPipeEndpointIoContext> endpointContext, kj::TaskSet& tasks);
+	~KjRedisTimerWheel();
+
+	//! copy ctor & assignment operator
+	KjRedisTimerWheel(const KjRedisTimerWheel&) = delete;
+	KjRedisTimerWheel& operator=(const KjRedisTimerWheel&) = delete;
+
+	static const int SLOT_NUM = 512;
+	static const int TICK_MS = 10;
+
+	//! "_slot" of a timer which is free or being expired
+	static const uint32_t NO_SLOT = 0xffffffff;
+
+	struct timer_t {
+		uint32_t _gen = 1;		// bumped when it is freed, stale handles miss
+		uint32_t _rounds = 0;
+		uint32_t _slot = NO_SLOT;
+		uint32_t _pos = 0;		// index in "_vSlot[_slot]"
+		expire_cb_t _cb;
+	};
+
+	//! returned by Add(), Cancel() of an expired or cancelled timer does nothing
+	struct handle_t {
+		uint32_t _idx = 0;
+		uint32_t _gen = 0;
+	};
+
+public:
+	//! "cb" runs on this thread after "uTimeoutMs", rounded up to ticks
+	handle_t Add(uint32_t uTimeoutMs, expire_cb_t&& cb);
+
+	//! "cb" of the timer is released at once and never runs
+	bool Cancel(const handle_t& h);
+
+	size_t Size() const {
+		return _nTimerNum;
+	}
+
+private:
+	kj::Promise<void> TickLoop();
+
+	void Advance();
+
+	void Insert(uint32_t uIdx, size_t nSlot);
+	void Free(uint32_t uIdx);
+
+private:
+	kj::Own<KjPipeEndpointIoContext> _endpointContext;
+	kj::TaskSet& _refTasks;
+
+	//! slots hold indices into "_vTimer", freed timers are reused
+	std::vector<timer_t> _vTimer;
+	std::vector<uint32_t> _vFree;
+	std::vector<std::vector<uint32_t>> _vSlot;
+	size_t _nCursor = 0;
+	size_t _nTimerNum = 0;
+
+	bool _bTicking = false;
+	std::chrono::steady_clock::time_point _tmLastTick;
+
+	//! timers of the slot being expired, the ones with rounds to go are put back
+	std::vector<handle_t> _vExpiring;
+};
+
+/*EOF*/
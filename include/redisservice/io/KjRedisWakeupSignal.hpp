@@ -0,0 +1,38 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+	@class KjRedisWakeupSignal
+
+	(C) 2016 n.lee
+*/
+#include <atomic>
+
+//------------------------------------------------------------------------------
+/**
+	@brief KjRedisWakeupSignal
+
+//!
+//! coalesces cross-thread wakeups: only the first add after the consumer cleared the signal
+//! writes to the pipe, the rest find a wakeup already on its way and make no syscall
+//!
+*/
+class KjRedisWakeupSignal {
+public:
+	KjRedisWakeupSignal() : _bSignalled(false) {}
+
+	//! producer, after enqueueing: true when the consumer must be notified
+	bool Raise() {
+		return !_bSignalled.exchange(true, std::memory_order_seq_cst);
+	}
+
+	//! consumer, before draining: items added from now on notify again. A full fence (not a plain
+	//! store) so the drain can't read the queue ahead of clearing
+	void Clear() {
+		_bSignalled.exchange(false, std::memory_order_seq_cst);
+	}
+
+private:
+	std::atomic<bool> _bSignalled;
+};
+
+/*EOF*/
@@ -29,7 +29,7 @@ public:
 		_callbacks->Close();
 	}
 
-	void Add(std::function<void()>&& workCb);
+	void Add(CCamelReaderWriterQueue::CallbackEntry&& workCb);
 
 	void Add(redis_reply_cb_t&&, CRedisReply&&);
 
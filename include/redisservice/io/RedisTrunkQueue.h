@@ -25,7 +25,7 @@ public:
 		_workQueue->Close();
 	}
 
-	void Add(std::function<void()>&& workCb) {
+	void Add(CCamelReaderWriterQueue::CallbackEntry&& workCb) {
 		_workQueue->Add(std::move(workCb));
 	}
 
@@ -5,6 +5,7 @@
 #include "RedisClient.h"
 
 #include <future>
+#include <unordered_map>
 #include "RedisRootContextDef.hpp"
 
 #include "base/RedisError.h"
@@ -15,22 +16,85 @@
 #endif
 #endif
 
-#define SINGLE_COMMAND_RESERVE_SIZE  1024 * 4
 #define ALL_COMMANDS_RESERVE_SIZE    1024 * 256
 
+static std::atomic<uint64_t> s_redis_client_id(0);
+static thread_local std::unordered_map<uint64_t, CRedisClient::command_buffer_t> stl_command_buffers;
+
+/* from the pipe worker the reply goes through the trunk queue. A pipeline failed by Add() on the
+   calling thread (shut down, or the enqueue failed) is called back right there, never dropped */
+static void
+deliver_reply(CRedisClientTrunkQueue *trunkQueue, CKjRedisClientWorkQueue *workQueue, redis_reply_cb_t&& rcb, CRedisReply&& reply) {
+	if (workQueue->IsWorkerThread())
+		trunkQueue->Add(std::move(rcb), std::move(reply));
+	else
+		rcb(std::move(reply));
+}
+
+/* reply callbacks of the commits merged into one pipeline, shared by its callbacks */
+struct auto_batch_replies_t {
+	std::vector<int> _vEnd;
+	std::vector<redis_reply_cb_t> _vReplyCb;
+	size_t _next = 0;
+
+	/* a reply ahead of the tail one: the tail reply of a commit or nothing to call back */
+	void OnSegment(CRedisClientTrunkQueue *trunkQueue, int nth, CRedisReply&& reply) {
+		// a reconnect resends only the commits not called back yet, see "_vSegmentEnd"
+		if (_next + 1 < _vEnd.size()
+			&& nth == _vEnd[_next]) {
+			redis_reply_cb_t& rcb = _vReplyCb[_next++];
+			if (rcb)
+				trunkQueue->Add(std::move(rcb), std::move(reply));
+		}
+	}
+
+	/* the tail reply goes to the last commit, a failure goes to each one not called back yet */
+	void OnTail(CRedisClientTrunkQueue *trunkQueue, CKjRedisClientWorkQueue *workQueue, CRedisReply&& reply) {
+		size_t i, szNum = _vReplyCb.size();
+		for (i = _next; i < szNum; ++i) {
+			redis_reply_cb_t& rcb = _vReplyCb[i];
+			if (!rcb)
+				continue;
+
+			if (i + 1 < szNum)
+				deliver_reply(trunkQueue, workQueue, std::move(rcb), CRedisReply(reply));
+			else
+				deliver_reply(trunkQueue, workQueue, std::move(rcb), std::move(reply));
+		}
+		_next = szNum;
+	}
+};
+
 //------------------------------------------------------------------------------
 /**
 
 */
 CRedisClient::CRedisClient(redis_stub_param_t& param)
-	: _refParam(param) {
+	: _refParam(param)
+	, _clientId(++s_redis_client_id)
+	, _nextSn(0)
+	, _mainThreadId(std::this_thread::get_id())
+	, _nBlockingOnMainThread(0)
+	, _bAutoPipeline(param._bAutoPipeline && !param._bCluster) {
 	//
-	_workQueue = std::make_shared<CKjRedisClientWorkQueue>(this, param);
-	_trunkQueue = std::make_shared<CRedisClientTrunkQueue>(this);
+	int nWorkerNum = (param._nPipeWorkerNum > 0) ? param._nPipeWorkerNum : 1;
+	int nConnPoolSize = (param._nConnPoolSize > nWorkerNum) ? param._nConnPoolSize : nWorkerNum;
+	int i, nConnNum;
 
-	//
-	_singleCommand.reserve(SINGLE_COMMAND_RESERVE_SIZE);
-	_allCommands.reserve(ALL_COMMANDS_RESERVE_SIZE);
+	// test cmsgpack -- register before any connection is opened, "_mapScript" is read only to pipe workers
+	std::string sTestcmsgpack("577017df0566f25df93daa49115c0290597c3c36");
+	_refParam._mapScript[sTestcmsgpack] = "local t={1,'abc2',3};local p=cmsgpack.pack(t);local u=cmsgpack.unpack(p);return {t,p,u}";
+
+	// spread pool connections over pipe workers
+	_vWorkerSlot.resize(nWorkerNum);
+	for (i = 0; i < nWorkerNum; ++i) {
+		nConnNum = nConnPoolSize / nWorkerNum + ((i < nConnPoolSize % nWorkerNum) ? 1 : 0);
+
+		worker_slot_t& slot = _vWorkerSlot[i];
+		slot._workQueue = std::make_shared<CKjRedisClientWorkQueue>(this, param, nConnNum);
+		slot._trunkQueue = std::make_shared<CRedisClientTrunkQueue>(this);
+		slot._vAutoBatch.resize(nConnNum);
+	}
 
 	//
 	StartPipeWorker();
@@ -41,7 +105,10 @@ CRedisClient::CRedisClient(redis_stub_param_t& param)
 
 */
 CRedisClient::~CRedisClient() noexcept {
-	_refPipeWorker = nullptr;
+	for (auto& slot : _vWorkerSlot) {
+		slot._workQueue->_refPipeWorker = nullptr;
+		slot._trunkQueue->_refPipeWorker = nullptr;
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -49,67 +116,281 @@ CRedisClient::~CRedisClient() noexcept {
 
 */
 void
-CRedisClient::Commit(redis_reply_cb_t&& rcb) {
+CRedisClient::Commit(redis_reply_cb_t&& rcb, uint32_t uCaller) {
+
+	worker_slot_t& slot = WorkerSlot(uCaller);
+	CRedisClientTrunkQueue *trunkQueue = slot._trunkQueue.get();
+	CKjRedisClientWorkQueue *workQueue = slot._workQueue.get();
+	command_buffer_t& buf = LocalCommandBuffer();
+
+	bool bMainRoute = false;
+	if (_bAutoPipeline
+		&& std::this_thread::get_id() == _mainThreadId) {
+
+		if (IsAutoPipelined(buf)) {
+			AddToAutoBatch(buf, std::move(rcb), uCaller);
+			return;
+		}
+
+		// flagged, it goes alone but behind the merged ones
+		FlushAutoPipeline();
+		bMainRoute = true;
+	}
+
+	auto workCb = std::bind([trunkQueue, workQueue](redis_reply_cb_t& reply_cb, CRedisReply&& reply) {
+		workQueue->Release();
 
-	auto workCb = std::bind([this](redis_reply_cb_t& reply_cb, CRedisReply& reply) {
 		if (reply_cb)
-			_trunkQueue->Add(std::move(reply_cb), std::move(reply));
+			deliver_reply(trunkQueue, workQueue, std::move(reply_cb), std::move(reply));
 	}, std::move(rcb), std::move(std::placeholders::_1));
 
 	auto cp = CKjRedisClientWorkQueue::CreateCmdPipeline(
 		++_nextSn,
-		_allCommands,
-		_builtNum,
+		std::move(buf._allCommands),
+		buf._builtNum,
 		std::move(workCb),
-		nullptr);
+		nullptr,
+		bMainRoute ? AUTO_PIPELINE_CALLER - (uint32_t)AutoLane(slot, uCaller) : uCaller);
+	TakePipelineFlags(buf, cp);
+
+	// may block, see "_eBackpressurePolicy"
+	workQueue->Admit(cp);
 
 #ifdef _DEBUG
-	if (_builtNum <= 0) {
+	if (buf._builtNum <= 0) {
 		throw CRedisError("[CRedisClient::Commit()] Nothing to commit!!!");
 	}
 #endif
 
-	_workQueue->Add(std::move(cp));
-	_allCommands.resize(0);
-	_builtNum = 0;
+	workQueue->Add(std::move(cp));
+	workQueue->TakeRecycledBuffer(buf._allCommands);
+	buf._builtNum = 0;
 }
 
 //------------------------------------------------------------------------------
 /**
 
 */
-CRedisReply
-CRedisClient::BlockingCommit() {
+IRedisClient::blocking_wait_t
+CRedisClient::BeginBlockingCommit(uint32_t uCaller) {
+
+#ifdef _DEBUG
+	if (std::this_thread::get_id() == _mainThreadId) {
+		// main thread should go through the callback overloads
+		uint64_t uCount = ++_nBlockingOnMainThread;
+		if (1 == uCount || 0 == uCount % 100) {
+			fprintf(stderr, "[CRedisClient::BlockingCommit()] %llu blocking commit(s) on main thread!!!\n",
+				(unsigned long long)uCount);
+		}
+	}
+#endif
+
+	worker_slot_t& slot = WorkerSlot(uCaller);
+	CKjRedisClientWorkQueue *workQueue = slot._workQueue.get();
+	command_buffer_t& buf = LocalCommandBuffer();
+
+	// behind the merged ones, on their route
+	bool bMainRoute = false;
+	if (_bAutoPipeline
+		&& std::this_thread::get_id() == _mainThreadId) {
+		FlushAutoPipeline();
+		bMainRoute = true;
+	}
+
+	// outlives the caller's frame until both the pipe worker and the waiter are done
+	struct blocking_t {
+		CRedisReply _reply;
+		std::promise<void> _prms;
+	};
+	auto blocking = std::make_shared<blocking_t>();
+	auto fut = blocking->_prms.get_future();
 
-	CRedisReply reply;
-	auto workCb = [this, &reply](CRedisReply&& r) {
-		reply = std::move(r);
+	auto workCb = [blocking, workQueue](CRedisReply&& r) {
+		workQueue->Release();
+		blocking->_reply = std::move(r);
 	};
 
-	auto prms = std::make_shared<std::promise<void>>();
-	auto disposeCb = [&prms]() {
-		prms->set_value();
+	auto disposeCb = [blocking]() {
+		blocking->_prms.set_value();
 	};
 
 	auto cp = CKjRedisClientWorkQueue::CreateCmdPipeline(
 		++_nextSn,
-		_allCommands,
-		_builtNum,
+		std::move(buf._allCommands),
+		buf._builtNum,
 		std::move(workCb),
-		std::move(disposeCb));
+		std::move(disposeCb),
+		bMainRoute ? AUTO_PIPELINE_CALLER - (uint32_t)AutoLane(slot, uCaller) : uCaller);
+	TakePipelineFlags(buf, cp);
+
+	// may block, see "_eBackpressurePolicy"
+	workQueue->Admit(cp);
 
 #ifdef _DEBUG
-	if (_builtNum <= 0) {
+	if (buf._builtNum <= 0) {
 		throw CRedisError("[CRedisClient::BlockingCommit()] Nothing to commit!!!");
 	}
 #endif
 
-	_workQueue->Add(std::move(cp));
-	_allCommands.resize(0);
-	_builtNum = 0;
+	workQueue->Add(std::move(cp));
+	workQueue->TakeRecycledBuffer(buf._allCommands);
+	buf._builtNum = 0;
+
+	auto sharedFut = fut.share();
+	return [blocking, sharedFut]() {
+		sharedFut.get();
+		return std::move(blocking->_reply);
+	};
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+CRedisFuture
+CRedisClient::AsyncCommit(uint32_t uCaller) {
+
+	CRedisFuture future;
+	Commit([future](CRedisReply&& reply) mutable {
+		future.Resolve(std::move(reply));
+	}, uCaller);
+	return future;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisClient::FlushAutoPipeline() {
+
+	size_t lane;
+	for (auto& slot : _vWorkerSlot) {
+		for (lane = 0; lane < slot._vAutoBatch.size(); ++lane) {
+			if (slot._vAutoBatch[lane]._builtNum > 0)
+				FlushAutoBatch(slot, lane);
+		}
+	}
+	_nAutoCommitNum = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+CRedisClient::IsAutoPipelined(const command_buffer_t& buf) const {
+	// flags are per pipeline, they do not merge
+	return !buf._bReplica
+		&& 0 == buf._timeoutMs
+		&& !buf._elementCb
+		&& !buf._chunkCb;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisClient::AddToAutoBatch(command_buffer_t& buf, redis_reply_cb_t&& rcb, uint32_t uCaller) {
+
+#ifdef _DEBUG
+	if (buf._builtNum <= 0) {
+		throw CRedisError("[CRedisClient::Commit()] Nothing to commit!!!");
+	}
+#endif
+
+	worker_slot_t& slot = WorkerSlot(uCaller);
+	size_t lane = AutoLane(slot, uCaller);
+	auto_batch_t& batch = slot._vAutoBatch[lane];
+	uint32_t uWindowMs = _refParam._nAutoPipelineWindowMs;
+
+	if (0 == _nAutoCommitNum
+		&& uWindowMs > 0)
+		_tpAutoFirst = std::chrono::steady_clock::now();
+
+	// the commands are copied, "buf" keeps its capacity for the next commit
+	batch._allCommands.append(buf._allCommands);
+	batch._builtNum += buf._builtNum;
+	batch._vEnd.push_back(batch._builtNum);
+	batch._vReplyCb.emplace_back(std::move(rcb));
+	++_nAutoCommitNum;
+
+	buf._allCommands.resize(0);
+	buf._builtNum = 0;
+	buf._bReadOnly = true;
 
-	prms->get_future().get();
-	return reply;
+	if (batch._allCommands.length() >= _refParam._nCommitBatchBytes) {
+		FlushAutoBatch(slot, lane);
+	}
+	else if (uWindowMs > 0
+		&& std::chrono::steady_clock::now() - _tpAutoFirst >= std::chrono::milliseconds(uWindowMs)) {
+		FlushAutoPipeline();
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisClient::FlushAutoBatch(worker_slot_t& slot, size_t lane) {
+
+	CRedisClientTrunkQueue *trunkQueue = slot._trunkQueue.get();
+	CKjRedisClientWorkQueue *workQueue = slot._workQueue.get();
+	auto_batch_t& batch = slot._vAutoBatch[lane];
+
+	auto replies = std::make_shared<auto_batch_replies_t>();
+	replies->_vEnd.swap(batch._vEnd);
+	replies->_vReplyCb.swap(batch._vReplyCb);
+	_nAutoCommitNum -= (int)replies->_vEnd.size();
+
+	auto workCb = [replies, trunkQueue, workQueue](CRedisReply&& reply) {
+		workQueue->Release();
+		replies->OnTail(trunkQueue, workQueue, std::move(reply));
+	};
+
+	auto cp = CKjRedisClientWorkQueue::CreateCmdPipeline(
+		++_nextSn,
+		std::move(batch._allCommands),
+		batch._builtNum,
+		std::move(workCb),
+		nullptr,
+		AUTO_PIPELINE_CALLER - (uint32_t)lane);
+	cp._timeout_ms = _refParam._nPipelineTimeoutMs;
+
+	// one admission for all of them, may block, see "_eBackpressurePolicy"
+	workQueue->Admit(cp);
+
+	cp._vSegmentEnd = replies->_vEnd;
+	cp._segment_cb = [replies, trunkQueue](int nth, CRedisReply&& reply) {
+		replies->OnSegment(trunkQueue, nth, std::move(reply));
+	};
+
+	workQueue->Add(std::move(cp));
+	workQueue->TakeRecycledBuffer(batch._allCommands);
+	batch._builtNum = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisClient::GetStats(redis_client_stats_t& stats) {
+
+	stats = redis_client_stats_t();
+
+	for (auto& slot : _vWorkerSlot) {
+		CKjRedisClientWorkQueue::counters_t& counters = slot._workQueue->Counters();
+
+		stats._pendingNum += counters._pendingNum.load(std::memory_order_relaxed);
+		stats._inflightBytes += counters._inflightBytes.load(std::memory_order_relaxed);
+		stats._blockedNum += counters._blockedNum.load(std::memory_order_relaxed);
+		stats._failedNum += counters._failedNum.load(std::memory_order_relaxed);
+		stats._droppedNum += counters._droppedNum.load(std::memory_order_relaxed);
+		stats._heldWriteNum += counters._heldWriteNum.load(std::memory_order_relaxed);
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -118,8 +399,35 @@ CRedisClient::BlockingCommit() {
 */
 void
 CRedisClient::Shutdown() {
-	_workQueue->Finish();
-	_trunkQueue->Close();
+	for (auto& slot : _vWorkerSlot) {
+		slot._workQueue->Finish();
+		slot._trunkQueue->Close();
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+CRedisClient::command_buffer_t&
+CRedisClient::LocalCommandBuffer() {
+	// last used buffer is cached, most threads only talk to one client
+	static thread_local uint64_t stl_last_client_id = 0;
+	static thread_local command_buffer_t *stl_last_buffer = nullptr;
+
+	if (stl_last_client_id == _clientId) {
+		return *stl_last_buffer;
+	}
+
+	auto it = stl_command_buffers.find(_clientId);
+	if (it == stl_command_buffers.end()) {
+		it = stl_command_buffers.emplace(_clientId, command_buffer_t()).first;
+		(*it).second._allCommands.reserve(ALL_COMMANDS_RESERVE_SIZE);
+	}
+
+	stl_last_client_id = _clientId;
+	stl_last_buffer = &(*it).second;
+	return *stl_last_buffer;
 }
 
 //------------------------------------------------------------------------------
@@ -128,16 +436,24 @@ CRedisClient::Shutdown() {
 */
 void
 CRedisClient::StartPipeWorker() {
-	// create pipe thread
-	_refPipeWorker = redis_get_servercore()->NewPipeWorker(
-		"redis client pipeworker",
-		_trunkOpCodeRecvBuf,
-		sizeof(_trunkOpCodeRecvBuf),
-		[this](size_t amount) { _trunkQueue->RunOnce();	},
-		[this](svrcore_pipeworker_t *worker) {
-		// work
-		_workQueue->Run(worker);
-	});
+	// create pipe thread for each worker slot
+	for (auto& slot : _vWorkerSlot) {
+		CRedisClientTrunkQueue *trunkQueue = slot._trunkQueue.get();
+		CKjRedisClientWorkQueue *workQueue = slot._workQueue.get();
+
+		svrcore_pipeworker_t *worker = redis_get_servercore()->NewPipeWorker(
+			"redis client pipeworker",
+			trunkQueue->_opCodeRecvBuf,
+			sizeof(trunkQueue->_opCodeRecvBuf),
+			[trunkQueue](size_t amount) { trunkQueue->RunOnce(); },
+			[workQueue](svrcore_pipeworker_t *worker) {
+			// work
+			workQueue->Run(worker);
+		});
+
+		workQueue->_refPipeWorker = worker;
+		trunkQueue->_refPipeWorker = worker;
+	}
 }
 
 /** -- EOF -- **/
\ No newline at end of file
@@ -7,6 +7,16 @@
 */
 #include <vector>
 #include <string>
+#include <type_traits>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+//! non-owning string argument
+struct redis_string_piece_t {
+	const char *_data;
+	size_t _size;
+};
 
 //------------------------------------------------------------------------------
 /**
@@ -30,6 +40,175 @@ public:
 		return sOutSingleCommand;
 	}
 
+	//! encode one command straight into the pipeline buffer, args may be std::string, string literal,
+	//! redis_string_piece_t, integer, double or std::vector<std::string> (expanded in place)
+	template<typename... Args>
+	static void					Encode(std::string& sOutAllCommands, int& nOutBuiltNum, const Args&... args) {
+		sOutAllCommands.reserve(sOutAllCommands.length() + EstimateBytes(args...));
+		AppendHeader(sOutAllCommands, '*', CountArgs(args...));
+		AppendArgs(sOutAllCommands, args...);
+		++nOutBuiltNum;
+	}
+
+	//! write decimal digits of "v" backwards from "end", returns the first digit
+	static char *				FormatUInt(uint64_t v, char *end) {
+		static const char s_digits[] =
+			"00010203040506070809"
+			"10111213141516171819"
+			"20212223242526272829"
+			"30313233343536373839"
+			"40414243444546474849"
+			"50515253545556575859"
+			"60616263646566676869"
+			"70717273747576777879"
+			"80818283848586878889"
+			"90919293949596979899";
+
+		char *p = end;
+		while (v >= 100) {
+			unsigned idx = (unsigned)(v % 100) * 2;
+			v /= 100;
+			*--p = s_digits[idx + 1];
+			*--p = s_digits[idx];
+		}
+
+		if (v >= 10) {
+			unsigned idx = (unsigned)v * 2;
+			*--p = s_digits[idx + 1];
+			*--p = s_digits[idx];
+		}
+		else {
+			*--p = (char)('0' + v);
+		}
+		return p;
+	}
+
+	static char *				FormatInt(int64_t v, char *end) {
+		if (v < 0) {
+			char *p = FormatUInt(0 - (uint64_t)v, end);
+			*--p = '-';
+			return p;
+		}
+		return FormatUInt((uint64_t)v, end);
+	}
+
+private:
+	//! "*<n>\r\n" or "$<n>\r\n"
+	static void					AppendHeader(std::string& sOut, char chLeading, size_t n) {
+		char chBuf[32];
+		char *end = chBuf + sizeof(chBuf);
+		*--end = '\n';
+		*--end = '\r';
+		char *p = FormatUInt(n, end);
+		*--p = chLeading;
+		sOut.append(p, chBuf + sizeof(chBuf) - p);
+	}
+
+	static void					AppendBulk(std::string& sOut, const char *data, size_t size) {
+		AppendHeader(sOut, '$', size);
+		sOut.append(data, size).append("\r\n", 2);
+	}
+
+	//! arg count
+	static size_t				CountArgs() {
+		return 0;
+	}
+
+	template<typename T, typename... Args>
+	static size_t				CountArgs(const T& arg, const Args&... args) {
+		return CountOne(arg) + CountArgs(args...);
+	}
+
+	template<typename T>
+	static size_t				CountOne(const T&) {
+		return 1;
+	}
+
+	static size_t				CountOne(const std::vector<std::string>& v) {
+		return v.size();
+	}
+
+	//! reserve hint, header overhead is 16 bytes at most for each arg
+	static size_t				EstimateBytes() {
+		return 16;
+	}
+
+	template<typename T, typename... Args>
+	static size_t				EstimateBytes(const T& arg, const Args&... args) {
+		return EstimateOne(arg) + EstimateBytes(args...);
+	}
+
+	static size_t				EstimateOne(const std::string& s) {
+		return s.length() + 16;
+	}
+
+	static size_t				EstimateOne(const redis_string_piece_t& s) {
+		return s._size + 16;
+	}
+
+	static size_t				EstimateOne(const char *s) {
+		return strlen(s) + 16;
+	}
+
+	static size_t				EstimateOne(const std::vector<std::string>& v) {
+		size_t sz = 0;
+		for (const auto& s : v) {
+			sz += s.length() + 16;
+		}
+		return sz;
+	}
+
+	template<typename T>
+	static size_t				EstimateOne(const T&) {
+		// number
+		return 48;
+	}
+
+	//! args
+	static void					AppendArgs(std::string&) {
+	}
+
+	template<typename T, typename... Args>
+	static void					AppendArgs(std::string& sOut, const T& arg, const Args&... args) {
+		AppendOne(sOut, arg);
+		AppendArgs(sOut, args...);
+	}
+
+	static void					AppendOne(std::string& sOut, const std::string& s) {
+		AppendBulk(sOut, s.data(), s.length());
+	}
+
+	static void					AppendOne(std::string& sOut, const redis_string_piece_t& s) {
+		AppendBulk(sOut, s._data, s._size);
+	}
+
+	static void					AppendOne(std::string& sOut, const char *s) {
+		AppendBulk(sOut, s, strlen(s));
+	}
+
+	static void					AppendOne(std::string& sOut, const std::vector<std::string>& v) {
+		for (const auto& s : v) {
+			AppendBulk(sOut, s.data(), s.length());
+		}
+	}
+
+	template<typename T>
+	static typename std::enable_if<std::is_integral<T>::value>::type
+								AppendOne(std::string& sOut, const T& v) {
+		char chBuf[24];
+		char *end = chBuf + sizeof(chBuf);
+		char *p = std::is_signed<T>::value ? FormatInt((int64_t)v, end) : FormatUInt((uint64_t)v, end);
+		AppendBulk(sOut, p, end - p);
+	}
+
+	template<typename T>
+	static typename std::enable_if<std::is_floating_point<T>::value>::type
+								AppendOne(std::string& sOut, const T& v) {
+		char chBuf[48];
+		int n = snprintf(chBuf, sizeof(chBuf), "%.17g", (double)v);
+		AppendBulk(sOut, chBuf, (size_t)n);
+	}
+
 };
 
 /*EOF*/
\ No newline at end of file
@@ -9,6 +9,16 @@
 #include "RedisClient.h"
 #include "RedisSubscriber.h"
 
+#include "base/RedisCacheProxy.h"
+
+#ifdef __cplusplus 
+extern "C" {
+#endif 
+#include "base/rdb_parser/rdb_object_builder.h"
+#ifdef __cplusplus 
+}
+#endif 
+
 #ifdef _MSC_VER
 #ifdef _DEBUG
 #define new   new(_NORMAL_BLOCK, __FILE__,__LINE__)
@@ -27,6 +37,19 @@ __on_got_rdb_object(rdb_object_t *r, void *payload) {
 	return host->_cb(r);
 }
 
+/* one per DumpedDataSink(), shared by the sink and gone with its pipeline */
+struct __parse_dumped_data_sink_t {
+	__parse_dumped_data_host_t _host;
+	rdb_parser_t *_rp = nullptr;
+	std::function<void(int)> _overCb;
+	bool _bFailed = false;
+
+	~__parse_dumped_data_sink_t() {
+		if (_rp)
+			destroy_rdb_parser(_rp);
+	}
+};
+
 //------------------------------------------------------------------------------
 /**
 
@@ -39,9 +62,55 @@ CRedisService::CRedisService(void *servercore, redis_stub_param_t *param)
 	//
 	redis_init_servercore(servercore);
 
-	//
-	_redisClient = new CRedisClient(_param);
-	_redisSubscriber = new CRedisSubscriber(_param);
+	// near cache -- before any connection is created. RESP2 redirects tracking to one subscriber
+	// client id, which can not cover the connections of other shards
+	if (_param._nNearCacheBytes > 0
+		&& _param._vShard.size() > 1
+		&& _param._nProtocol < 3) {
+		fprintf(stderr, "[CRedisService::CRedisService()] near cache over %d shards needs \"_nProtocol\" 3, near cache is off!!!\n",
+			(int)_param._vShard.size());
+		_param._nNearCacheBytes = 0;
+	}
+
+	if (_param._nNearCacheBytes > 0) {
+		_nearCache = new CRedisNearCache(_param._nNearCacheBytes);
+		_param._refNearCache = _nearCache;
+
+		// RESP3 tracks on the reading connection itself, RESP2 waits for the subscriber's client id
+		if (_param._nProtocol >= 3)
+			_nearCache->SetTrackingRedirectId(CRedisNearCache::TRACKING_SELF);
+	}
+
+	if (_param._nWriteBehindMs > 0)
+		_writeBehind = new CRedisWriteBehind(_param._nWriteBehindMs);
+
+	// shards -- a single one at "_ip" and "_port" without "_vShard"
+	std::vector<redis_shard_endpoint_t> vEndpoint = _param._vShard;
+	if (vEndpoint.empty() || _param._bCluster) {
+		redis_shard_endpoint_t endpoint;
+		endpoint._ip = _param._ip;
+		endpoint._port = _param._port;
+		endpoint._vReplica = _param._vReplica;
+		vEndpoint.assign(1, endpoint);
+	}
+
+	_vShard.reserve(vEndpoint.size());
+	for (auto& endpoint : vEndpoint) {
+		_vShard.resize(_vShard.size() + 1);
+		shard_t& shard = _vShard.back();
+		shard._param = _param;
+		shard._param._ip = endpoint._ip;
+		shard._param._port = endpoint._port;
+		shard._param._vShard.clear();
+		shard._param._vReplica = _param._bCluster ? std::vector<redis_endpoint_t>() : endpoint._vReplica;
+
+		_ring.Add(endpoint._ip, endpoint._port);
+	}
+
+	for (auto& shard : _vShard) {
+		shard._redisClient = new CRedisClient(shard._param);
+		shard._redisSubscriber = new CRedisSubscriber(shard._param);
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -50,8 +119,12 @@ CRedisService::CRedisService(void *servercore, redis_stub_param_t *param)
 */
 CRedisService::~CRedisService() noexcept {
 
-	delete _redisClient;
-	delete _redisSubscriber;
+	for (auto& shard : _vShard) {
+		delete shard._redisClient;
+		delete shard._redisSubscriber;
+	}
+	delete _nearCache;
+	delete _writeBehind;
 
 	destroy_rdb_parser(_rp);
 
@@ -73,15 +146,64 @@ CRedisService::ParseDumpedData(const std::string& sDump, std::function<int(rdb_o
 //------------------------------------------------------------------------------
 /**
 
+*/
+redis_bulk_chunk_cb_t
+CRedisService::DumpedDataSink(std::function<int(rdb_object_t *)>&& cb, std::function<void(int)>&& overCb) {
+	auto sink = std::make_shared<__parse_dumped_data_sink_t>();
+	sink->_host._cb = std::move(cb);
+	sink->_overCb = std::move(overCb);
+	sink->_rp = create_rdb_parser();
+	rdb_parse_dumped_data_begin(sink->_rp, __on_got_rdb_object, &sink->_host);
+
+	return [sink](const char *data, size_t len, size_t remain) {
+		if (sink->_bFailed)
+			return;
+
+		// premature only means the rest is still to come -- unless it is the last piece
+		int rc = rdb_parse_dumped_data_feed(sink->_rp, data, len, remain);
+		if (rc < 0
+			&& (rc != OB_ERROR_PREMATURE || 0 == remain)) {
+			fprintf(stderr, "[CRedisService::DumpedDataSink()] parse dumped data failed, errcode = %d!!!\n", rc);
+			sink->_bFailed = true;
+
+			if (sink->_overCb)
+				sink->_overCb(rc);
+			return;
+		}
+
+		if (0 == remain
+			&& sink->_overCb)
+			sink->_overCb(rc);
+	};
+}
+
+//------------------------------------------------------------------------------
+/**
+
 */
 void
 CRedisService::Shutdown() {
 	if (!_bShutdown) {
 		_bShutdown = true;
 
-		_redisClient->Shutdown();
-		_redisSubscriber->Shutdown();
+		// pending writes go out before the connections close
+		if (_writeBehind)
+			FlushWriteBehind();
+
+		for (auto& shard : _vShard) {
+			shard._redisClient->Shutdown();
+			shard._redisSubscriber->Shutdown();
+		}
 	}
 }
 
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisService::FlushWriteBehind() {
+	CRedisCacheProxy::FlushWriteBehind(this);
+}
+
 /** -- EOF -- **/
\ No newline at end of file
@@ -64,7 +64,7 @@ CCamelReaderWriterQueue::Close() {
 
 */
 bool
-CCamelReaderWriterQueue::Add(std::function<void()>&& workCb) {
+CCamelReaderWriterQueue::Add(CallbackEntry&& workCb) {
 	if (_close) {
 		// error
 		fprintf(stderr, "[CCamelWorkQueue::Add()] can't enqueue, callback is dropped!!!");
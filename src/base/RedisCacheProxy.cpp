@@ -6,6 +6,7 @@
 
 #include "redis_service_def.h"
 #include "IRedisService.h"
+#include "RedisError.h"
 
 static int
 __split(const char *str, int str_len, char **av, int av_max, char c) {
@@ -55,6 +56,28 @@ static std::map<std::string, std::string> s_mapScript = {
 	{ s_sBatchGet,				"local r,i,v;r={};for i,v in ipairs(KEYS) do if '*'==ARGV[i] then table.insert(r,redis.call('HGETALL',v)) else table.insert(r,redis.call('HGET',v,ARGV[i])) end;end;return r" },
 };
 
+static void
+__encode_write(IRedisClient& client, CRedisWriteBehind::object_t& obj, const std::string& sField, CRedisWriteBehind::write_t& w) {
+	std::vector<std::string> vKey{ obj._sIdHash, obj._sIdHashOfDirty, obj._sIdHashOfDirtyState, obj._sDirtyEntry };
+	std::vector<std::string> vArg{ sField };
+
+	switch (w._op) {
+	case CRedisWriteBehind::WRITE_ADD:
+		vArg.emplace_back(std::move(w._sValue));
+		client.EvalSha(s_sAddToHashTable, vKey, vArg);
+		break;
+
+	case CRedisWriteBehind::WRITE_REMOVE:
+		client.EvalSha(s_sRemoveFromHashTable, vKey, vArg);
+		break;
+
+	default:
+		vArg.emplace_back(std::move(w._sValue));
+		client.EvalSha(s_sUpdateToHashTable, vKey, vArg);
+		break;
+	}
+}
+
 //------------------------------------------------------------------------------
 /**
 
@@ -66,8 +89,17 @@ CRedisCacheProxy::CRedisCacheProxy(void *service_entry, const char *sMainId, con
 	, _sSubid(sSubid)
 	, _sIdHash(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":H")
 	, _sIdHashOfDirty(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":D_H")
-	, _sIdHashOfDirtyState(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":DS_H") {
-	
+	, _sIdHashOfDirtyState(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":DS_H")
+	, _uCaller(redis_caller_id(_sIdHash))
+	, _uShardHash(CRedisShardRing::KeyHash(_sModuleName + ":" + _sMainId + ":" + _sSubid)) {
+	// the scripts touch ":H", ":D_H", ":DS_H" and the dirty entry in one call, they are not in one hash slot
+	if ((static_cast<redis_service_entry_t *>(service_entry))->_param._bCluster) {
+		std::string sDesc = "[CRedisCacheProxy::CRedisCacheProxy()] not for redis cluster, module(";
+		sDesc += _sModuleName;
+		sDesc += ")!!!";
+		fprintf(stderr, "%s\n", sDesc.c_str());
+		throw CRedisError(sDesc.c_str());
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -81,7 +113,9 @@ CRedisCacheProxy::CRedisCacheProxy(const std::string& sModuleName, const char *s
 	, _sSubid(sSubid)
 	, _sIdHash(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":H")
 	, _sIdHashOfDirty(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":D_H")
-	, _sIdHashOfDirtyState(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":DS_H") {
+	, _sIdHashOfDirtyState(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":DS_H")
+	, _uCaller(redis_caller_id(_sIdHash))
+	, _uShardHash(CRedisShardRing::KeyHash(_sModuleName + ":" + _sMainId + ":" + _sSubid)) {
 
 }
 
@@ -98,31 +132,40 @@ CRedisCacheProxy::~CRedisCacheProxy() {
 
 */
 void
-CRedisCacheProxy::Clear() {
+CRedisCacheProxy::DispatchClear(bool bBlocking, done_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	InvalidateNearCache(redisservice);
+	EncodeWriteBehind(redisservice);
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sClear,
 		std::vector<std::string>{ _sIdHash, _sIdHashOfDirty, _sIdHashOfDirtyState, entry->_cacheDirtyEntry },
 		std::vector<std::string>{ }
 	);
-	
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_null()) {
-		// null means false
-		fprintf(stderr, "[CRedisCacheProxy::Clear()] cache(%s) is dirty, you must dump the changes to db first before clear it!!!!",
-			_sIdHash.c_str());
-		system("pause");
-		exit(-1);
-	}
-	else if (reply.is_error()) {
-		std::string sDesc = "[CRedisCacheProxy::Clear()] error(";
-		sDesc += reply.error_desc().c_str();
-		sDesc += ")!!!";
-		throw std::exception(sDesc.c_str());
-	}
+
+	std::string sIdHash = _sIdHash;
+	redis_reply_cb_t rcb = std::bind([sIdHash](done_cb_t& cb, CRedisReply&& reply) {
+		if (reply.ok()
+			&& reply.is_null()) {
+			// null means false
+			fprintf(stderr, "[CRedisCacheProxy::Clear()] cache(%s) is dirty, you must dump the changes to db first before clear it!!!!",
+				sIdHash.c_str());
+			system("pause");
+			exit(-1);
+		}
+		else if (reply.is_error()) {
+			std::string sDesc = "[CRedisCacheProxy::Clear()] error(";
+			sDesc += reply.error_desc().c_str();
+			sDesc += ")!!!";
+			throw std::exception(sDesc.c_str());
+		}
+
+		if (cb)
+			cb();
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
@@ -133,7 +176,14 @@ void
 CRedisCacheProxy::Commit() {
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().Commit(nullptr);
+
+	// buffered writes wait for the flush, only SetToHashTable() left something to commit
+	if (redisservice->WriteBehind()
+		&& !_bBuilt)
+		return;
+
+	_bBuilt = false;
+	redisservice->ShardClientOf(_uShardHash).Commit(nullptr, _uCaller);
 }
 
 //------------------------------------------------------------------------------
@@ -145,7 +195,10 @@ CRedisCacheProxy::SetToHashTable(const std::string& sId, std::string& sValue) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().HSet(_sIdHash.c_str(), sId.c_str(), sValue);
+	InvalidateNearCache(redisservice);
+	EncodeWriteBehind(redisservice);
+	_bBuilt = true;
+	redisservice->ShardClientOf(_uShardHash).HSet(_sIdHash.c_str(), sId.c_str(), sValue);
 }
 
 //------------------------------------------------------------------------------
@@ -157,7 +210,16 @@ CRedisCacheProxy::AddToHashTable(const std::string& sId, std::string& sValue) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	InvalidateNearCache(redisservice);
+
+	CRedisWriteBehind *writeBehind = redisservice->WriteBehind();
+	if (writeBehind) {
+		writeBehind->Put(_sIdHash, _sIdHashOfDirty, _sIdHashOfDirtyState, entry->_cacheDirtyEntry, _uShardHash, _uCaller,
+			sId, CRedisWriteBehind::WRITE_ADD, std::move(sValue));
+		return;
+	}
+
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sAddToHashTable,
 		std::vector<std::string>{ _sIdHash, _sIdHashOfDirty, _sIdHashOfDirtyState, entry->_cacheDirtyEntry },
 		std::vector<std::string>{ sId, std::move(sValue) }
@@ -173,7 +235,16 @@ CRedisCacheProxy::RemoveFromHashTable(const std::string& sId) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	InvalidateNearCache(redisservice);
+
+	CRedisWriteBehind *writeBehind = redisservice->WriteBehind();
+	if (writeBehind) {
+		writeBehind->Put(_sIdHash, _sIdHashOfDirty, _sIdHashOfDirtyState, entry->_cacheDirtyEntry, _uShardHash, _uCaller,
+			sId, CRedisWriteBehind::WRITE_REMOVE, std::string());
+		return;
+	}
+
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sRemoveFromHashTable,
 		std::vector<std::string>{ _sIdHash, _sIdHashOfDirty, _sIdHashOfDirtyState, entry->_cacheDirtyEntry },
 		std::vector<std::string>{ sId }
@@ -189,7 +260,16 @@ CRedisCacheProxy::UpdateToHashTable(const std::string& sId, std::string& sValue)
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	InvalidateNearCache(redisservice);
+
+	CRedisWriteBehind *writeBehind = redisservice->WriteBehind();
+	if (writeBehind) {
+		writeBehind->Put(_sIdHash, _sIdHashOfDirty, _sIdHashOfDirtyState, entry->_cacheDirtyEntry, _uShardHash, _uCaller,
+			sId, CRedisWriteBehind::WRITE_UPDATE, std::move(sValue));
+		return;
+	}
+
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sUpdateToHashTable,
 		std::vector<std::string>{ _sIdHash, _sIdHashOfDirty, _sIdHashOfDirtyState, entry->_cacheDirtyEntry },
 		std::vector<std::string>{ sId, std::move(sValue) }
@@ -205,36 +285,78 @@ CRedisCacheProxy::Set(const std::string& sId, std::string& sValue) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().HSet(_sIdHash.c_str(), sId.c_str(), sValue);
-	redisservice->Client().Commit(nullptr);
+	InvalidateNearCache(redisservice);
+	EncodeWriteBehind(redisservice);
+	redisservice->ShardClientOf(_uShardHash).HSet(_sIdHash.c_str(), sId.c_str(), sValue);
+	redisservice->ShardClientOf(_uShardHash).Commit(nullptr, _uCaller);
 }
 
 //------------------------------------------------------------------------------
 /**
 
 */
-const std::string
-CRedisCacheProxy::Get(const std::string& sId) {
+void
+CRedisCacheProxy::DispatchGet(const std::string& sId, bool bBlocking, string_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().HGet(_sIdHash.c_str(), sId.c_str());
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_string()) {
-		//
-		return reply.as_string();
+	// pending write calls back at once
+	CRedisWriteBehind *writeBehind = redisservice->WriteBehind();
+	if (writeBehind) {
+		std::string sOut;
+		if (writeBehind->Lookup(_sIdHash, sId, sOut)) {
+			if (cb)
+				cb(sOut);
+			return;
+		}
 	}
-	else if (reply.is_error()) {
-		std::string sDesc = "[CRedisCacheProxy::Get()] id(";
-		sDesc += sId.c_str();
-		sDesc += ") -- error(";
-		sDesc += reply.error_desc().c_str();
-		sDesc += ")!!!";
-		throw std::exception(sDesc.c_str());
+
+	// near cache hit calls back at once
+	CRedisNearCache *nearCache = redisservice->NearCache();
+	uint64_t uEpoch = 0;
+	if (nearCache) {
+		std::string sOut;
+		if (nearCache->Lookup(_sIdHash, sId, sOut)) {
+			if (cb)
+				cb(sOut);
+			return;
+		}
+		uEpoch = nearCache->Epoch();
 	}
-	return "";
+
+	redisservice->ShardClientOf(_uShardHash).HGet(_sIdHash.c_str(), sId.c_str());
+
+	// replica connections are not tracked, fills of the near cache must come from the master
+	if (_bReadFromReplica
+		&& !nearCache)
+		redisservice->ShardClientOf(_uShardHash).ReadFromReplica();
+
+	std::string sIdHash = nearCache ? _sIdHash : std::string();
+	redis_reply_cb_t rcb = std::bind([nearCache, uEpoch, sIdHash, sId](string_cb_t& cb, CRedisReply&& reply) {
+		std::string sOut;
+		if (reply.ok()
+			&& reply.is_string()) {
+			//
+			sOut = std::move(reply.as_string());
+
+			if (nearCache)
+				nearCache->Store(sIdHash, sId, sOut, uEpoch);
+		}
+		else if (reply.is_error()) {
+			std::string sDesc = "[CRedisCacheProxy::Get()] id(";
+			sDesc += sId.c_str();
+			sDesc += ") -- error(";
+			sDesc += reply.error_desc().c_str();
+			sDesc += ")!!!";
+			throw std::exception(sDesc.c_str());
+		}
+
+		if (cb)
+			cb(sOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
@@ -242,24 +364,35 @@ CRedisCacheProxy::Get(const std::string& sId) {
 
 */
 void
-CRedisCacheProxy::GetAll(RESULT_PAIR_LIST& vOut) {
+CRedisCacheProxy::DispatchGetAll(bool bBlocking, result_list_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().HGetAll(_sIdHash.c_str());
+	EncodeWriteBehind(redisservice);
+	redisservice->ShardClientOf(_uShardHash).HGetAll(_sIdHash.c_str());
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_array()) {
-		//
-		vOut = std::move(reply.as_array());
-	}
-	else if (reply.is_error()) {
-		std::string sDesc = "[CRedisCacheProxy::GetAll()] error(";
-		sDesc += reply.error_desc().c_str();
-		sDesc += ")!!!";
-		throw std::exception(sDesc.c_str());
-	}
+	if (_bReadFromReplica)
+		redisservice->ShardClientOf(_uShardHash).ReadFromReplica();
+
+	redis_reply_cb_t rcb = std::bind([](result_list_cb_t& cb, CRedisReply&& reply) {
+		std::vector<CRedisReply> vOut;
+		if (reply.ok()
+			&& reply.is_array()) {
+			//
+			vOut = std::move(reply.as_array());
+		}
+		else if (reply.is_error()) {
+			std::string sDesc = "[CRedisCacheProxy::GetAll()] error(";
+			sDesc += reply.error_desc().c_str();
+			sDesc += ")!!!";
+			throw std::exception(sDesc.c_str());
+		}
+
+		if (cb)
+			cb(vOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
@@ -267,27 +400,92 @@ CRedisCacheProxy::GetAll(RESULT_PAIR_LIST& vOut) {
 
 */
 void
-CRedisCacheProxy::GetPartitial(int nCount, RESULT_PAIR_LIST& vOut) {
+CRedisCacheProxy::DispatchGetPartitial(int nCount, bool bBlocking, result_list_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	EncodeWriteBehind(redisservice);
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sGetPartitial,
 		std::vector<std::string>{ _sIdHash },
 		std::vector<std::string>{ std::to_string(nCount) }
 	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_array()) {
-		//
-		vOut = std::move(reply.as_array());
+	redis_reply_cb_t rcb = std::bind([](result_list_cb_t& cb, CRedisReply&& reply) {
+		std::vector<CRedisReply> vOut;
+		if (reply.ok()
+			&& reply.is_array()) {
+			//
+			vOut = std::move(reply.as_array());
+		}
+		else if (reply.is_error()) {
+			std::string sDesc = "[CRedisCacheProxy::GetPartitial()] error(";
+			sDesc += reply.error_desc().c_str();
+			sDesc += ")!!!";
+			throw std::exception(sDesc.c_str());
+		}
+
+		if (cb)
+			cb(vOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisCacheProxy::InvalidateNearCache(IRedisService *redisservice) {
+	// our own write is seen at once, without waiting for the tracking invalidation
+	CRedisNearCache *nearCache = redisservice->NearCache();
+	if (nearCache)
+		nearCache->Invalidate(_sIdHash);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisCacheProxy::EncodeWriteBehind(IRedisService *redisservice) {
+	// pending writes of the object go ahead in the pipeline being built, the command after them sees them
+	CRedisWriteBehind *writeBehind = redisservice->WriteBehind();
+	CRedisWriteBehind::object_t obj;
+	if (!writeBehind
+		|| !writeBehind->Take(_sIdHash, obj))
+		return;
+
+	IRedisClient& client = redisservice->ShardClientOf(_uShardHash);
+	for (auto& it : obj._mapWrite) {
+		__encode_write(client, obj, it.first, it.second);
 	}
-	else if (reply.is_error()) {
-		std::string sDesc = "[CRedisCacheProxy::GetPartitial()] error(";
-		sDesc += reply.error_desc().c_str();
-		sDesc += ")!!!";
-		throw std::exception(sDesc.c_str());
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisCacheProxy::FlushWriteBehind(IRedisService *redisservice) {
+
+	CRedisWriteBehind *writeBehind = redisservice->WriteBehind();
+	if (!writeBehind
+		|| writeBehind->IsEmpty())
+		return;
+
+	CRedisWriteBehind::object_map_t mapObject;
+	writeBehind->TakeAll(mapObject);
+
+	// committed with the caller of the object: ordered with its direct commands, sent before and after
+	for (auto& it : mapObject) {
+		CRedisWriteBehind::object_t& obj = it.second;
+		IRedisClient& client = redisservice->ShardClientOf(obj._uShardHash);
+		for (auto& itWrite : obj._mapWrite) {
+			__encode_write(client, obj, itWrite.first, itWrite.second);
+		}
+		client.Commit(nullptr, obj._uCaller);
 	}
 }
 
@@ -312,28 +510,54 @@ CRedisCacheProxy::SplitIdHash(const std::string& sIdHash, std::string& sOutModul
 
 */
 void
-CRedisCacheProxy::LootDirtyEntry(void *service_entry, DIRTY_ENTRY_LIST& vOut) {
+CRedisCacheProxy::DispatchLootDirtyEntry(void *service_entry, bool bBlocking, result_list_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(service_entry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
-		s_sLootDirtyEntry,
-		std::vector<std::string>{ entry->_cacheDirtyEntry },
-		std::vector<std::string>{ }
-	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_array()) {
-		//
-		vOut = std::move(reply.as_array());
-	}
-	else if (reply.is_error()) {
-		std::string sDesc = "[CRedisCacheProxy::LootDirtyEntry()] error(";
-		sDesc += reply.error_desc().c_str();
-		sDesc += ")!!!";
-		throw std::exception(sDesc.c_str());
+	// a flushed write not looted this time stays dirty for the next one
+	FlushWriteBehind(redisservice);
+
+	// every shard keeps the dirty entries of its own hashes
+	std::vector<IRedisClient *> vClient;
+	size_t i;
+	for (i = 0; i < redisservice->ShardNum(); ++i) {
+		IRedisClient& client = redisservice->ShardClient(i);
+		client.EvalSha(
+			s_sLootDirtyEntry,
+			std::vector<std::string>{ entry->_cacheDirtyEntry },
+			std::vector<std::string>{ }
+		);
+		vClient.emplace_back(&client);
 	}
+
+	auto fcb = std::bind([](result_list_cb_t& cb, std::vector<CRedisReply>& vReply) {
+		std::vector<CRedisReply> vOut;
+		for (auto& reply : vReply) {
+			if (reply.ok()
+				&& reply.is_array()) {
+				//
+				std::vector<CRedisReply>& v = reply.as_array();
+				if (vOut.empty()) {
+					vOut = std::move(v);
+				}
+				else {
+					vOut.insert(vOut.end(), std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()));
+				}
+			}
+			else if (reply.is_error()) {
+				std::string sDesc = "[CRedisCacheProxy::LootDirtyEntry()] error(";
+				sDesc += reply.error_desc().c_str();
+				sDesc += ")!!!";
+				throw std::exception(sDesc.c_str());
+			}
+		}
+
+		if (cb)
+			cb(vOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_fanout(vClient, 0, bBlocking, std::move(fcb));
 }
 
 //------------------------------------------------------------------------------
@@ -341,71 +565,80 @@ CRedisCacheProxy::LootDirtyEntry(void *service_entry, DIRTY_ENTRY_LIST& vOut) {
 
 */
 void
-CRedisCacheProxy::BatchGet(void *service_entry, CRedisHashTableBatchGetter& getter) {
+CRedisCacheProxy::DispatchBatchGet(void *service_entry, CRedisHashTableBatchGetter& getter, bool bBlocking) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(service_entry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
-		s_sBatchGet,
-		getter._vKey,
-		getter._vField
-	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_array()) {
-		//
-		std::vector<CRedisReply>& v = reply.as_array();
-		int i;
-		for (i = 0; i < v.size(); ++i) {
-			// callback
-			getter._vCb[i](v[i]);
-		}
+	// group by shard, one script per shard
+	std::vector<std::vector<std::string>> vShardKey(redisservice->ShardNum());
+	std::vector<std::vector<std::string>> vShardField(redisservice->ShardNum());
+	std::vector<std::vector<size_t>> vShardIdx(redisservice->ShardNum());
+	size_t i, nShard;
+
+	for (i = 0; i < getter._vKey.size(); ++i) {
+		nShard = redisservice->ShardIndex(getter._vShardHash[i]);
+		vShardKey[nShard].emplace_back(getter._vKey[i]);
+		vShardField[nShard].emplace_back(getter._vField[i]);
+		vShardIdx[nShard].emplace_back(i);
 	}
-	else if (reply.is_error()) {
-		std::string sDesc = "[CRedisCacheProxy::BatchGet()] error(";
-		sDesc += reply.error_desc().c_str();
-		sDesc += ")!!!";
-		throw std::exception(sDesc.c_str());
-	}
-}
 
-//------------------------------------------------------------------------------
-/**
+	// the batch spans many callers, it is not ordered with the flushed writes -- the same as with their direct commits
+	FlushWriteBehind(redisservice);
 
-*/
-void
-CRedisCacheProxy::BatchGetAsync(void *service_entry, CRedisHashTableBatchGetter& getter) {
-
-	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(service_entry);
-	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redis_reply_cb_t rcb = std::bind([&getter](std::vector<CRedisHashTableBatchGetter::getter_cb_t>& vCb, CRedisReply& reply) {
-		if (reply.ok()
-			&& reply.is_array()) {
-			//
-			std::vector<CRedisReply>& v = reply.as_array();
-			int i;
-			for (i = 0; i < v.size(); ++i) {
-				// callback
-				vCb[i](v[i]);
+	std::vector<IRedisClient *> vClient;
+	std::vector<std::vector<size_t>> vIdx;
+	for (nShard = 0; nShard < vShardKey.size(); ++nShard) {
+		if (vShardKey[nShard].empty())
+			continue;
+
+		IRedisClient& client = redisservice->ShardClient(nShard);
+		client.EvalSha(
+			s_sBatchGet,
+			vShardKey[nShard],
+			vShardField[nShard]
+		);
+		vClient.emplace_back(&client);
+		vIdx.emplace_back(std::move(vShardIdx[nShard]));
+	}
+
+	if (vClient.empty())
+		return;
+
+	// blocking call leaves the getter untouched
+	std::vector<CRedisHashTableBatchGetter::getter_cb_t> vGetterCb = bBlocking ? getter._vCb : std::move(getter._vCb);
+
+	auto fcb = std::bind([](std::vector<CRedisHashTableBatchGetter::getter_cb_t>& vCb, std::vector<std::vector<size_t>>& vIdx, std::vector<CRedisReply>& vReply) {
+		// callbacks in push order
+		std::vector<CRedisReply *> vResult(vCb.size(), nullptr);
+		size_t i, j;
+
+		for (i = 0; i < vReply.size(); ++i) {
+			CRedisReply& reply = vReply[i];
+			if (reply.ok()
+				&& reply.is_array()) {
+				//
+				std::vector<CRedisReply>& v = reply.as_array();
+				for (j = 0; j < v.size() && j < vIdx[i].size(); ++j) {
+					vResult[vIdx[i][j]] = &v[j];
+				}
+			}
+			else if (reply.is_error()) {
+				std::string sDesc = "[CRedisCacheProxy::BatchGet()] error(";
+				sDesc += reply.error_desc().c_str();
+				sDesc += ")!!!";
+				throw std::exception(sDesc.c_str());
 			}
 		}
-		else if (reply.is_error()) {
-			std::string sDesc = "[CRedisCacheProxy::BatchGetAsync()] error(";
-			sDesc += reply.error_desc().c_str();
-			sDesc += ")!!!";
-			throw std::exception(sDesc.c_str());
+
+		for (i = 0; i < vResult.size(); ++i) {
+			// callback
+			if (vResult[i])
+				vCb[i](*vResult[i]);
 		}
+	}, std::move(vGetterCb), std::move(vIdx), std::placeholders::_1);
 
-	}, std::move(getter._vCb), std::move(std::placeholders::_1));
-
-	redisservice->Client().EvalSha(
-		s_sBatchGet,
-		getter._vKey,
-		getter._vField
-	);
-	redisservice->Client().Commit(std::move(rcb));
-
+	redis_dispatch_fanout(vClient, 0, bBlocking, std::move(fcb));
 }
 
 //------------------------------------------------------------------------------
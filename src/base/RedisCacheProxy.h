@@ -4,6 +4,7 @@
 #include <vector>
 #include <unordered_map>
 #include <tuple>
+#include <functional>
 
 #include "redis_extern.h"
 #include "redis_service_def.h"
@@ -34,6 +35,7 @@
 
 //////////////////////////////////////////////////////////////////////////
 class CRedisHashTableBatchGetter;
+class IRedisService;
 
 //------------------------------------------------------------------------------
 /**
@@ -56,6 +58,11 @@ public:
 	using RESULT_PAIR_LIST = std::vector<CRedisReply>;
 	using DIRTY_ENTRY_LIST = std::vector<CRedisReply>;
 
+	//! non-blocking overloads call back in RunOnce()
+	using done_cb_t = std::function<void()>;
+	using string_cb_t = std::function<void(std::string&)>;
+	using result_list_cb_t = std::function<void(std::vector<CRedisReply>&)>;
+
 	const std::string&			MainId() const {
 		return _sMainId;
 	}
@@ -72,10 +79,17 @@ public:
 		_refEntry = service_entry;
 	}
 
+	//! Get() without near cache and GetAll() may be served by a replica, see IRedisClient::ReadFromReplica()
+	void						SetReadFromReplica(bool bFlag) {
+		_bReadFromReplica = bFlag;
+	}
+
 	void *						ServiceEntry() const {
 		return _refEntry;
 	}
 
+	//! with "_nWriteBehindMs" add/update/remove are buffered and flushed later, Commit() only sends what
+	//! SetToHashTable() built. Get(), GetAll(), Set() and Clear() send the pending writes of the object first
 	void						Commit();
 
 	void						SetToHashTable(const std::string& sId, std::string& sValue);
@@ -83,7 +97,13 @@ public:
 	void						UpdateToHashTable(const std::string& sId, std::string& sValue);
 	void						RemoveFromHashTable(const std::string& sId);
 
-	void						Clear();
+	void						Clear() {
+		DispatchClear(true, nullptr);
+	}
+
+	void						Clear(done_cb_t&& cb) {
+		DispatchClear(false, std::move(cb));
+	}
 
 	void						Add(const std::string& sId, std::string& sValue) {
 		AddToHashTable(sId, std::move(sValue));
@@ -101,19 +121,72 @@ public:
 	}
 	
 	void                        Set(const std::string& sId, std::string& sValue);
-	const std::string			Get(const std::string& sId);
-	void						GetAll(RESULT_PAIR_LIST& vOut);
-	void						GetPartitial(int nCount, RESULT_PAIR_LIST& vOut);
+
+	const std::string			Get(const std::string& sId) {
+		std::string sOut;
+		DispatchGet(sId, true, [&sOut](std::string& s) { sOut = std::move(s); });
+		return sOut;
+	}
+
+	void						Get(const std::string& sId, string_cb_t&& cb) {
+		DispatchGet(sId, false, std::move(cb));
+	}
+
+	void						GetAll(RESULT_PAIR_LIST& vOut) {
+		DispatchGetAll(true, [&vOut](RESULT_PAIR_LIST& v) { vOut = std::move(v); });
+	}
+
+	void						GetAll(result_list_cb_t&& cb) {
+		DispatchGetAll(false, std::move(cb));
+	}
+
+	void						GetPartitial(int nCount, RESULT_PAIR_LIST& vOut) {
+		DispatchGetPartitial(nCount, true, [&vOut](RESULT_PAIR_LIST& v) { vOut = std::move(v); });
+	}
+
+	void						GetPartitial(int nCount, result_list_cb_t&& cb) {
+		DispatchGetPartitial(nCount, false, std::move(cb));
+	}
 
 public:
 	static void					SplitIdHash(const std::string& sIdHash, std::string& sOutModuleName, std::string& sOutMainId, std::string& sOutSubid);
-	static void					LootDirtyEntry(void *service_entry, DIRTY_ENTRY_LIST& vOut);
 
-	static void					BatchGet(void *service_entry, CRedisHashTableBatchGetter& getter);
-	static void					BatchGetAsync(void *service_entry, CRedisHashTableBatchGetter& getter);
+	static void					LootDirtyEntry(void *service_entry, DIRTY_ENTRY_LIST& vOut) {
+		DispatchLootDirtyEntry(service_entry, true, [&vOut](DIRTY_ENTRY_LIST& v) { vOut = std::move(v); });
+	}
+
+	static void					LootDirtyEntry(void *service_entry, result_list_cb_t&& cb) {
+		DispatchLootDirtyEntry(service_entry, false, std::move(cb));
+	}
+
+	static void					BatchGet(void *service_entry, CRedisHashTableBatchGetter& getter) {
+		DispatchBatchGet(service_entry, getter, true);
+	}
+
+	static void					BatchGetAsync(void *service_entry, CRedisHashTableBatchGetter& getter) {
+		DispatchBatchGet(service_entry, getter, false);
+	}
+
+	//! sends every buffered write, one cmd pipeline per object under its caller id -- called by CRedisService::OnUpdate()
+	static void					FlushWriteBehind(IRedisService *redisservice);
 
 	static const std::map<std::string, std::string>& MapScript();
 
+private:
+	//! shared by blocking and non-blocking overloads
+	void						DispatchClear(bool bBlocking, done_cb_t&& cb);
+	void						DispatchGet(const std::string& sId, bool bBlocking, string_cb_t&& cb);
+	void						DispatchGetAll(bool bBlocking, result_list_cb_t&& cb);
+	void						DispatchGetPartitial(int nCount, bool bBlocking, result_list_cb_t&& cb);
+
+	static void					DispatchLootDirtyEntry(void *service_entry, bool bBlocking, result_list_cb_t&& cb);
+	static void					DispatchBatchGet(void *service_entry, CRedisHashTableBatchGetter& getter, bool bBlocking);
+
+	void						InvalidateNearCache(IRedisService *redisservice);
+
+	//! into the pipeline being built: the pending writes of this object
+	void						EncodeWriteBehind(IRedisService *redisservice);
+
 private:
 	void *_refEntry;
 
@@ -123,6 +196,10 @@ private:
 	std::string _sIdHash;
 	std::string _sIdHashOfDirty;
 	std::string _sIdHashOfDirtyState;
+	uint32_t _uCaller;
+	uint32_t _uShardHash; // shard of "module:mainid:subid", for all keys of the object
+	bool _bReadFromReplica = false;
+	bool _bBuilt = false; // SetToHashTable() left commands to commit
 
 	friend CRedisHashTableBatchGetter;
 };
@@ -137,6 +214,7 @@ public:
 		_vKey.reserve(256);
 		_vField.reserve(256);
 		_vCb.reserve(256);
+		_vShardHash.reserve(256);
 	}
 	~CRedisHashTableBatchGetter() = default;
 
@@ -146,6 +224,7 @@ public:
 		_vKey.emplace_back(proxy._sIdHash);
 		_vField.emplace_back(std::move(sField));
 		_vCb.emplace_back(std::move(cb));
+		_vShardHash.emplace_back(proxy._uShardHash);
 	}
 
 	void Push(const CRedisCacheProxy& proxy, getter_cb_t cb) {
@@ -155,6 +234,7 @@ public:
 	std::vector<std::string> _vKey;
 	std::vector<std::string> _vField;
 	std::vector<getter_cb_t> _vCb;
+	std::vector<uint32_t> _vShardHash;
 };
 
 /*EOF*/
\ No newline at end of file
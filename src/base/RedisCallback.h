@@ -0,0 +1,199 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+@class CRedisCallback
+
+(C) 2016 n.lee
+*/
+#include <new>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include <cstddef>
+
+//! bytes of captures stored inline, larger callables go to the heap
+#ifndef REDIS_CALLBACK_INLINE_SIZE
+#define REDIS_CALLBACK_INLINE_SIZE    64
+#endif
+
+template<typename Signature, size_t InlineSize = REDIS_CALLBACK_INLINE_SIZE>
+class CRedisCallback;
+
+//------------------------------------------------------------------------------
+/**
+@brief CRedisCallback
+
+//!
+//! move-only std::function replacement for pipeline callbacks and trunk work items: a callable
+//! which fits "InlineSize" bytes (and moves without throwing) is stored in place, so a reply
+//! callback and the binds wrapped around it usually cost no allocation. Move-only captures are fine
+//!
+*/
+template<typename R, typename... Args, size_t InlineSize>
+class CRedisCallback<R(Args...), InlineSize> {
+public:
+	CRedisCallback() noexcept {}
+	CRedisCallback(std::nullptr_t) noexcept {}
+
+	template<typename F, typename = typename std::enable_if<
+		!std::is_same<typename std::decay<F>::type, CRedisCallback>::value>::type>
+	CRedisCallback(F&& f) {
+		Assign(std::forward<F>(f));
+	}
+
+	CRedisCallback(CRedisCallback&& other) noexcept {
+		MoveFrom(other);
+	}
+
+	~CRedisCallback() {
+		Reset();
+	}
+
+	CRedisCallback(const CRedisCallback&) = delete;
+	CRedisCallback& operator=(const CRedisCallback&) = delete;
+
+	CRedisCallback& operator=(CRedisCallback&& other) noexcept {
+		if (this != &other) {
+			Reset();
+			MoveFrom(other);
+		}
+		return *this;
+	}
+
+	CRedisCallback& operator=(std::nullptr_t) noexcept {
+		Reset();
+		return *this;
+	}
+
+	template<typename F, typename = typename std::enable_if<
+		!std::is_same<typename std::decay<F>::type, CRedisCallback>::value>::type>
+	CRedisCallback& operator=(F&& f) {
+		Reset();
+		Assign(std::forward<F>(f));
+		return *this;
+	}
+
+	explicit operator bool() const noexcept {
+		return _ops != nullptr;
+	}
+
+	R operator()(Args... args) const {
+		return _ops->_invoke(Storage(), std::forward<Args>(args)...);
+	}
+
+	//! whether callables of type "F" are stored in place
+	template<typename F>
+	static constexpr bool IsInline() {
+		return sizeof(F) <= InlineSize
+			&& alignof(F) <= alignof(std::max_align_t)
+			&& std::is_nothrow_move_constructible<F>::value;
+	}
+
+private:
+	struct ops_t {
+		R(*_invoke)(void *storage, Args&&... args);
+		//! move-construct into "dst" and destroy "src"
+		void(*_relocate)(void *dst, void *src);
+		void(*_destroy)(void *storage);
+	};
+
+	template<typename F>
+	struct inline_ops {
+		static R invoke(void *storage, Args&&... args) {
+			return (*static_cast<F *>(storage))(std::forward<Args>(args)...);
+		}
+		static void relocate(void *dst, void *src) {
+			F *f = static_cast<F *>(src);
+			::new (dst) F(std::move(*f));
+			f->~F();
+		}
+		static void destroy(void *storage) {
+			static_cast<F *>(storage)->~F();
+		}
+		static const ops_t *get() {
+			static const ops_t s_ops = { &invoke, &relocate, &destroy };
+			return &s_ops;
+		}
+	};
+
+	template<typename F>
+	struct heap_ops {
+		static R invoke(void *storage, Args&&... args) {
+			return (**static_cast<F **>(storage))(std::forward<Args>(args)...);
+		}
+		static void relocate(void *dst, void *src) {
+			*static_cast<F **>(dst) = *static_cast<F **>(src);
+		}
+		static void destroy(void *storage) {
+			delete *static_cast<F **>(storage);
+		}
+		static const ops_t *get() {
+			static const ops_t s_ops = { &invoke, &relocate, &destroy };
+			return &s_ops;
+		}
+	};
+
+	//! empty std::function, CRedisCallback and null function pointers stay empty
+	template<typename F>
+	static bool IsNull(const F&) {
+		return false;
+	}
+
+	template<typename S>
+	static bool IsNull(const std::function<S>& f) {
+		return !f;
+	}
+
+	//! empty callbacks of another "InlineSize" too, their call operator has nothing to call
+	template<typename S, size_t N>
+	static bool IsNull(const CRedisCallback<S, N>& f) {
+		return !f;
+	}
+
+	template<typename T>
+	static bool IsNull(T *p) {
+		return nullptr == p;
+	}
+
+	template<typename F>
+	void Assign(F&& f) {
+		using functor_t = typename std::decay<F>::type;
+
+		if (IsNull(f))
+			return;
+
+		if (IsInline<functor_t>()) {
+			::new (Storage()) functor_t(std::forward<F>(f));
+			_ops = inline_ops<functor_t>::get();
+		}
+		else {
+			*static_cast<functor_t **>(Storage()) = new functor_t(std::forward<F>(f));
+			_ops = heap_ops<functor_t>::get();
+		}
+	}
+
+	void MoveFrom(CRedisCallback& other) noexcept {
+		if (other._ops) {
+			other._ops->_relocate(Storage(), other.Storage());
+			_ops = other._ops;
+			other._ops = nullptr;
+		}
+	}
+
+	void Reset() noexcept {
+		if (_ops) {
+			_ops->_destroy(Storage());
+			_ops = nullptr;
+		}
+	}
+
+	void *Storage() const noexcept {
+		return const_cast<void *>(static_cast<const void *>(&_storage));
+	}
+
+private:
+	typename std::aligned_storage<(InlineSize < sizeof(void *)) ? sizeof(void *) : InlineSize, alignof(std::max_align_t)>::type _storage;
+	const ops_t *_ops = nullptr;
+};
+
+/*EOF*/
@@ -0,0 +1,231 @@
+//------------------------------------------------------------------------------
+//  RedisFlatReply.cpp
+//  (C) 2016 n.lee
+//------------------------------------------------------------------------------
+#include "RedisFlatReply.h"
+#include "RedisError.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+uint32_t
+CRedisFlatReply::AddNodes(uint32_t num) {
+	uint32_t first = (uint32_t)_vNode.size();
+	node_t node;
+	memset(&node, 0, sizeof(node));
+	node._type = (uint8_t)CRedisReply::type::null;
+	_vNode.resize(_vNode.size() + num, node);
+	return first;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+CRedisReplyElement::is_array() const {
+	CRedisReply::type t = get_type();
+	return t == CRedisReply::type::array
+		|| t == CRedisReply::type::map
+		|| t == CRedisReply::type::set
+		|| t == CRedisReply::type::push;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+CRedisReplyElement::is_string() const {
+	CRedisReply::type t = get_type();
+	return t == CRedisReply::type::simple_string
+		|| t == CRedisReply::type::bulk_string
+		|| t == CRedisReply::type::error
+		|| t == CRedisReply::type::double_number
+		|| t == CRedisReply::type::big_number
+		|| t == CRedisReply::type::verbatim_string;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+CRedisReplyElement::is_error() const {
+	return get_type() == CRedisReply::type::error;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+CRedisReplyElement::is_integer() const {
+	return get_type() == CRedisReply::type::integer;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+CRedisReplyElement::is_null() const {
+	return get_type() == CRedisReply::type::null;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+size_t
+CRedisReplyElement::size() const {
+	if (!is_array())
+		throw CRedisError("Reply is not an array");
+
+	return Node()._size;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+CRedisReplyElement
+CRedisReplyElement::operator[](size_t i) const {
+	const CRedisFlatReply::node_t& node = Node();
+	if (!is_array()
+		|| i >= node._size)
+		throw CRedisError("Reply element is out of range");
+
+	return CRedisReplyElement(_flat, (uint32_t)(node._first + i));
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+CRedisReply::string_view_t
+CRedisReplyElement::as_view() const {
+	if (!is_string())
+		throw CRedisError("Reply is not a string");
+
+	const CRedisFlatReply::node_t& node = Node();
+
+	// "xxx:" ahead of the text is the format, see CRedisReply::verbatim_format()
+	if (get_type() == CRedisReply::type::verbatim_string
+		&& node._size >= 4
+		&& ':' == node._data[3])
+		return CRedisReply::string_view_t{ node._data + 4, node._size - 4 };
+
+	return CRedisReply::string_view_t{ node._data, node._size };
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+std::string
+CRedisReplyElement::as_string() const {
+	CRedisReply::string_view_t view = as_view();
+	return std::string(view._data, view._size);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+int64_t
+CRedisReplyElement::as_integer() const {
+	if (!is_integer())
+		throw CRedisError("Reply is not an integer");
+
+	return Node()._intval;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+double
+CRedisReplyElement::as_double() const {
+	if (get_type() != CRedisReply::type::double_number)
+		throw CRedisError("Reply is not a double");
+
+	// text is not null-terminated in the slab
+	const CRedisFlatReply::node_t& node = Node();
+	char chText[64];
+	size_t len = (node._size < sizeof(chText) - 1) ? node._size : sizeof(chText) - 1;
+	memcpy(chText, node._data, len);
+	chText[len] = '\0';
+	return strtod(chText, nullptr);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+CRedisReplyElement::as_boolean() const {
+	if (get_type() != CRedisReply::type::boolean)
+		throw CRedisError("Reply is not a boolean");
+
+	return Node()._intval != 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+CRedisReply
+CRedisReplyElement::to_reply() const {
+	CRedisReply reply;
+	const CRedisFlatReply::node_t& node = Node();
+	CRedisReply::type t = get_type();
+
+	switch (t) {
+	case CRedisReply::type::null:
+		reply.set();
+		break;
+
+	case CRedisReply::type::integer:
+		reply.set(node._intval);
+		break;
+
+	case CRedisReply::type::boolean:
+		reply.set_boolean(node._intval != 0);
+		break;
+
+	case CRedisReply::type::double_number:
+		reply.set_double(as_double(), std::string(node._data, node._size));
+		break;
+
+	case CRedisReply::type::verbatim_string: {
+		CRedisReply::string_view_t view = as_view();
+		char chFormat[4] = { 0 };
+		if (view._data != node._data)
+			memcpy(chFormat, node._data, 3);
+
+		reply.set_view(view._data, view._size, CRedisReply::string_type::verbatim_string, (*_flat)->Slab());
+		reply.set_verbatim_format(chFormat);
+		break;
+	}
+
+	case CRedisReply::type::error:
+	case CRedisReply::type::bulk_string:
+	case CRedisReply::type::simple_string:
+	case CRedisReply::type::big_number:
+		reply.set_view(node._data, node._size, static_cast<CRedisReply::string_type>(t), (*_flat)->Slab());
+		break;
+
+	default:
+		// one level at a time, nested aggregates are built when as_array() reaches them
+		reply.set_flat(*_flat, _idx);
+		break;
+	}
+	return reply;
+}
+
+/** -- EOF -- **/
@@ -0,0 +1,129 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+@class CRedisFlatReply
+
+(C) 2016 n.lee
+*/
+#include "RedisReply.h"
+
+//------------------------------------------------------------------------------
+/**
+@brief CRedisFlatReply
+
+//!
+//! aggregate reply as received: one flat vector of tagged nodes, strings are bytes in the reply slab and
+//! aggregates are index ranges of their elements. Built by the reply builder, read only afterwards
+//!
+*/
+class MY_REDIS_EXTERN CRedisFlatReply {
+public:
+	//! 16 bytes on 64-bit
+	struct node_t {
+		uint8_t _type;			// CRedisReply::type
+		uint8_t _reserved[3];
+		uint32_t _size;			// string length or element num
+		union {
+			const char *_data;	// string
+			int64_t _intval;	// integer, boolean
+			uint64_t _first;	// aggregate, index of the first element
+		};
+	};
+
+	//! ctor & dtor
+	explicit CRedisFlatReply(const redis_reply_slab_ptr_t& slab) : _slab(slab) {}
+	~CRedisFlatReply() = default;
+
+	//! copy ctor & assignment operator
+	CRedisFlatReply(const CRedisFlatReply&) = delete;
+	CRedisFlatReply& operator=(const CRedisFlatReply&) = delete;
+
+public:
+	void Reserve(size_t num) {
+		_vNode.reserve(num);
+	}
+
+	//! "num" zeroed nodes in a row, returns the index of the first one
+	uint32_t AddNodes(uint32_t num);
+
+	node_t& NodeAt(uint32_t idx) {
+		return _vNode[idx];
+	}
+
+	const node_t& NodeAt(uint32_t idx) const {
+		return _vNode[idx];
+	}
+
+	size_t NodeNum() const {
+		return _vNode.size();
+	}
+
+	//! string bytes which are not in the slab yet
+	char * Alloc(size_t size) {
+		return _slab->Alloc(size);
+	}
+
+	const redis_reply_slab_ptr_t& Slab() const {
+		return _slab;
+	}
+
+	//! nodes plus string bytes
+	size_t MemoryBytes() const {
+		return _vNode.capacity() * sizeof(node_t) + _slab->Bytes();
+	}
+
+private:
+	std::vector<node_t> _vNode;
+	redis_reply_slab_ptr_t _slab;
+};
+
+//------------------------------------------------------------------------------
+/**
+@brief CRedisReplyElement
+
+//!
+//! read only cursor on one node of a flat reply, valid as long as the reply holding it is alive
+//! and as_array() is not called on it
+//!
+*/
+class MY_REDIS_EXTERN CRedisReplyElement {
+public:
+	CRedisReplyElement(const redis_flat_reply_ptr_t *flat, uint32_t idx)
+		: _flat(flat)
+		, _idx(idx) {}
+
+public:
+	CRedisReply::type get_type() const {
+		return static_cast<CRedisReply::type>(Node()._type);
+	}
+
+	bool is_array() const;
+	bool is_string() const;
+	bool is_error() const;
+	bool is_integer() const;
+	bool is_null() const;
+
+	//! element num of an aggregate
+	size_t size() const;
+	CRedisReplyElement operator[](size_t i) const;
+
+	CRedisReply::string_view_t as_view() const;
+	std::string as_string() const;
+	int64_t as_integer() const;
+	double as_double() const;
+	bool as_boolean() const;
+
+	//! a standalone reply of the element: strings stay views into the slab, aggregates stay flat
+	CRedisReply to_reply() const;
+
+private:
+	const CRedisFlatReply::node_t& Node() const {
+		return (*_flat)->NodeAt(_idx);
+	}
+
+private:
+	const redis_flat_reply_ptr_t *_flat;
+	uint32_t _idx;
+};
+
+/*EOF*/
@@ -0,0 +1,95 @@
+//------------------------------------------------------------------------------
+//  RedisFuture.cpp
+//  (C) 2016 n.lee
+//------------------------------------------------------------------------------
+#include "RedisFuture.h"
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisFuture::state_t::Resolve(CRedisReply&& reply) {
+	_ready = true;
+
+	// held for the continuations attached later
+	_reply = std::move(reply);
+
+	// continuations are consumed
+	std::vector<redis_reply_cb_t> vCont;
+	vCont.swap(_vCont);
+
+	for (auto& cb : vCont) {
+		CRedisReply copy = _reply;
+		cb(std::move(copy));
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisFuture::state_t::OnReady(redis_reply_cb_t&& cb) {
+	if (!_ready) {
+		_vCont.emplace_back(std::move(cb));
+	}
+	else {
+		CRedisReply copy = _reply;
+		cb(std::move(copy));
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+CRedisFuture
+CRedisFuture::WhenAll(std::vector<CRedisFuture>& vFuture) {
+
+	struct when_all_t {
+		std::vector<CRedisReply> _vReply;
+		size_t _remain;
+	};
+
+	CRedisFuture all;
+	state_ptr_t allState = all._state;
+
+	if (vFuture.empty()) {
+		CRedisReply reply;
+		reply.set(std::vector<CRedisReply>());
+		all.Resolve(std::move(reply));
+		return all;
+	}
+
+	auto ctx = std::make_shared<when_all_t>();
+	ctx->_vReply.resize(vFuture.size());
+	ctx->_remain = vFuture.size();
+
+	for (size_t i = 0; i < vFuture.size(); ++i) {
+		vFuture[i]._state->OnReady([ctx, allState, i](CRedisReply&& reply) {
+			ctx->_vReply[i] = std::move(reply);
+
+			if (--ctx->_remain == 0) {
+				CRedisReply replyAll;
+				replyAll.set(std::move(ctx->_vReply));
+				allState->Resolve(std::move(replyAll));
+			}
+		});
+	}
+	return all;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisFuture::Forward(const state_ptr_t& next, CRedisFuture&& inner) {
+	state_ptr_t nextState = next;
+	inner._state->OnReady([nextState](CRedisReply&& reply) {
+		nextState->Resolve(std::move(reply));
+	});
+}
+
+/** -- EOF -- **/
@@ -6,6 +6,7 @@
 
 #include "redis_service_def.h"
 #include "IRedisService.h"
+#include "RedisError.h"
 
 static int
 __split(const char *str, int str_len, char **av, int av_max, char c) {
@@ -80,8 +81,17 @@ CRedisListProxy::CRedisListProxy(void *service_entry, const char *sMainId, const
 	, _sSubid(sSubid)
 	, _sIdList(_sModuleName + ":" + _sMainId + ":" + sSubid + ":L")
 	, _sIdHashOfCAS(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":CAS_H")
-	, _sIdChanOfNotify(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":NTF_CHN") {
-
+	, _sIdChanOfNotify(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":NTF_CHN")
+	, _uCaller(redis_caller_id(_sIdList))
+	, _uShardHash(CRedisShardRing::KeyHash(_sModuleName + ":" + _sMainId + ":" + _sSubid)) {
+	// the scripts touch ":CAS_H", ":L", the dirty entry and the notify channel in one call, they are not in one hash slot
+	if ((static_cast<redis_service_entry_t *>(service_entry))->_param._bCluster) {
+		std::string sDesc = "[CRedisListProxy::CRedisListProxy()] not for redis cluster, module(";
+		sDesc += _sModuleName;
+		sDesc += ")!!!";
+		fprintf(stderr, "%s\n", sDesc.c_str());
+		throw CRedisError(sDesc.c_str());
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -95,7 +105,9 @@ CRedisListProxy::CRedisListProxy(const std::string& sModuleName, const char *sMa
 	, _sSubid(sSubid)
 	, _sIdList(_sModuleName + ":" + _sMainId + ":" + sSubid + ":L")
 	, _sIdHashOfCAS(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":CAS_H")
-	, _sIdChanOfNotify(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":NTF_CHN") {
+	, _sIdChanOfNotify(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":NTF_CHN")
+	, _uCaller(redis_caller_id(_sIdList))
+	, _uShardHash(CRedisShardRing::KeyHash(_sModuleName + ":" + _sMainId + ":" + _sSubid)) {
 	
 }
 
@@ -105,12 +117,14 @@ CRedisListProxy::CRedisListProxy(const std::string& sModuleName, const char *sMa
 */
 CRedisListProxy::CRedisListProxy(const std::string& sIdList)
 	: _refEntry(nullptr)
-	, _sIdList(sIdList) {
+	, _sIdList(sIdList)
+	, _uCaller(redis_caller_id(sIdList)) {
 	//
 	SplitIdList(sIdList, _sModuleName, _sMainId, _sSubid);
 
 	_sIdHashOfCAS = _sModuleName + ":" + _sMainId + ":" + _sSubid + ":CAS_H";
 	_sIdChanOfNotify = _sModuleName + ":" + _sMainId + ":" + _sSubid + ":NTF_CHN";
+	_uShardHash = CRedisShardRing::KeyHash(_sModuleName + ":" + _sMainId + ":" + _sSubid);
 }
 
 //------------------------------------------------------------------------------
@@ -129,7 +143,7 @@ void
 CRedisListProxy::Commit() {
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().Commit(nullptr);
+	redisservice->ShardClientOf(_uShardHash).Commit(nullptr, _uCaller);
 }
 
 //------------------------------------------------------------------------------
@@ -140,7 +154,7 @@ void
 CRedisListProxy::LPushToList(std::string& sValue) {
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().LPush(_sIdList.c_str(), std::vector<std::string>{ std::move(sValue) });
+	redisservice->ShardClientOf(_uShardHash).LPush(_sIdList.c_str(), std::vector<std::string>{ std::move(sValue) });
 }
 
 //------------------------------------------------------------------------------
@@ -151,7 +165,7 @@ void
 CRedisListProxy::RPushToList(std::string& sValue) {
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().RPush(_sIdList.c_str(), std::vector<std::string>{ std::move(sValue) });
+	redisservice->ShardClientOf(_uShardHash).RPush(_sIdList.c_str(), std::vector<std::string>{ std::move(sValue) });
 }
 
 //------------------------------------------------------------------------------
@@ -159,105 +173,142 @@ CRedisListProxy::RPushToList(std::string& sValue) {
 
 */
 void
-CRedisListProxy::Clear() {
+CRedisListProxy::DispatchClear(bool bBlocking, done_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sClear,
 		std::vector<std::string>{ _sIdHashOfCAS, _sIdList, entry->_listDirtyEntry, _sIdChanOfNotify },
 		std::vector<std::string>{ }
 	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_null()) {
-		// null means false
-		fprintf(stderr, "[CRedisListProxy::Clear()] List(%s) is dirty, you must clean it first before -- Clear() --!!!!",
-			_sIdList.c_str());
-		system("pause");
-		exit(-1);
-	}
+	std::string sIdList = _sIdList;
+	redis_reply_cb_t rcb = std::bind([sIdList](done_cb_t& cb, CRedisReply&& reply) {
+		if (reply.ok()
+			&& reply.is_null()) {
+			// null means false
+			fprintf(stderr, "[CRedisListProxy::Clear()] List(%s) is dirty, you must clean it first before -- Clear() --!!!!",
+				sIdList.c_str());
+			system("pause");
+			exit(-1);
+		}
+
+		if (cb)
+			cb();
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
 /**
 
 */
-const std::string
-CRedisListProxy::LPop() {
+void
+CRedisListProxy::DispatchLPop(bool bBlocking, string_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().LPop(_sIdList.c_str());
+	redisservice->ShardClientOf(_uShardHash).LPop(_sIdList.c_str());
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_string()) {
-		//
-		return std::move(reply.as_string());
-	}
-	return "";
+	redis_reply_cb_t rcb = std::bind([](string_cb_t& cb, CRedisReply&& reply) {
+		std::string sOut;
+		if (reply.ok()
+			&& reply.is_string()) {
+			//
+			sOut = std::move(reply.as_string());
+		}
+
+		if (cb)
+			cb(sOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
 /**
 
 */
-const std::string
-CRedisListProxy::RPop() {
+void
+CRedisListProxy::DispatchRPop(bool bBlocking, string_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().RPop(_sIdList.c_str());
+	redisservice->ShardClientOf(_uShardHash).RPop(_sIdList.c_str());
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_string()) {
-		//
-		return std::move(reply.as_string());
-	}
-	return "";
+	redis_reply_cb_t rcb = std::bind([](string_cb_t& cb, CRedisReply&& reply) {
+		std::string sOut;
+		if (reply.ok()
+			&& reply.is_string()) {
+			//
+			sOut = std::move(reply.as_string());
+		}
+
+		if (cb)
+			cb(sOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
 /**
 
 */
-int
-CRedisListProxy::LLength() {
+void
+CRedisListProxy::DispatchLLength(bool bBlocking, int_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().LLen(_sIdList.c_str());
+	redisservice->ShardClientOf(_uShardHash).LLen(_sIdList.c_str());
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_integer()) {
-		//
-		return (int)reply.as_integer();
-	}
-	return 0;
+	if (_bReadFromReplica)
+		redisservice->ShardClientOf(_uShardHash).ReadFromReplica();
+
+	redis_reply_cb_t rcb = std::bind([](int_cb_t& cb, CRedisReply&& reply) {
+		int nOut = 0;
+		if (reply.ok()
+			&& reply.is_integer()) {
+			//
+			nOut = (int)reply.as_integer();
+		}
+
+		if (cb)
+			cb(nOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
 /**
 
 */
-const std::string
-CRedisListProxy::GetItemAt(int nIndex) {
+void
+CRedisListProxy::DispatchGetItemAt(int nIndex, bool bBlocking, string_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().LIndex(_sIdList.c_str(), nIndex);
+	redisservice->ShardClientOf(_uShardHash).LIndex(_sIdList.c_str(), nIndex);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_string()) {
-		//
-		return std::move(reply.as_string());
-	}
-	return "";
+	if (_bReadFromReplica)
+		redisservice->ShardClientOf(_uShardHash).ReadFromReplica();
+
+	redis_reply_cb_t rcb = std::bind([](string_cb_t& cb, CRedisReply&& reply) {
+		std::string sOut;
+		if (reply.ok()
+			&& reply.is_string()) {
+			//
+			sOut = std::move(reply.as_string());
+		}
+
+		if (cb)
+			cb(sOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
@@ -265,22 +316,29 @@ CRedisListProxy::GetItemAt(int nIndex) {
 
 */
 void
-CRedisListProxy::PopAll(RESULT_LIST& vOut) {
+CRedisListProxy::DispatchPopAll(bool bBlocking, result_list_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sPopAll,
 		std::vector<std::string>{ _sIdHashOfCAS, _sIdList, entry->_listDirtyEntry, _sIdChanOfNotify },
 		std::vector<std::string>{ }
 	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_array()) {
-		//
-		vOut = std::move(reply.as_array());
-	}
+	redis_reply_cb_t rcb = std::bind([](result_list_cb_t& cb, CRedisReply&& reply) {
+		std::vector<CRedisReply> vOut;
+		if (reply.ok()
+			&& reply.is_array()) {
+			//
+			vOut = std::move(reply.as_array());
+		}
+
+		if (cb)
+			cb(vOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
@@ -288,190 +346,239 @@ CRedisListProxy::PopAll(RESULT_LIST& vOut) {
 
 */
 void
-CRedisListProxy::PopAllAndMark(const std::string& sId, const std::string& sExpect, RESULT_LIST& vOut) {
+CRedisListProxy::DispatchPopAllAndMark(const std::string& sId, const std::string& sExpect, bool bBlocking, result_list_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sPopAllAndMark,
 		std::vector<std::string>{ _sIdHashOfCAS, _sIdList, entry->_listDirtyEntry, _sIdChanOfNotify },
 		std::vector<std::string>{ sId, sExpect }
 	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_array()) {
-		//
-		vOut = std::move(reply.as_array());
-	}
+	redis_reply_cb_t rcb = std::bind([](result_list_cb_t& cb, CRedisReply&& reply) {
+		std::vector<CRedisReply> vOut;
+		if (reply.ok()
+			&& reply.is_array()) {
+			//
+			vOut = std::move(reply.as_array());
+		}
+
+		if (cb)
+			cb(vOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
 /**
 
 */
-bool
-CRedisListProxy::LPushCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest, std::string& sValue) {
+void
+CRedisListProxy::DispatchLPushCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest, std::string& sValue, bool bBlocking, bool_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sLPushCAS,
 		std::vector<std::string>{ _sIdHashOfCAS, _sIdList, entry->_listDirtyEntry, _sIdChanOfNotify },
 		std::vector<std::string>{ sId, sExpect, sDest, std::move(sValue) }
 	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_integer()) {
-		//
-		return (1 == reply.as_integer());
-	}
-	return false;
+	redis_reply_cb_t rcb = std::bind([](bool_cb_t& cb, CRedisReply&& reply) {
+		bool bOut = false;
+		if (reply.ok()
+			&& reply.is_integer()) {
+			//
+			bOut = (1 == reply.as_integer());
+		}
+
+		if (cb)
+			cb(bOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
 /**
 
 */
-bool
-CRedisListProxy::RPushCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest, std::string& sValue) {
+void
+CRedisListProxy::DispatchRPushCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest, std::string& sValue, bool bBlocking, bool_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sRPushCAS,
 		std::vector<std::string>{ _sIdHashOfCAS, _sIdList, entry->_listDirtyEntry, _sIdChanOfNotify },
 		std::vector<std::string>{ sId, sExpect, sDest, std::move(sValue) }
 	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_integer()) {
-		//
-		return (1 == reply.as_integer());
-	}
-	return false;
+	redis_reply_cb_t rcb = std::bind([](bool_cb_t& cb, CRedisReply&& reply) {
+		bool bOut = false;
+		if (reply.ok()
+			&& reply.is_integer()) {
+			//
+			bOut = (1 == reply.as_integer());
+		}
+
+		if (cb)
+			cb(bOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
 /**
 
 */
-bool
-CRedisListProxy::TestMark(const std::string& sId, const std::string& sExpect) {
+void
+CRedisListProxy::DispatchTestMark(const std::string& sId, const std::string& sExpect, bool bBlocking, bool_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sTestMark,
 		std::vector<std::string>{ _sIdHashOfCAS },
 		std::vector<std::string>{ sId, sExpect }
 	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_integer()) {
-		//
-		return (1 == reply.as_integer());
-	}
-	return false;
+	redis_reply_cb_t rcb = std::bind([](bool_cb_t& cb, CRedisReply&& reply) {
+		bool bOut = false;
+		if (reply.ok()
+			&& reply.is_integer()) {
+			//
+			bOut = (1 == reply.as_integer());
+		}
+
+		if (cb)
+			cb(bOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
 /**
 
 */
-bool
-CRedisListProxy::SetCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest) {
+void
+CRedisListProxy::DispatchSetCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest, bool bBlocking, bool_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sSetCAS,
 		std::vector<std::string>{ _sIdHashOfCAS, _sIdList, entry->_listDirtyEntry, _sIdChanOfNotify },
 		std::vector<std::string>{ sId, sExpect, sDest }
 	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_integer()) {
-		//
-		return (1 == reply.as_integer());
-	}
-	return false;
+	redis_reply_cb_t rcb = std::bind([](bool_cb_t& cb, CRedisReply&& reply) {
+		bool bOut = false;
+		if (reply.ok()
+			&& reply.is_integer()) {
+			//
+			bOut = (1 == reply.as_integer());
+		}
+
+		if (cb)
+			cb(bOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
 /**
 
 */
-bool
-CRedisListProxy::ResetCAS(const std::string& sId, std::string& sMustNotEqual, const std::string& sDest) {
+void
+CRedisListProxy::DispatchResetCAS(const std::string& sId, std::string& sMustNotEqual, const std::string& sDest, bool bBlocking, bool_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sResetCAS,
 		std::vector<std::string>{ _sIdHashOfCAS, _sIdList, entry->_listDirtyEntry, _sIdChanOfNotify },
 		std::vector<std::string>{ sId, std::move(sMustNotEqual), sDest }
 	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_integer()) {
-		//
-		return (1 == reply.as_integer());
-	}
-	return false;
+	redis_reply_cb_t rcb = std::bind([](bool_cb_t& cb, CRedisReply&& reply) {
+		bool bOut = false;
+		if (reply.ok()
+			&& reply.is_integer()) {
+			//
+			bOut = (1 == reply.as_integer());
+		}
+
+		if (cb)
+			cb(bOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
 /**
 
 */
-int
-CRedisListProxy::IncrByIntCAS(const std::string& sId, int nIncrement, int nUpperBound) {
+void
+CRedisListProxy::DispatchIncrByIntCAS(const std::string& sId, int nIncrement, int nUpperBound, bool bBlocking, int_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sIncrByIntCAS,
 		std::vector<std::string>{ _sIdHashOfCAS, _sIdList, entry->_listDirtyEntry, _sIdChanOfNotify },
 		std::vector<std::string>{ sId, std::to_string(nIncrement), std::to_string(nUpperBound) }
 	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_integer()) {
-		//
-		return reply.as_integer();
-	}
-	return INT_MIN;
+	redis_reply_cb_t rcb = std::bind([](int_cb_t& cb, CRedisReply&& reply) {
+		int nOut = INT_MIN;
+		if (reply.ok()
+			&& reply.is_integer()) {
+			//
+			nOut = (int)reply.as_integer();
+		}
+
+		if (cb)
+			cb(nOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
 /**
 
 */
-int
-CRedisListProxy::DecrByIntCAS(const std::string& sId, int nDecrement, int nLowerBound) {
+void
+CRedisListProxy::DispatchDecrByIntCAS(const std::string& sId, int nDecrement, int nLowerBound, bool bBlocking, int_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sDecrByIntCAS,
 		std::vector<std::string>{ _sIdHashOfCAS, _sIdList, entry->_listDirtyEntry, _sIdChanOfNotify },
 		std::vector<std::string>{ sId, std::to_string(nDecrement), std::to_string(nLowerBound) }
 	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_integer()) {
-		//
-		return reply.as_integer();
-	}
-	return INT_MAX;
+	redis_reply_cb_t rcb = std::bind([](int_cb_t& cb, CRedisReply&& reply) {
+		int nOut = INT_MAX;
+		if (reply.ok()
+			&& reply.is_integer()) {
+			//
+			nOut = (int)reply.as_integer();
+		}
+
+		if (cb)
+			cb(nOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
@@ -495,22 +602,45 @@ CRedisListProxy::SplitIdList(const std::string& sIdList, std::string& sOutModule
 
 */
 void
-CRedisListProxy::LootDirtyEntry(void *service_entry, DIRTY_ENTRY_LIST& vOut) {
+CRedisListProxy::DispatchLootDirtyEntry(void *service_entry, bool bBlocking, result_list_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(service_entry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
-		s_sLootDirtyEntry,
-		std::vector<std::string>{ entry->_listDirtyEntry },
-		std::vector<std::string>{ }
-	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_array()) {
-		//
-		vOut = std::move(reply.as_array());
+	// every shard keeps the dirty entries of its own lists
+	std::vector<IRedisClient *> vClient;
+	size_t i;
+	for (i = 0; i < redisservice->ShardNum(); ++i) {
+		IRedisClient& client = redisservice->ShardClient(i);
+		client.EvalSha(
+			s_sLootDirtyEntry,
+			std::vector<std::string>{ entry->_listDirtyEntry },
+			std::vector<std::string>{ }
+		);
+		vClient.emplace_back(&client);
 	}
+
+	auto fcb = std::bind([](result_list_cb_t& cb, std::vector<CRedisReply>& vReply) {
+		std::vector<CRedisReply> vOut;
+		for (auto& reply : vReply) {
+			if (reply.ok()
+				&& reply.is_array()) {
+				//
+				std::vector<CRedisReply>& v = reply.as_array();
+				if (vOut.empty()) {
+					vOut = std::move(v);
+				}
+				else {
+					vOut.insert(vOut.end(), std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()));
+				}
+			}
+		}
+
+		if (cb)
+			cb(vOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_fanout(vClient, 0, bBlocking, std::move(fcb));
 }
 
 //------------------------------------------------------------------------------
@@ -518,22 +648,28 @@ CRedisListProxy::LootDirtyEntry(void *service_entry, DIRTY_ENTRY_LIST& vOut) {
 
 */
 void
-CRedisListProxy::Restore(void *service_entry, std::string& sIdList, std::string& sListVal, std::string& sIdHashOfCAS, std::string& sHashOfCASVal) {
+CRedisListProxy::DispatchRestore(void *service_entry, std::string& sIdList, std::string& sListVal, std::string& sIdHashOfCAS, std::string& sHashOfCASVal, bool bBlocking, done_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(service_entry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+
+	// back to the shard of its owner object
+	std::string sModuleName, sMainId, sSubid;
+	SplitIdList(sIdList, sModuleName, sMainId, sSubid);
+	IRedisClient& client = redisservice->ShardClientOf(CRedisShardRing::KeyHash(sModuleName + ":" + sMainId + ":" + sSubid));
+
+	client.EvalSha(
 		s_sRestore,
 		std::vector<std::string>{ sIdHashOfCAS, sIdList },
 		std::vector<std::string>{ sHashOfCASVal, sListVal }
 	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_array()) {
-		//
-		
-	}
+	redis_reply_cb_t rcb = std::bind([](done_cb_t& cb, CRedisReply&& reply) {
+		if (cb)
+			cb();
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(client, 0, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
@@ -595,11 +731,15 @@ CRedisListSubject::SetObservable(void *service_entry, bool bFlag) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(service_entry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	if (bFlag) {
-		redisservice->Subscriber().AddChannelMessageCb(REG_NAME, &CRedisListSubject::OnGotChannelMessage);
-	}
-	else {
-		redisservice->Subscriber().RemoveChannelMessageCb(REG_NAME);
+	size_t i;
+	for (i = 0; i < redisservice->ShardNum(); ++i) {
+		// lists publish on their own shard
+		if (bFlag) {
+			redisservice->ShardSubscriber(i).AddChannelMessageCb(REG_NAME, &CRedisListSubject::OnGotChannelMessage);
+		}
+		else {
+			redisservice->ShardSubscriber(i).RemoveChannelMessageCb(REG_NAME);
+		}
 	}
 }
 
@@ -637,7 +777,7 @@ CRedisListSubject::AttachObserver(const uintptr_t regid, const CRedisListProxy&
 		// subscribe
 		redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(observer.ServiceEntry());
 		IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-		redisservice->Subscriber().Subscribe(sChanId);
+		redisservice->ShardSubscriber(redisservice->ShardIndex(observer.ShardHash())).Subscribe(sChanId);
 	}
 	else {
 		// check deleted
@@ -648,7 +788,7 @@ CRedisListSubject::AttachObserver(const uintptr_t regid, const CRedisListProxy&
 			// subscribe
 			redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(observer.ServiceEntry());
 			IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-			redisservice->Subscriber().Subscribe(sChanId);
+			redisservice->ShardSubscriber(redisservice->ShardIndex(observer.ShardHash())).Subscribe(sChanId);
 		}
 
 		// re-assign cb
@@ -681,7 +821,7 @@ CRedisListSubject::DetachObserver(const uintptr_t regid, const CRedisListProxy&
 				// unsubscribe
 				redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(observer.ServiceEntry());
 				IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-				redisservice->Subscriber().Unsubscribe(sChanId);
+				redisservice->ShardSubscriber(redisservice->ShardIndex(observer.ShardHash())).Unsubscribe(sChanId);
 				break;
 			}
 
@@ -3,6 +3,8 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <functional>
+#include <climits>
 
 #include "IRedisService.h"
 
@@ -28,6 +30,13 @@ public:
 	using RESULT_LIST = std::vector<CRedisReply>;
 	using DIRTY_ENTRY_LIST = std::vector<CRedisReply>;
 
+	//! non-blocking overloads call back in RunOnce()
+	using done_cb_t = std::function<void()>;
+	using string_cb_t = std::function<void(std::string&)>;
+	using int_cb_t = std::function<void(int)>;
+	using bool_cb_t = std::function<void(bool)>;
+	using result_list_cb_t = std::function<void(std::vector<CRedisReply>&)>;
+
 	const std::string&			MainId() const {
 		return _sMainId;
 	}
@@ -40,6 +49,10 @@ public:
 		return _sIdList;
 	}
 
+	uint32_t					ShardHash() const {
+		return _uShardHash;
+	}
+
 	const std::string&			IdChanOfNotify() const {
 		return _sIdChanOfNotify;
 	}
@@ -48,6 +61,11 @@ public:
 		_refEntry = service_entry;
 	}
 
+	//! LLength() and GetItemAt() may be served by a replica, see IRedisClient::ReadFromReplica()
+	void						SetReadFromReplica(bool bFlag) {
+		_bReadFromReplica = bFlag;
+	}
+
 	void *						ServiceEntry() const {
 		return _refEntry;
 	}
@@ -55,7 +73,14 @@ public:
 	void						Commit();
 	void						LPushToList(std::string& sValue);
 	void						RPushToList(std::string& sValue);
-	void						Clear();
+
+	void						Clear() {
+		DispatchClear(true, nullptr);
+	}
+
+	void						Clear(done_cb_t&& cb) {
+		DispatchClear(false, std::move(cb));
+	}
 
 	void						LPush(std::string& sValue) {
 		LPushToList(std::move(sValue));
@@ -67,34 +92,173 @@ public:
 		Commit();
 	}
 
-	const std::string			LPop();
-	const std::string			RPop();
+	const std::string			LPop() {
+		std::string sOut;
+		DispatchLPop(true, [&sOut](std::string& s) { sOut = std::move(s); });
+		return sOut;
+	}
+
+	void						LPop(string_cb_t&& cb) {
+		DispatchLPop(false, std::move(cb));
+	}
+
+	const std::string			RPop() {
+		std::string sOut;
+		DispatchRPop(true, [&sOut](std::string& s) { sOut = std::move(s); });
+		return sOut;
+	}
+
+	void						RPop(string_cb_t&& cb) {
+		DispatchRPop(false, std::move(cb));
+	}
+
+	int							LLength() {
+		int nOut = 0;
+		DispatchLLength(true, [&nOut](int n) { nOut = n; });
+		return nOut;
+	}
+
+	void						LLength(int_cb_t&& cb) {
+		DispatchLLength(false, std::move(cb));
+	}
+
+	const std::string			GetItemAt(int nIndex) {
+		std::string sOut;
+		DispatchGetItemAt(nIndex, true, [&sOut](std::string& s) { sOut = std::move(s); });
+		return sOut;
+	}
+
+	void						GetItemAt(int nIndex, string_cb_t&& cb) {
+		DispatchGetItemAt(nIndex, false, std::move(cb));
+	}
+
+	void						PopAll(RESULT_LIST& vOut) {
+		DispatchPopAll(true, [&vOut](RESULT_LIST& v) { vOut = std::move(v); });
+	}
 
-	int							LLength();
-	const std::string			GetItemAt(int nIndex);
+	void						PopAll(result_list_cb_t&& cb) {
+		DispatchPopAll(false, std::move(cb));
+	}
 
-	void						PopAll(RESULT_LIST& vOut);
-	void						PopAllAndMark(const std::string& sId, const std::string& sExpect, RESULT_LIST& vOut);
+	void						PopAllAndMark(const std::string& sId, const std::string& sExpect, RESULT_LIST& vOut) {
+		DispatchPopAllAndMark(sId, sExpect, true, [&vOut](RESULT_LIST& v) { vOut = std::move(v); });
+	}
 
-	bool						LPushCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest, std::string& sValue);
-	bool						RPushCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest, std::string& sValue);
+	void						PopAllAndMark(const std::string& sId, const std::string& sExpect, result_list_cb_t&& cb) {
+		DispatchPopAllAndMark(sId, sExpect, false, std::move(cb));
+	}
 
-	bool						TestMark(const std::string& sId, const std::string& sExpect);
+	bool						LPushCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest, std::string& sValue) {
+		bool bOut = false;
+		DispatchLPushCAS(sId, sExpect, sDest, sValue, true, [&bOut](bool b) { bOut = b; });
+		return bOut;
+	}
 
-	bool						SetCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest);
-	bool						ResetCAS(const std::string& sId, std::string& sMustNotEqual, const std::string& sDest);
+	void						LPushCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest, std::string& sValue, bool_cb_t&& cb) {
+		DispatchLPushCAS(sId, sExpect, sDest, sValue, false, std::move(cb));
+	}
 
-	int							IncrByIntCAS(const std::string& sId, int nIncrement, int nUpperBound);
-	int							DecrByIntCAS(const std::string& sId, int nDecrement, int nLowerBound);
+	bool						RPushCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest, std::string& sValue) {
+		bool bOut = false;
+		DispatchRPushCAS(sId, sExpect, sDest, sValue, true, [&bOut](bool b) { bOut = b; });
+		return bOut;
+	}
+
+	void						RPushCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest, std::string& sValue, bool_cb_t&& cb) {
+		DispatchRPushCAS(sId, sExpect, sDest, sValue, false, std::move(cb));
+	}
+
+	bool						TestMark(const std::string& sId, const std::string& sExpect) {
+		bool bOut = false;
+		DispatchTestMark(sId, sExpect, true, [&bOut](bool b) { bOut = b; });
+		return bOut;
+	}
+
+	void						TestMark(const std::string& sId, const std::string& sExpect, bool_cb_t&& cb) {
+		DispatchTestMark(sId, sExpect, false, std::move(cb));
+	}
+
+	bool						SetCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest) {
+		bool bOut = false;
+		DispatchSetCAS(sId, sExpect, sDest, true, [&bOut](bool b) { bOut = b; });
+		return bOut;
+	}
+
+	void						SetCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest, bool_cb_t&& cb) {
+		DispatchSetCAS(sId, sExpect, sDest, false, std::move(cb));
+	}
+
+	bool						ResetCAS(const std::string& sId, std::string& sMustNotEqual, const std::string& sDest) {
+		bool bOut = false;
+		DispatchResetCAS(sId, sMustNotEqual, sDest, true, [&bOut](bool b) { bOut = b; });
+		return bOut;
+	}
+
+	void						ResetCAS(const std::string& sId, std::string& sMustNotEqual, const std::string& sDest, bool_cb_t&& cb) {
+		DispatchResetCAS(sId, sMustNotEqual, sDest, false, std::move(cb));
+	}
+
+	int							IncrByIntCAS(const std::string& sId, int nIncrement, int nUpperBound) {
+		int nOut = INT_MIN;
+		DispatchIncrByIntCAS(sId, nIncrement, nUpperBound, true, [&nOut](int n) { nOut = n; });
+		return nOut;
+	}
+
+	void						IncrByIntCAS(const std::string& sId, int nIncrement, int nUpperBound, int_cb_t&& cb) {
+		DispatchIncrByIntCAS(sId, nIncrement, nUpperBound, false, std::move(cb));
+	}
+
+	int							DecrByIntCAS(const std::string& sId, int nDecrement, int nLowerBound) {
+		int nOut = INT_MAX;
+		DispatchDecrByIntCAS(sId, nDecrement, nLowerBound, true, [&nOut](int n) { nOut = n; });
+		return nOut;
+	}
+
+	void						DecrByIntCAS(const std::string& sId, int nDecrement, int nLowerBound, int_cb_t&& cb) {
+		DispatchDecrByIntCAS(sId, nDecrement, nLowerBound, false, std::move(cb));
+	}
 
 public:
 	static void					SplitIdList(const std::string& sIdList, std::string& sOutModuleName, std::string& sOutMainId, std::string& sOutSubid);
-	static void					LootDirtyEntry(void *service_entry, DIRTY_ENTRY_LIST& vOut);
 
-	static void					Restore(void *service_entry, std::string& sIdList, std::string& sListVal, std::string& sIdHashOfCAS, std::string& sCASVal);
+	static void					LootDirtyEntry(void *service_entry, DIRTY_ENTRY_LIST& vOut) {
+		DispatchLootDirtyEntry(service_entry, true, [&vOut](DIRTY_ENTRY_LIST& v) { vOut = std::move(v); });
+	}
+
+	static void					LootDirtyEntry(void *service_entry, result_list_cb_t&& cb) {
+		DispatchLootDirtyEntry(service_entry, false, std::move(cb));
+	}
+
+	static void					Restore(void *service_entry, std::string& sIdList, std::string& sListVal, std::string& sIdHashOfCAS, std::string& sCASVal) {
+		DispatchRestore(service_entry, sIdList, sListVal, sIdHashOfCAS, sCASVal, true, nullptr);
+	}
+
+	static void					Restore(void *service_entry, std::string& sIdList, std::string& sListVal, std::string& sIdHashOfCAS, std::string& sCASVal, done_cb_t&& cb) {
+		DispatchRestore(service_entry, sIdList, sListVal, sIdHashOfCAS, sCASVal, false, std::move(cb));
+	}
 
 	static const std::map<std::string, std::string>& MapScript();
 
+private:
+	//! shared by blocking and non-blocking overloads
+	void						DispatchClear(bool bBlocking, done_cb_t&& cb);
+	void						DispatchLPop(bool bBlocking, string_cb_t&& cb);
+	void						DispatchRPop(bool bBlocking, string_cb_t&& cb);
+	void						DispatchLLength(bool bBlocking, int_cb_t&& cb);
+	void						DispatchGetItemAt(int nIndex, bool bBlocking, string_cb_t&& cb);
+	void						DispatchPopAll(bool bBlocking, result_list_cb_t&& cb);
+	void						DispatchPopAllAndMark(const std::string& sId, const std::string& sExpect, bool bBlocking, result_list_cb_t&& cb);
+	void						DispatchLPushCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest, std::string& sValue, bool bBlocking, bool_cb_t&& cb);
+	void						DispatchRPushCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest, std::string& sValue, bool bBlocking, bool_cb_t&& cb);
+	void						DispatchTestMark(const std::string& sId, const std::string& sExpect, bool bBlocking, bool_cb_t&& cb);
+	void						DispatchSetCAS(const std::string& sId, const std::string& sExpect, const std::string& sDest, bool bBlocking, bool_cb_t&& cb);
+	void						DispatchResetCAS(const std::string& sId, std::string& sMustNotEqual, const std::string& sDest, bool bBlocking, bool_cb_t&& cb);
+	void						DispatchIncrByIntCAS(const std::string& sId, int nIncrement, int nUpperBound, bool bBlocking, int_cb_t&& cb);
+	void						DispatchDecrByIntCAS(const std::string& sId, int nDecrement, int nLowerBound, bool bBlocking, int_cb_t&& cb);
+
+	static void					DispatchLootDirtyEntry(void *service_entry, bool bBlocking, result_list_cb_t&& cb);
+	static void					DispatchRestore(void *service_entry, std::string& sIdList, std::string& sListVal, std::string& sIdHashOfCAS, std::string& sHashOfCASVal, bool bBlocking, done_cb_t&& cb);
+
 private:
 	void *_refEntry;
 
@@ -104,6 +268,9 @@ private:
 	std::string _sIdList;
 	std::string _sIdHashOfCAS; // check and set
 	std::string _sIdChanOfNotify; // pub sub notify
+	uint32_t _uCaller;
+	uint32_t _uShardHash; // shard of "module:mainid:subid", for all keys of the object
+	bool _bReadFromReplica = false;
 
 };
 
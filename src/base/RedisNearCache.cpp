@@ -0,0 +1,275 @@
+//------------------------------------------------------------------------------
+//  RedisNearCache.cpp
+//  (C) 2016 n.lee
+//------------------------------------------------------------------------------
+#include "RedisNearCache.h"
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+CRedisNearCache::CRedisNearCache(size_t szCapacityBytes)
+	: _szCapacityBytes(szCapacityBytes)
+	, _nTrackingRedirectId(0) {
+
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+CRedisNearCache::Lookup(const std::string& sKey, const std::string& sField, std::string& sOut) {
+
+	std::lock_guard<std::mutex> lock(_mtx);
+
+	auto it = _mapKey.find(sKey);
+	if (it != _mapKey.end()) {
+		auto itField = (*it).second.find(sField);
+		if (itField != (*it).second.end()) {
+			entry_t& entry = _vEntry[(*itField).second];
+			entry._bRef = true;
+			sOut = entry._sValue;
+
+			++_stats._hits;
+			return true;
+		}
+	}
+
+	++_stats._misses;
+	return false;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+uint64_t
+CRedisNearCache::Epoch() {
+
+	std::lock_guard<std::mutex> lock(_mtx);
+	return _uEpoch;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisNearCache::Store(const std::string& sKey, const std::string& sField, const std::string& sValue, uint64_t uEpoch) {
+
+	size_t szCharge = sKey.length() + sField.length() + sValue.length() + ENTRY_OVERHEAD;
+
+	std::lock_guard<std::mutex> lock(_mtx);
+
+	// the read is not covered by tracking, or raced with an invalidation
+	if (!IsTracking()
+		|| uEpoch < _uFlushEpoch) {
+		++_stats._staleFills;
+		return;
+	}
+
+	auto itInvalid = _mapRecentInvalid.find(sKey);
+	if (itInvalid != _mapRecentInvalid.end()
+		&& (*itInvalid).second > uEpoch) {
+		++_stats._staleFills;
+		return;
+	}
+
+	if (szCharge > _szCapacityBytes)
+		return;
+
+	// replace
+	auto& mapField = _mapKey[sKey];
+	auto itField = mapField.find(sField);
+	if (itField != mapField.end()) {
+		EraseAt((*itField).second);
+	}
+
+	while (_stats._bytes + szCharge > _szCapacityBytes
+		&& EvictOne()) {
+		++_stats._evictions;
+	}
+
+	size_t idx;
+	if (_vFree.size() > 0) {
+		idx = _vFree.back();
+		_vFree.pop_back();
+	}
+	else {
+		idx = _vEntry.size();
+		_vEntry.resize(idx + 1);
+	}
+
+	entry_t& entry = _vEntry[idx];
+	entry._sKey = sKey;
+	entry._sField = sField;
+	entry._sValue = sValue;
+	entry._szCharge = szCharge;
+	entry._bUsed = true;
+	entry._bRef = false;
+
+	// eviction may have erased the field map of "sKey"
+	_mapKey[sKey][sField] = idx;
+
+	_stats._bytes += szCharge;
+	++_stats._entries;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisNearCache::Invalidate(const std::string& sKey) {
+
+	std::lock_guard<std::mutex> lock(_mtx);
+
+	++_uEpoch;
+	++_stats._invalidations;
+
+	if (_mapRecentInvalid.size() >= RECENT_INVALID_MAX) {
+		// forget them all, and drop every read in flight instead
+		_mapRecentInvalid.clear();
+		_uFlushEpoch = _uEpoch;
+	}
+	else {
+		_mapRecentInvalid[sKey] = _uEpoch;
+	}
+
+	auto it = _mapKey.find(sKey);
+	if (it != _mapKey.end()) {
+		std::vector<size_t> vIdx;
+		vIdx.reserve((*it).second.size());
+		for (auto& iter : (*it).second) {
+			vIdx.emplace_back(iter.second);
+		}
+
+		for (auto idx : vIdx) {
+			EraseAt(idx);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisNearCache::InvalidateAll() {
+
+	std::lock_guard<std::mutex> lock(_mtx);
+	InvalidateAllLocked();
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisNearCache::SetTrackingRedirectId(int64_t nId) {
+
+	std::lock_guard<std::mutex> lock(_mtx);
+	_nTrackingRedirectId.store(nId, std::memory_order_release);
+	InvalidateAllLocked();
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+CRedisNearCache::stats_t
+CRedisNearCache::Stats() {
+
+	std::lock_guard<std::mutex> lock(_mtx);
+	return _stats;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisNearCache::EraseAt(size_t idx) {
+
+	entry_t& entry = _vEntry[idx];
+	if (!entry._bUsed)
+		return;
+
+	auto it = _mapKey.find(entry._sKey);
+	if (it != _mapKey.end()) {
+		(*it).second.erase(entry._sField);
+		if ((*it).second.empty()) {
+			_mapKey.erase(it);
+		}
+	}
+
+	_stats._bytes -= entry._szCharge;
+	--_stats._entries;
+
+	entry._bUsed = false;
+	entry._bRef = false;
+	entry._szCharge = 0;
+	entry._sKey.clear();
+	entry._sField.clear();
+	std::string().swap(entry._sValue);
+
+	_vFree.emplace_back(idx);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+CRedisNearCache::EvictOne() {
+
+	if (_stats._entries <= 0)
+		return false;
+
+	// CLOCK: recently hit entries get a second chance, at most two rounds
+	size_t szCount = _vEntry.size();
+	size_t i, idx;
+
+	for (i = 0; i < szCount * 2; ++i) {
+		idx = _szHand;
+		_szHand = (_szHand + 1) % szCount;
+
+		entry_t& entry = _vEntry[idx];
+		if (!entry._bUsed)
+			continue;
+
+		if (entry._bRef) {
+			entry._bRef = false;
+			continue;
+		}
+
+		EraseAt(idx);
+		return true;
+	}
+	return false;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisNearCache::InvalidateAllLocked() {
+
+	++_uEpoch;
+	_uFlushEpoch = _uEpoch;
+	_mapRecentInvalid.clear();
+
+	_stats._invalidations += _stats._entries;
+
+	_vEntry.clear();
+	_vFree.clear();
+	_mapKey.clear();
+	_szHand = 0;
+
+	_stats._bytes = 0;
+	_stats._entries = 0;
+}
+
+/** -- EOF -- **/
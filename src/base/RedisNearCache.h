@@ -0,0 +1,119 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+/**
+@class CRedisNearCache
+
+(C) 2016 n.lee
+*/
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+#include <limits.h>
+
+#include "redis_extern.h"
+
+//------------------------------------------------------------------------------
+/**
+@brief CRedisNearCache
+
+//!
+//! in-process copy of hash fields read by CRedisCacheProxy::Get(), bounded by bytes and evicted
+//! by CLOCK. Kept coherent by server-assisted client side caching: client connections turn on
+//! "CLIENT TRACKING" redirected to the subscriber connection, which forwards every key of
+//! "__redis__:invalidate" here. Invalidation comes from pipe worker threads, lookups from the
+//! callers, so all of it is under "_mtx".
+//!
+*/
+class MY_REDIS_EXTERN CRedisNearCache {
+public:
+	//! ctor & dtor
+	explicit CRedisNearCache(size_t szCapacityBytes);
+	~CRedisNearCache() = default;
+
+	//! copy ctor & assignment operator
+	CRedisNearCache(const CRedisNearCache&) = delete;
+	CRedisNearCache& operator=(const CRedisNearCache&) = delete;
+
+	struct entry_t {
+		std::string _sKey;
+		std::string _sField;
+		std::string _sValue;
+		size_t _szCharge = 0;
+		bool _bUsed = false;
+		bool _bRef = false;
+	};
+
+	struct stats_t {
+		uint64_t _hits = 0;
+		uint64_t _misses = 0;
+		uint64_t _invalidations = 0;
+		uint64_t _evictions = 0;
+		uint64_t _staleFills = 0;
+		size_t _bytes = 0;
+		size_t _entries = 0;
+	};
+
+	//! bytes charged per entry besides key, field and value
+	static const size_t ENTRY_OVERHEAD = 64;
+
+	//! RESP3: no redirect, every client connection gets its own invalidations as push frames
+	static const int64_t TRACKING_SELF = INT64_MAX;
+
+	//! invalidated keys remembered for in-flight reads, all of them are dropped past this
+	static const size_t RECENT_INVALID_MAX = 4096;
+
+public:
+	bool						Lookup(const std::string& sKey, const std::string& sField, std::string& sOut);
+
+	//! taken before the read is committed, Store() drops the value if "sKey" was invalidated since
+	uint64_t					Epoch();
+	void						Store(const std::string& sKey, const std::string& sField, const std::string& sValue, uint64_t uEpoch);
+
+	void						Invalidate(const std::string& sKey);
+	void						InvalidateAll();
+
+	//! client id of the subscriber connection, 0 means invalidations are not delivered now
+	int64_t						TrackingRedirectId() const {
+		return _nTrackingRedirectId.load(std::memory_order_acquire);
+	}
+
+	bool						IsTracking() const {
+		return TrackingRedirectId() > 0;
+	}
+
+	//! a new (or lost) redirect drops everything, invalidations might be missed in between
+	void						SetTrackingRedirectId(int64_t nId);
+
+	stats_t						Stats();
+
+private:
+	void						EraseAt(size_t idx);
+	bool						EvictOne();
+	void						InvalidateAllLocked();
+
+private:
+	std::mutex _mtx;
+	size_t _szCapacityBytes;
+
+	std::vector<entry_t> _vEntry;
+	std::vector<size_t> _vFree;
+	size_t _szHand = 0;
+
+	// key -> field -> entry index
+	std::unordered_map<std::string, std::unordered_map<std::string, size_t>> _mapKey;
+
+	// epoch of the last invalidation of a key, for reads in flight
+	uint64_t _uEpoch = 0;
+	uint64_t _uFlushEpoch = 0;
+	std::unordered_map<std::string, uint64_t> _mapRecentInvalid;
+
+	std::atomic<int64_t> _nTrackingRedirectId;
+
+	stats_t _stats;
+};
+
+/*EOF*/
@@ -23,7 +23,9 @@ CRedisRankingProxy::CRedisRankingProxy(void *entry, const char *sMainId, const c
 	, _sMainId(sMainId)
 	, _sSubid(sSubid)
 	, _sIdZSet(_sModuleName + ":" + _sMainId + ":" + sSubid + ":Z")
-	, _sIdHashOfCAS(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":CAS_H") {
+	, _sIdHashOfCAS(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":CAS_H")
+	, _uCaller(redis_caller_id(_sIdZSet))
+	, _uShardHash(CRedisShardRing::KeyHash(_sModuleName + ":" + _sMainId + ":" + _sSubid)) {
 
 }
 
@@ -37,7 +39,9 @@ CRedisRankingProxy::CRedisRankingProxy(const std::string& sModuleName, const cha
 	, _sMainId(sMainId)
 	, _sSubid(sSubid)
 	, _sIdZSet(_sModuleName + ":" + _sMainId + ":" + sSubid + ":Z")
-	, _sIdHashOfCAS(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":CAS_H") {
+	, _sIdHashOfCAS(_sModuleName + ":" + _sMainId + ":" + _sSubid + ":CAS_H")
+	, _uCaller(redis_caller_id(_sIdZSet))
+	, _uShardHash(CRedisShardRing::KeyHash(_sModuleName + ":" + _sMainId + ":" + _sSubid)) {
 	
 }
 
@@ -57,7 +61,7 @@ void
 CRedisRankingProxy::Commit() {
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().Commit(nullptr);
+	redisservice->ShardClientOf(_uShardHash).Commit(nullptr, _uCaller);
 }
 
 //------------------------------------------------------------------------------
@@ -68,7 +72,7 @@ void
 CRedisRankingProxy::AddToZSet(double dScore, std::string& sMember) {
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().ZAdd(_sIdZSet.c_str(), std::to_string(dScore), sMember);
+	redisservice->ShardClientOf(_uShardHash).ZAdd(_sIdZSet.c_str(), std::to_string(dScore), sMember);
 }
 
 //------------------------------------------------------------------------------
@@ -79,7 +83,7 @@ void
 CRedisRankingProxy::RemoveFromZSet(std::vector<std::string>& vMember) {
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().ZRem(_sIdZSet.c_str(), vMember);
+	redisservice->ShardClientOf(_uShardHash).ZRem(_sIdZSet.c_str(), vMember);
 }
 
 //------------------------------------------------------------------------------
@@ -90,7 +94,7 @@ void
 CRedisRankingProxy::ZScore(std::string& sMember) {
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().ZScore(_sIdZSet.c_str(), sMember);
+	redisservice->ShardClientOf(_uShardHash).ZScore(_sIdZSet.c_str(), sMember);
 };
 
 //------------------------------------------------------------------------------
@@ -98,45 +102,61 @@ CRedisRankingProxy::ZScore(std::string& sMember) {
 
 */
 void
-CRedisRankingProxy::Clear() {
+CRedisRankingProxy::DispatchClear(bool bBlocking, done_cb_t&& cb) {
 
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().EvalSha(
+	redisservice->ShardClientOf(_uShardHash).EvalSha(
 		s_sClear,
 		std::vector<std::string>{ _sIdZSet },
 		std::vector<std::string>{ }
 	);
 
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_null()) {
-		// null means false
-		fprintf(stderr, "[CRedisRankingProxy::Clear()] Ranking(%s) is dirty, you must clean it first before -- Clear() --!!!!",
-			_sIdZSet.c_str());
-		system("pause");
-		exit(-1);
-	}
+	std::string sIdZSet = _sIdZSet;
+	redis_reply_cb_t rcb = std::bind([sIdZSet](done_cb_t& cb, CRedisReply&& reply) {
+		if (reply.ok()
+			&& reply.is_null()) {
+			// null means false
+			fprintf(stderr, "[CRedisRankingProxy::Clear()] Ranking(%s) is dirty, you must clean it first before -- Clear() --!!!!",
+				sIdZSet.c_str());
+			system("pause");
+			exit(-1);
+		}
+
+		if (cb)
+			cb();
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
 /**
 
 */
-double
-CRedisRankingProxy::GetScore(std::string& sMember) {
+void
+CRedisRankingProxy::DispatchGetScore(std::string& sMember, bool bBlocking, double_cb_t&& cb) {
 	
 	redis_service_entry_t *entry = static_cast<redis_service_entry_t *>(_refEntry);
 	IRedisService *redisservice = static_cast<IRedisService *>(entry->_redisservice);
-	redisservice->Client().ZScore(_sIdZSet.c_str(), sMember);
-
-	CRedisReply reply = redisservice->Client().BlockingCommit();
-	if (reply.ok()
-		&& reply.is_string()) {
-		//
-		return atof(reply.as_string().c_str());
-	}
-	return DBL_MIN;
+	redisservice->ShardClientOf(_uShardHash).ZScore(_sIdZSet.c_str(), sMember);
+
+	if (_bReadFromReplica)
+		redisservice->ShardClientOf(_uShardHash).ReadFromReplica();
+
+	redis_reply_cb_t rcb = std::bind([](double_cb_t& cb, CRedisReply&& reply) {
+		double dOut = DBL_MIN;
+		if (reply.ok()
+			&& reply.is_string()) {
+			//
+			dOut = atof(reply.as_string().c_str());
+		}
+
+		if (cb)
+			cb(dOut);
+	}, std::move(cb), std::placeholders::_1);
+
+	redis_dispatch_commit(redisservice->ShardClientOf(_uShardHash), _uCaller, bBlocking, std::move(rcb));
 }
 
 //------------------------------------------------------------------------------
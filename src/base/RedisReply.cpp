@@ -4,41 +4,187 @@
 //------------------------------------------------------------------------------
 #include "RedisError.h"
 #include "RedisReply.h"
+#include "RedisFlatReply.h"
 
-CRedisReply::CRedisReply() {}
+#include <string.h>
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+char *
+CRedisReplySlab::Alloc(size_t size) {
+
+	if (size > (size_t)(_end - _pos)) {
+		// large string owns its block, small ones share the current block which grows from
+		// "FIRST_BLOCK_SIZE" up to "BLOCK_SIZE"
+		if (size > BLOCK_SIZE / 4) {
+			_nBytes += size;
+			_vBlock.emplace_back(new char[size]);
+			return _vBlock.back().get();
+		}
+
+		size_t szBlock = _nextBlockSize;
+		while (szBlock < size) {
+			szBlock <<= 1;
+		}
+		_nextBlockSize = (szBlock < BLOCK_SIZE) ? (szBlock << 1) : BLOCK_SIZE;
+
+		_nBytes += szBlock;
+		_vBlock.emplace_back(new char[szBlock]);
+		_pos = _vBlock.back().get();
+		_end = _pos + szBlock;
+	}
+
+	char *p = _pos;
+	_pos += size;
+	return p;
+}
+
+CRedisReply::CRedisReply()
+	: _intval(0) {}
 
 CRedisReply::CRedisReply(const std::string& value, string_type reply_type)
 	: _type(static_cast<type>(reply_type))
-	, _strval(value)
-	, _intval(0) {}
+	, _store(STORE_STRING)
+	, _strval(value) {}
 
 CRedisReply::CRedisReply(int64_t value)
 	: _type(type::integer)
+	, _store(STORE_INT)
 	, _intval(value) {}
 
 CRedisReply::CRedisReply(const std::vector<CRedisReply>& rows)
 	: _type(type::array)
-	, _rows(rows)
-	, _intval(0) {}
+	, _store(STORE_ROWS)
+	, _rows(rows) {}
+
+CRedisReply::CRedisReply(CRedisReply&& rhs) noexcept
+	: _type(rhs._type)
+	, _intval(0) {
+
+	MoveFrom(rhs);
+}
 
-CRedisReply::CRedisReply(CRedisReply&& rhs)
+CRedisReply::CRedisReply(const CRedisReply& rhs)
 	: _type(rhs._type)
-	, _rows(std::move(rhs._rows))
-	, _strval(std::move(rhs._strval))
-	, _intval(rhs._intval) {}
+	, _intval(0) {
+
+	CopyFrom(rhs);
+}
+
+CRedisReply::~CRedisReply() {
+	Destroy();
+	delete _rare;
+}
 
 CRedisReply&
-CRedisReply::operator=(CRedisReply&& rhs) {
-	_type = rhs._type;
-	_rows = std::move(rhs._rows);
-	_strval = std::move(rhs._strval);
-	_intval = rhs._intval;
+CRedisReply::operator=(const CRedisReply& rhs) {
+	// "rhs" may live in "_rows" or "_rare" of this one
+	if (this != &rhs) {
+		CRedisReply tmp(rhs);
+		*this = std::move(tmp);
+	}
+	return *this;
+}
 
-	rhs._type = type::null;
-	rhs._intval = 0;
+CRedisReply&
+CRedisReply::operator=(CRedisReply&& rhs) noexcept {
+	if (this != &rhs) {
+		// same as above, out of "rhs" before anything of this one is gone
+		CRedisReply tmp(std::move(rhs));
+		Destroy();
+		delete _rare;
+		_type = tmp._type;
+		MoveFrom(tmp);
+	}
 	return *this;
 }
 
+void
+CRedisReply::Destroy() noexcept {
+	switch (_store) {
+	case STORE_STRING:
+		_strval.~basic_string();
+		break;
+	case STORE_VIEW:
+		_view.~view_t();
+		break;
+	case STORE_ROWS:
+		_rows.~vector();
+		break;
+	case STORE_FLAT:
+		_flat.~flat_t();
+		break;
+	default:
+		break;
+	}
+	_intval = 0;
+	_store = STORE_NONE;
+}
+
+void
+CRedisReply::CopyFrom(const CRedisReply& rhs) {
+	switch (rhs._store) {
+	case STORE_INT:
+		_intval = rhs._intval;
+		break;
+	case STORE_STRING:
+		::new (&_strval) std::string(rhs._strval);
+		break;
+	case STORE_VIEW:
+		::new (&_view) view_t(rhs._view);
+		break;
+	case STORE_ROWS:
+		::new (&_rows) std::vector<CRedisReply>(rhs._rows);
+		break;
+	case STORE_FLAT:
+		::new (&_flat) flat_t(rhs._flat);
+		break;
+	default:
+		break;
+	}
+	_store = rhs._store;
+	_rare = rhs._rare ? new rare_t(*rhs._rare) : nullptr;
+}
+
+void
+CRedisReply::MoveFrom(CRedisReply& rhs) noexcept {
+	switch (rhs._store) {
+	case STORE_INT:
+		_intval = rhs._intval;
+		break;
+	case STORE_STRING:
+		::new (&_strval) std::string(std::move(rhs._strval));
+		break;
+	case STORE_VIEW:
+		::new (&_view) view_t(std::move(rhs._view));
+		break;
+	case STORE_ROWS:
+		::new (&_rows) std::vector<CRedisReply>(std::move(rhs._rows));
+		break;
+	case STORE_FLAT:
+		::new (&_flat) flat_t(std::move(rhs._flat));
+		break;
+	default:
+		break;
+	}
+	_store = rhs._store;
+	_rare = rhs._rare;
+
+	rhs.Destroy();
+	rhs._type = type::null;
+	rhs._rare = nullptr;
+}
+
+CRedisReply::rare_t&
+CRedisReply::Rare() {
+	if (!_rare)
+		_rare = new rare_t;
+
+	return *_rare;
+}
+
 bool
 CRedisReply::ok() const {
 	return !is_error();
@@ -63,35 +209,142 @@ CRedisReply::operator bool() const {
 
 void
 CRedisReply::set() {
+	Destroy();
 	_type = type::null;
 }
 
 void
 CRedisReply::set(std::string&& value, string_type reply_type) {
+	if (STORE_STRING == _store) {
+		_strval = std::move(value);
+	}
+	else {
+		Destroy();
+		::new (&_strval) std::string(std::move(value));
+		_store = STORE_STRING;
+	}
+	_type = static_cast<type>(reply_type);
+}
+
+void
+CRedisReply::set_view(const char *data, size_t size, string_type reply_type, const redis_reply_slab_ptr_t& slab) {
+	view_t view{ data, size, slab };
+	Destroy();
+	::new (&_view) view_t(std::move(view));
+	_store = STORE_VIEW;
 	_type = static_cast<type>(reply_type);
-	_strval = std::move(value);
 }
 
 void
 CRedisReply::set(int64_t value) {
-	_type = type::integer;
+	Destroy();
 	_intval = value;
+	_store = STORE_INT;
+	_type = type::integer;
 }
 
 void
 CRedisReply::set(std::vector<CRedisReply>&& rows) {
-	_type = type::array;
-	_rows = std::move(rows);
+	set_aggregate(std::move(rows), type::array);
+}
+
+void
+CRedisReply::set_double(double value, std::string&& text) {
+	set(std::move(text), string_type::simple_string);
+	_type = type::double_number;
+	Rare()._dblval = value;
+}
+
+void
+CRedisReply::set_boolean(bool value) {
+	Destroy();
+	_intval = value ? 1 : 0;
+	_store = STORE_INT;
+	_type = type::boolean;
+}
+
+void
+CRedisReply::set_aggregate(std::vector<CRedisReply>&& rows, type aggregate_type) {
+	if (STORE_ROWS == _store) {
+		_rows = std::move(rows);
+	}
+	else {
+		Destroy();
+		::new (&_rows) std::vector<CRedisReply>(std::move(rows));
+		_store = STORE_ROWS;
+	}
+	_type = aggregate_type;
+}
+
+void
+CRedisReply::set_verbatim_format(const char *fmt) {
+	rare_t& rare = Rare();
+	memcpy(rare._verbatimfmt, fmt, 3);
+	rare._verbatimfmt[3] = '\0';
+}
+
+void
+CRedisReply::set_attributes(std::vector<CRedisReply>&& attrs) {
+	Rare()._attrs = std::move(attrs);
+}
+
+void
+CRedisReply::set_flat(const redis_flat_reply_ptr_t& flat, uint32_t idx) {
+	// "flat" may be the one in use
+	flat_t node{ flat, idx };
+	Destroy();
+	::new (&_flat) flat_t(std::move(node));
+	_store = STORE_FLAT;
+	_type = static_cast<type>(_flat._flat->NodeAt(idx)._type);
 }
 
 bool
 CRedisReply::is_array() const {
-	return _type == type::array;
+	return _type == type::array
+		|| _type == type::map
+		|| _type == type::set
+		|| _type == type::push;
 }
 
 bool
 CRedisReply::is_string() const {
-	return is_simple_string() || is_bulk_string() || is_error();
+	return is_simple_string() || is_bulk_string() || is_error()
+		|| is_double() || is_big_number() || is_verbatim_string();
+}
+
+bool
+CRedisReply::is_double() const {
+	return _type == type::double_number;
+}
+
+bool
+CRedisReply::is_boolean() const {
+	return _type == type::boolean;
+}
+
+bool
+CRedisReply::is_big_number() const {
+	return _type == type::big_number;
+}
+
+bool
+CRedisReply::is_verbatim_string() const {
+	return _type == type::verbatim_string;
+}
+
+bool
+CRedisReply::is_map() const {
+	return _type == type::map;
+}
+
+bool
+CRedisReply::is_set() const {
+	return _type == type::set;
+}
+
+bool
+CRedisReply::is_push() const {
+	return _type == type::push;
 }
 
 bool
@@ -124,6 +377,12 @@ CRedisReply::as_array() {
 	if (!is_array())
 		throw CRedisError("Reply is not an array");
 
+	MaterializeFlat();
+	if (STORE_ROWS != _store) {
+		Destroy();
+		::new (&_rows) std::vector<CRedisReply>();
+		_store = STORE_ROWS;
+	}
 	return _rows;
 }
 
@@ -132,16 +391,85 @@ CRedisReply::as_string() {
 	if (!is_string())
 		throw CRedisError("Reply is not a string");
 
+	MaterializeView();
+	if (STORE_STRING != _store) {
+		Destroy();
+		::new (&_strval) std::string();
+		_store = STORE_STRING;
+	}
 	return _strval;
 }
 
 const std::string&
 CRedisReply::as_safe_string() {
-	if (!is_string()) {
-		static std::string sEmpty;
+	static std::string sEmpty;
+	if (!is_string())
 		return sEmpty;
+
+	MaterializeView();
+	return (STORE_STRING == _store) ? _strval : sEmpty;
+}
+
+CRedisReply::string_view_t
+CRedisReply::as_view() const {
+	if (!is_string())
+		throw CRedisError("Reply is not a string");
+
+	if (STORE_VIEW == _store)
+		return string_view_t{ _view._data, _view._size };
+
+	if (STORE_STRING == _store)
+		return string_view_t{ _strval.data(), _strval.length() };
+
+	return string_view_t{ "", 0 };
+}
+
+bool
+CRedisReply::is_view() const {
+	return STORE_VIEW == _store;
+}
+
+void
+CRedisReply::MaterializeView() {
+	// copy out on demand, the slab is released when no view is left
+	if (STORE_VIEW == _store) {
+		std::string str(_view._data, _view._size);
+		Destroy();
+		::new (&_strval) std::string(std::move(str));
+		_store = STORE_STRING;
+	}
+}
+
+bool
+CRedisReply::is_flat() const {
+	return STORE_FLAT == _store;
+}
+
+CRedisReplyElement
+CRedisReply::as_element() const {
+	if (STORE_FLAT != _store)
+		throw CRedisError("Reply is not flat");
+
+	return CRedisReplyElement(&_flat._flat, _flat._idx);
+}
+
+void
+CRedisReply::MaterializeFlat() {
+	// elements are built once, strings stay views into the slab
+	if (STORE_FLAT == _store) {
+		CRedisReplyElement element(&_flat._flat, _flat._idx);
+		size_t i, szNum = element.size();
+
+		std::vector<CRedisReply> vRows;
+		vRows.reserve(szNum);
+		for (i = 0; i < szNum; ++i) {
+			vRows.emplace_back(element[i].to_reply());
+		}
+
+		Destroy();
+		::new (&_rows) std::vector<CRedisReply>(std::move(vRows));
+		_store = STORE_ROWS;
 	}
-	return _strval;
 }
 
 int64_t
@@ -152,6 +480,40 @@ CRedisReply::as_integer() const {
 	return _intval;
 }
 
+double
+CRedisReply::as_double() const {
+	if (!is_double())
+		throw CRedisError("Reply is not a double");
+
+	return _rare ? _rare->_dblval : 0.0;
+}
+
+bool
+CRedisReply::as_boolean() const {
+	if (!is_boolean())
+		throw CRedisError("Reply is not a boolean");
+
+	return _intval != 0;
+}
+
+const char *
+CRedisReply::verbatim_format() const {
+	if (!is_verbatim_string())
+		throw CRedisError("Reply is not a verbatim string");
+
+	return _rare ? _rare->_verbatimfmt : "";
+}
+
+bool
+CRedisReply::has_attributes() const {
+	return _rare && _rare->_attrs.size() > 0;
+}
+
+std::vector<CRedisReply>&
+CRedisReply::attributes() {
+	return Rare()._attrs;
+}
+
 CRedisReply::type
 CRedisReply::get_type() const {
 	return _type;
@@ -175,7 +537,18 @@ operator<<(std::ostream& os, CRedisReply&& reply) {
 	case CRedisReply::type::integer:
 		os << reply.as_integer();
 		break;
+	case CRedisReply::type::double_number:
+	case CRedisReply::type::big_number:
+	case CRedisReply::type::verbatim_string:
+		os << reply.as_string();
+		break;
+	case CRedisReply::type::boolean:
+		os << (reply.as_boolean() ? "(true)" : "(false)");
+		break;
 	case CRedisReply::type::array:
+	case CRedisReply::type::map:
+	case CRedisReply::type::set:
+	case CRedisReply::type::push:
 		for (const auto& item : reply.as_array())
 			os << item;
 		break;
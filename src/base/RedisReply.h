@@ -10,14 +10,36 @@
 #include <vector>
 #include <iostream>
 #include <functional>
+#include <memory>
 #include <stdint.h>
 
 #include "redis_extern.h"
+#include "RedisCallback.h"
 
 class CRedisReply;
-using redis_reply_cb_t = std::function<void(CRedisReply&&)>;
+using redis_reply_cb_t = CRedisCallback<void(CRedisReply&&)>;
 
-using dispose_cb_t = std::function<void()>;
+using dispose_cb_t = CRedisCallback<void()>;
+
+/* callback of a cmd pipeline, it usually wraps a redis_reply_cb_t of the caller -- room for one inline */
+using redis_pipeline_cb_t = CRedisCallback<void(CRedisReply&&), REDIS_CALLBACK_INLINE_SIZE + 64>;
+
+/* visitor of a streamed reply, see IRedisClient::StreamReply() */
+struct redis_reply_element_t;
+using redis_element_cb_t = CRedisCallback<void(const redis_reply_element_t&)>;
+
+/* sink of a bulk string reply taken in pieces, see IRedisClient::StreamBulkString() */
+using redis_bulk_chunk_cb_t = CRedisCallback<void(const char *data, size_t len, size_t remain)>;
+
+/* replies of a merged pipeline ahead of its tail one, "nth" counts them from 1 */
+using redis_segment_cb_t = CRedisCallback<void(int nth, CRedisReply&&)>;
+
+/* callbacks of a pipeline with a deadline, fired once: by its tail reply or by the timer wheel */
+struct redis_cmd_pipepline_deadline_t {
+	redis_pipeline_cb_t _reply_cb;
+	dispose_cb_t _dispose_cb;
+	bool _fired = false;
+};
 
 struct redis_cmd_pipepline_t {
 	/* pipeline state */
@@ -33,11 +55,88 @@ struct redis_cmd_pipepline_t {
 	std::string _commands;
 	int _built_num;
 	int _processed_num;
-	redis_reply_cb_t _reply_cb;
+	redis_pipeline_cb_t _reply_cb;
 	dispose_cb_t _dispose_cb;
 	PIPELINE_STATE _state;
+
+	/* pipelines of the same caller are kept in order on one connection */
+	uint32_t _caller = 0;
+
+	/* read-only pipeline which may be served by a replica */
+	bool _replica = false;
+
+	/* timeout in milliseconds, 0 means none. Armed by the pipe worker, the callbacks move into "_deadline" */
+	uint32_t _timeout_ms = 0;
+	std::shared_ptr<redis_cmd_pipepline_deadline_t> _deadline;
+
+	/* refused by backpressure at commit, the pipe worker calls it back with a "BUSY" error without sending */
+	bool _rejected = false;
+
+	/* over the limit with BACKPRESSURE_DROP_OLDEST: the pipe worker drops the oldest pipeline not written yet
+	   for it, or refuses it like "_rejected" when there is none */
+	bool _drop_oldest = false;
+
+	/* producer queue of the work queue which "_commands" go back to when the pipeline is over, -1 means none */
+	int _owner = -1;
+
+	/* elements of the tail reply go to it while being parsed, the reply is not built */
+	redis_element_cb_t _element_cb;
+
+	/* bytes of the tail reply go to it as they arrive when it is a bulk string, the string is not kept */
+	redis_bulk_chunk_cb_t _chunk_cb;
+
+	/* commits merged by auto-pipelining: replies ahead of the tail one go to it too, the tail one and
+	   failures only go to "_reply_cb" */
+	redis_segment_cb_t _segment_cb;
+
+	/* merged commits: command num at the end of each one. A reconnect resends only the commits without
+	   their tail reply yet, "_segment_base" commands are cut from the front and "nth" goes on from it */
+	std::vector<int> _vSegmentEnd;
+	int _segment_base = 0;
 };
 
+//------------------------------------------------------------------------------
+/**
+@brief CRedisReplySlab
+
+//!
+//! bulk string bytes of one reply, shared by all of its string views
+//!
+*/
+class MY_REDIS_EXTERN CRedisReplySlab {
+public:
+	static const size_t FIRST_BLOCK_SIZE = 256;
+	static const size_t BLOCK_SIZE = 16 * 1024;
+
+	//! ctor & dtor
+	CRedisReplySlab() = default;
+	~CRedisReplySlab() = default;
+
+	//! copy ctor & assignment operator
+	CRedisReplySlab(const CRedisReplySlab&) = delete;
+	CRedisReplySlab& operator=(const CRedisReplySlab&) = delete;
+
+public:
+	char * Alloc(size_t size);
+
+	//! bytes of all blocks
+	size_t Bytes() const {
+		return _nBytes;
+	}
+
+private:
+	std::vector<std::unique_ptr<char[]>> _vBlock;
+	size_t _nBytes = 0;
+	char *_pos = nullptr;
+	char *_end = nullptr;
+	size_t _nextBlockSize = FIRST_BLOCK_SIZE;
+};
+using redis_reply_slab_ptr_t = std::shared_ptr<CRedisReplySlab>;
+
+class CRedisFlatReply;
+class CRedisReplyElement;
+using redis_flat_reply_ptr_t = std::shared_ptr<CRedisFlatReply>;
+
 //------------------------------------------------------------------------------
 /**
 @brief CRedisReply
@@ -51,6 +150,15 @@ public:
 		REDIS_REPLY_TYPE_NULL = 3,
 		REDIS_REPLY_TYPE_INT = 4,
 		REDIS_REPLY_TYPE_ARRAY = 5,
+
+		// RESP3
+		REDIS_REPLY_TYPE_DOUBLE = 6,
+		REDIS_REPLY_TYPE_BOOLEAN = 7,
+		REDIS_REPLY_TYPE_BIG_NUMBER = 8,
+		REDIS_REPLY_TYPE_VERBATIM = 9,
+		REDIS_REPLY_TYPE_MAP = 10,
+		REDIS_REPLY_TYPE_SET = 11,
+		REDIS_REPLY_TYPE_PUSH = 12,
 	};
 
 	enum class type {
@@ -59,13 +167,28 @@ public:
 		simple_string = REDIS_REPLY_TYPE_SIMPLE,
 		null = REDIS_REPLY_TYPE_NULL,
 		integer = REDIS_REPLY_TYPE_INT,
-		array = REDIS_REPLY_TYPE_ARRAY
+		array = REDIS_REPLY_TYPE_ARRAY,
+		double_number = REDIS_REPLY_TYPE_DOUBLE,
+		boolean = REDIS_REPLY_TYPE_BOOLEAN,
+		big_number = REDIS_REPLY_TYPE_BIG_NUMBER,
+		verbatim_string = REDIS_REPLY_TYPE_VERBATIM,
+		map = REDIS_REPLY_TYPE_MAP,
+		set = REDIS_REPLY_TYPE_SET,
+		push = REDIS_REPLY_TYPE_PUSH
 	};
 
 	enum class string_type {
 		error = REDIS_REPLY_TYPE_ERR,
 		bulk_string = REDIS_REPLY_TYPE_BULK,
-		simple_string = REDIS_REPLY_TYPE_SIMPLE
+		simple_string = REDIS_REPLY_TYPE_SIMPLE,
+		big_number = REDIS_REPLY_TYPE_BIG_NUMBER,
+		verbatim_string = REDIS_REPLY_TYPE_VERBATIM
+	};
+
+	//! read only bytes of a string reply, valid as long as the reply (or a copy of it) is alive
+	struct string_view_t {
+		const char *_data;
+		size_t _size;
 	};
 
 	//! ctors
@@ -73,16 +196,18 @@ public:
 	CRedisReply(const std::string& value, string_type reply_type);
 	CRedisReply(int64_t value);
 	CRedisReply(const std::vector<CRedisReply>& rows);
-	CRedisReply(CRedisReply&&);
+	CRedisReply(CRedisReply&&) noexcept;
 
 	//! dtors & copy ctor & assignment operator
-	~CRedisReply() = default;
-	CRedisReply(const CRedisReply&) = default;
-	CRedisReply& operator=(const CRedisReply&) = default;
-	CRedisReply& operator=(CRedisReply&&);
+	~CRedisReply();
+	CRedisReply(const CRedisReply&);
+	CRedisReply& operator=(const CRedisReply&);
+	CRedisReply& operator=(CRedisReply&&) noexcept;
 
 public:
-	//! type info getters
+	//! type info getters -- is_array() is true for every aggregate (array, map, set, push) and is_string()
+	//! for every reply carrying text (double and big number keep the text sent by the server), so RESP2
+	//! code goes on working with "HELLO 3"
 	bool is_array() const;
 	bool is_string() const;
 	bool is_simple_string() const;
@@ -91,6 +216,15 @@ public:
 	bool is_integer() const;
 	bool is_null() const;
 
+	//! RESP3 type info getters
+	bool is_double() const;
+	bool is_boolean() const;
+	bool is_big_number() const;
+	bool is_verbatim_string() const;
+	bool is_map() const;
+	bool is_set() const;
+	bool is_push() const;
+
 	//! convenience function for error handling
 	bool ok() const;
 	bool ko() const;
@@ -103,25 +237,111 @@ public:
 	std::vector<CRedisReply>& as_array();
 	std::string& as_string();
 	const std::string& as_safe_string();
+	string_view_t as_view() const;
 	int64_t as_integer() const;
+	double as_double() const;
+	bool as_boolean() const;
+
+	//! 3 chars such as "txt" or "mkd" of a verbatim string, as_string() is the text after "xxx:"
+	const char * verbatim_format() const;
+
+	//! RESP3 attribute sent ahead of the reply, flattened key and value pairs
+	bool has_attributes() const;
+	std::vector<CRedisReply>& attributes();
+
+	//! whether the string is still a view into the reply slab (no std::string made yet)
+	bool is_view() const;
+
+	//! whether the aggregate is still flat as received, see CRedisFlatReply. as_array() builds the
+	//! elements once and ends it, as_element() walks them in place (include "RedisFlatReply.h")
+	bool is_flat() const;
+	CRedisReplyElement as_element() const;
 
 	//! Value setters
 	void set();
 	void set(std::string&& value, string_type reply_type);
 	void set(int64_t value);
 	void set(std::vector<CRedisReply>&& rows);
+	void set_view(const char *data, size_t size, string_type reply_type, const redis_reply_slab_ptr_t& slab);
+
+	//! RESP3 setters
+	void set_double(double value, std::string&& text);
+	void set_boolean(bool value);
+	void set_aggregate(std::vector<CRedisReply>&& rows, type aggregate_type);
+	void set_verbatim_format(const char *fmt);
+	void set_attributes(std::vector<CRedisReply>&& attrs);
+
+	//! aggregate at node "idx" of "flat"
+	void set_flat(const redis_flat_reply_ptr_t& flat, uint32_t idx);
 
 	//! type getter
 	type get_type() const;
 
 private:
+	//! member of the union holding the value -- "_type" alone does not tell a view from a string
+	enum STORE {
+		STORE_NONE = 0,
+		STORE_INT = 1,				// integer and boolean
+		STORE_STRING = 2,
+		STORE_VIEW = 3,
+		STORE_ROWS = 4,
+		STORE_FLAT = 5,
+	};
+
+	//! zero-copy string
+	struct view_t {
+		const char *_data;
+		size_t _size;
+		redis_reply_slab_ptr_t _slab;
+	};
+
+	//! flat aggregate, no rows until as_array()
+	struct flat_t {
+		redis_flat_reply_ptr_t _flat;
+		uint32_t _idx;
+	};
+
+	//! RESP3 extras that most replies never have, out of line
+	struct rare_t {
+		double _dblval = 0.0;
+		char _verbatimfmt[4] = { 0 };
+		std::vector<CRedisReply> _attrs;
+	};
+
 	type _type = type::null;
-	std::vector<CRedisReply> _rows;
-	std::string _strval;
-	int64_t _intval = 0;
+	uint8_t _store = STORE_NONE;
+	union {
+		int64_t _intval;
+		std::string _strval;
+		std::vector<CRedisReply> _rows;
+		view_t _view;
+		flat_t _flat;
+	};
+	rare_t *_rare = nullptr;
+
+private:
+	//! ends the member in use, "_store" is STORE_NONE after it
+	void Destroy() noexcept;
+	void CopyFrom(const CRedisReply& rhs);
+	void MoveFrom(CRedisReply& rhs) noexcept;
+
+	rare_t& Rare();
+
+	void MaterializeView();
+	void MaterializeFlat();
 };
 
 //! support for output
 std::ostream& operator<<(std::ostream& os, CRedisReply&& reply);
 
+/* one element of a streamed reply, the view is valid during the visit only */
+struct redis_reply_element_t {
+	int _depth;								/* 1 for elements of the reply, 2 for theirs ... */
+	CRedisReply::type _type;
+	bool _null;
+	size_t _size;							/* aggregate: element num, keys and values both count in a map */
+	int64_t _integer;						/* integer, boolean */
+	CRedisReply::string_view_t _view;		/* every string type, double and big number as text */
+};
+
 /*EOF*/
\ No newline at end of file
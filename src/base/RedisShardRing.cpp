@@ -0,0 +1,84 @@
+//------------------------------------------------------------------------------
+//  RedisShardRing.cpp
+//  (C) 2016 n.lee
+//------------------------------------------------------------------------------
+#include "RedisShardRing.h"
+
+#include <algorithm>
+
+#include "crc64.h"
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisShardRing::Add(const std::string& sIp, unsigned short port) {
+	std::string sName = sIp + ":" + std::to_string(port) + "-";
+	size_t szPrefix = sName.length();
+	uint32_t uShard = (uint32_t)_nShardNum;
+	int i;
+
+	for (i = 0; i < POINT_NUM; ++i) {
+		sName.resize(szPrefix);
+		sName += std::to_string(i);
+
+		point_t pt;
+		pt._hash = Hash(sName.c_str(), sName.length());
+		pt._shard = uShard;
+		_vPoint.emplace_back(pt);
+	}
+
+	// equal hashes keep the earlier shard first, so the ring does not depend on sort stability
+	std::sort(_vPoint.begin(), _vPoint.end(), [](const point_t& a, const point_t& b) {
+		return (a._hash < b._hash) || (a._hash == b._hash && a._shard < b._shard);
+	});
+	++_nShardNum;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+size_t
+CRedisShardRing::Locate(uint32_t uKeyHash) const {
+	if (_vPoint.empty())
+		return 0;
+
+	auto it = std::lower_bound(_vPoint.begin(), _vPoint.end(), uKeyHash, [](const point_t& pt, uint32_t h) {
+		return pt._hash < h;
+	});
+
+	// wrap around
+	if (it == _vPoint.end())
+		it = _vPoint.begin();
+
+	return (*it)._shard;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+uint32_t
+CRedisShardRing::KeyHash(const std::string& sKey) {
+	return Hash(sKey.c_str(), sKey.length());
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+uint32_t
+CRedisShardRing::Hash(const char *s, size_t len) {
+	// crc64 of near names differs in few bits, the 64-bit finalizer of murmur3 spreads them
+	uint64_t h = crc64(0, (const unsigned char *)s, len);
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return (uint32_t)(h >> 32);
+}
+
+/** -- EOF -- **/
@@ -0,0 +1,60 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+/**
+@class CRedisShardRing
+
+(C) 2016 n.lee
+*/
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "redis_extern.h"
+
+//------------------------------------------------------------------------------
+/**
+@brief CRedisShardRing
+
+//!
+//! ketama style consistent hash ring over standalone redis servers: every shard puts POINT_NUM
+//! points on a 32-bit ring, named by "ip:port" so adding or removing one server only moves the
+//! keys next to its points. A key goes to the first point at or after its hash.
+//!
+*/
+class MY_REDIS_EXTERN CRedisShardRing {
+public:
+	//! ctor & dtor
+	CRedisShardRing() = default;
+	~CRedisShardRing() = default;
+
+	static const int POINT_NUM = 160;
+
+	struct point_t {
+		uint32_t _hash;
+		uint32_t _shard;
+	};
+
+public:
+	//! shard index is the add order
+	void						Add(const std::string& sIp, unsigned short port);
+
+	size_t						Size() const {
+		return _nShardNum;
+	}
+
+	//! shard of the key hash, 0 when the ring is empty
+	size_t						Locate(uint32_t uKeyHash) const;
+
+	//! hash of "module:mainid:subid", all keys of one proxy object share it
+	static uint32_t				KeyHash(const std::string& sKey);
+
+private:
+	static uint32_t				Hash(const char *s, size_t len);
+
+private:
+	std::vector<point_t> _vPoint;
+	size_t _nShardNum = 0;
+};
+
+/*EOF*/
@@ -0,0 +1,176 @@
+//------------------------------------------------------------------------------
+//  RedisWriteBehind.cpp
+//  (C) 2016 n.lee
+//------------------------------------------------------------------------------
+#include "RedisWriteBehind.h"
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+CRedisWriteBehind::CRedisWriteBehind(uint32_t nWindowMs)
+	: _window(nWindowMs) {
+
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisWriteBehind::Put(const std::string& sIdHash, const std::string& sIdHashOfDirty, const std::string& sIdHashOfDirtyState,
+	const std::string& sDirtyEntry, uint32_t uShardHash, uint32_t uCaller, const std::string& sField, int op, std::string&& sValue) {
+
+	std::lock_guard<std::mutex> lock(_mtx);
+
+	++_stats._puts;
+
+	if (_mapObject.empty())
+		_tpFirst = clock_type::now();
+
+	auto it = _mapObject.find(sIdHash);
+	if (it == _mapObject.end()) {
+		object_t& obj = _mapObject[sIdHash];
+		obj._sIdHash = sIdHash;
+		obj._sIdHashOfDirty = sIdHashOfDirty;
+		obj._sIdHashOfDirtyState = sIdHashOfDirtyState;
+		obj._sDirtyEntry = sDirtyEntry;
+		obj._uShardHash = uShardHash;
+		obj._uCaller = uCaller;
+		it = _mapObject.find(sIdHash);
+	}
+
+	auto& mapWrite = (*it).second._mapWrite;
+	auto itWrite = mapWrite.find(sField);
+	if (itWrite == mapWrite.end()) {
+		write_t& w = mapWrite[sField];
+		w._op = op;
+		w._sValue = std::move(sValue);
+		++_stats._pending;
+		return;
+	}
+
+	write_t& w = (*itWrite).second;
+	++_stats._coalesced;
+
+	if (WRITE_REMOVE == op) {
+		if (WRITE_ADD == w._op) {
+			// never reached redis, nothing to remove
+			mapWrite.erase(itWrite);
+			--_stats._pending;
+			++_stats._cancelled;
+
+			if (mapWrite.empty())
+				_mapObject.erase(it);
+			return;
+		}
+
+		w._op = WRITE_REMOVE;
+		w._sValue.clear();
+	}
+	else {
+		// a pending add stays an add, anything else already exists in the backing store
+		if (WRITE_ADD != w._op)
+			w._op = WRITE_UPDATE;
+
+		w._sValue = std::move(sValue);
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+CRedisWriteBehind::Lookup(const std::string& sIdHash, const std::string& sField, std::string& sOut) {
+
+	std::lock_guard<std::mutex> lock(_mtx);
+
+	auto it = _mapObject.find(sIdHash);
+	if (it != _mapObject.end()) {
+		auto itWrite = (*it).second._mapWrite.find(sField);
+		if (itWrite != (*it).second._mapWrite.end()) {
+			const write_t& w = (*itWrite).second;
+			if (WRITE_REMOVE == w._op)
+				sOut.clear();
+			else
+				sOut = w._sValue;
+			return true;
+		}
+	}
+	return false;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+CRedisWriteBehind::Take(const std::string& sIdHash, object_t& out) {
+
+	std::lock_guard<std::mutex> lock(_mtx);
+
+	auto it = _mapObject.find(sIdHash);
+	if (it == _mapObject.end())
+		return false;
+
+	out = std::move((*it).second);
+	_mapObject.erase(it);
+
+	_stats._pending -= out._mapWrite.size();
+	return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisWriteBehind::TakeAll(object_map_t& out) {
+
+	std::lock_guard<std::mutex> lock(_mtx);
+
+	out.clear();
+	out.swap(_mapObject);
+
+	if (!out.empty())
+		++_stats._flushes;
+
+	_stats._pending = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+CRedisWriteBehind::IsDue() {
+
+	std::lock_guard<std::mutex> lock(_mtx);
+	return !_mapObject.empty()
+		&& clock_type::now() - _tpFirst >= _window;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+CRedisWriteBehind::IsEmpty() {
+
+	std::lock_guard<std::mutex> lock(_mtx);
+	return _mapObject.empty();
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+CRedisWriteBehind::stats_t
+CRedisWriteBehind::Stats() {
+
+	std::lock_guard<std::mutex> lock(_mtx);
+	return _stats;
+}
+
+/** -- EOF -- **/
@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "reply_parser/reply_parser.h"
+#include "reply_parser/reply_build_helper.h"
+#include "reply_parser/reply_scan.h"
+
+#define BENCH_ROUND_NUM       20
+#define BENCH_HASH_FIELD_NUM  5000
+#define BENCH_LIST_NUM        5000
+#define BENCH_HEADER_NUM      1000000
+#define BENCH_READ_SIZE       16384
+
+struct stream_builder {
+	char *data;
+	size_t len;
+	size_t cap;
+};
+
+static void
+__append(struct stream_builder *sb, const char *s, size_t len)
+{
+	if (sb->len + len > sb->cap) {
+		sb->cap = (sb->len + len) * 2;
+		sb->data = realloc(sb->data, sb->cap);
+	}
+	memcpy(sb->data + sb->len, s, len);
+	sb->len += len;
+}
+
+static void
+__appendf(struct stream_builder *sb, const char *fmt, long long v)
+{
+	char buf[64];
+	int n = snprintf(buf, sizeof(buf), fmt, v);
+	__append(sb, buf, (size_t)n);
+}
+
+static void
+__append_bulk(struct stream_builder *sb, const char *s)
+{
+	size_t len = strlen(s);
+
+	__appendf(sb, "$%lld\r\n", (long long)len);
+	__append(sb, s, len);
+	__append(sb, "\r\n", 2);
+}
+
+/* HGETALL, LRANGE of integers, status and error replies */
+static void
+__record_stream(struct stream_builder *sb)
+{
+	char field[64], value[64];
+	char err[512];
+	int i;
+
+	__appendf(sb, "*%lld\r\n", (long long)BENCH_HASH_FIELD_NUM * 2);
+	for (i = 0; i < BENCH_HASH_FIELD_NUM; ++i) {
+		snprintf(field, sizeof(field), "field:%d", i);
+		snprintf(value, sizeof(value), "%d", i * 37);
+		__append_bulk(sb, field);
+		__append_bulk(sb, value);
+	}
+
+	__appendf(sb, "*%lld\r\n", (long long)BENCH_LIST_NUM);
+	for (i = 0; i < BENCH_LIST_NUM; ++i) {
+		__appendf(sb, ":%lld\r\n", (long long)i * 1000003);
+	}
+
+	for (i = 0; i < 1000; ++i) {
+		__append(sb, "+OK\r\n", 5);
+	}
+
+	memset(err, 'e', sizeof(err));
+	memcpy(err, "-ERR ", 5);
+	memcpy(err + sizeof(err) - 2, "\r\n", 2);
+	for (i = 0; i < 1000; ++i) {
+		__append(sb, err, sizeof(err));
+	}
+}
+
+static int
+on_reply(redis_reply_t *r, void *payload)
+{
+	int *count = (int *)payload;
+
+	(void *)r;
+	++(*count);
+	return 0;
+}
+
+/* feed "data" in socket sized reads, as the client connection does */
+static int
+__parse_stream(redis_reply_parser_t *rrp, const char *data, size_t len)
+{
+	bip_buf_t *bb = rrp->in_bb;
+	size_t pos, want, size;
+	char *w;
+
+	for (pos = 0; pos < len; ) {
+		want = len - pos;
+		if (want > BENCH_READ_SIZE)
+			want = BENCH_READ_SIZE;
+
+		size = want;
+		w = bip_buf_reserve(bb, &size);
+		if (NULL == w || 0 == size) {
+			fprintf(stderr, "input buffer full!!!\n");
+			return -1;
+		}
+
+		if (size > want)
+			size = want;
+
+		memcpy(w, data + pos, size);
+		bip_buf_commit(bb, size);
+		pos += size;
+
+		redis_reply_parse_once(rrp, bb);
+	}
+	return 0;
+}
+
+/* what "redis_reply_read_integer" did before the fused scanner */
+static size_t
+__legacy_read_integer(bip_buf_t *bb, int64_t *out)
+{
+	char *p1, *p2, *ptr;
+	int64_t v64, negative_mul;
+
+	if (bip_buf_get_committed_size(bb) < 2)
+		return 0;
+
+	p1 = bip_buf_get_contiguous_block(bb);
+	p2 = bip_buf_find_str(bb, "\r\n", 2);
+
+	if (NULL == p2)
+		return 0;
+
+	v64 = 0;
+	negative_mul = 1;
+	for (ptr = p1; ptr < p2; ++ptr) {
+		if (*ptr == '-') {
+			negative_mul = -1;
+			continue;
+		}
+
+		v64 = v64 * 10 + ((*ptr) - '0');
+	}
+
+	(*out) = v64 * negative_mul;
+	return p2 - p1 + 2;
+}
+
+static double
+__bench_headers(const struct stream_builder *headers, int fused, int64_t *sum)
+{
+	bip_buf_t *bb;
+	size_t size, n;
+	int64_t v;
+	char *w;
+	clock_t t0;
+
+	bb = bip_buf_create(headers->len);
+	size = headers->len;
+	w = bip_buf_reserve(bb, &size);
+	memcpy(w, headers->data, headers->len);
+	bip_buf_commit(bb, headers->len);
+
+	t0 = clock();
+	for (;;) {
+		n = fused ? redis_reply_read_integer(NULL, bb, &v) : __legacy_read_integer(bb, &v);
+		if (0 == n)
+			break;
+
+		(*sum) += v;
+		bip_buf_decommit(bb, n);
+	}
+
+	bip_buf_destroy(bb);
+	return (double)(clock() - t0) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+static double
+__bench_stream(const struct stream_builder *sb, int *count)
+{
+	redis_reply_parser_t *rrp;
+	clock_t t0;
+	int i;
+
+	rrp = create_reply_parser(on_reply, count);
+
+	t0 = clock();
+	for (i = 0; i < BENCH_ROUND_NUM; ++i) {
+		if (__parse_stream(rrp, sb->data, sb->len) != 0)
+			break;
+	}
+
+	destroy_reply_parser(rrp);
+	return (double)(clock() - t0) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+static int
+__load_file(const char *path, struct stream_builder *sb)
+{
+	char buf[65536];
+	size_t n;
+	FILE *fp = fopen(path, "rb");
+
+	if (NULL == fp)
+		return -1;
+
+	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+		__append(sb, buf, n);
+	}
+	fclose(fp);
+	return 0;
+}
+
+/* usage: bench_reply_parser [recorded_reply_stream_file] */
+int main(int argc, char* argv[]) {
+	struct stream_builder sb, headers;
+	int count, i;
+	int64_t sum_legacy, sum_fused;
+	double ms_parse, ms_legacy, ms_fused;
+
+	memset(&sb, 0, sizeof(sb));
+	memset(&headers, 0, sizeof(headers));
+
+	if (argc > 1) {
+		if (__load_file(argv[1], &sb) != 0) {
+			fprintf(stderr, "open file(%s) failed!!!\n", argv[1]);
+			return EXIT_FAILURE;
+		}
+	}
+	else {
+		__record_stream(&sb);
+	}
+
+	for (i = 0; i < BENCH_HEADER_NUM; ++i) {
+		__appendf(&headers, (i & 1) ? "%lld\r\n" : "-%lld\r\n", (long long)i * 7919);
+	}
+
+	/* whole parser */
+	count = 0;
+	ms_parse = __bench_stream(&sb, &count);
+
+	/* "$<len>", "*<len>" and ":<int>" headers, after the leading byte */
+	sum_legacy = sum_fused = 0;
+	ms_legacy = __bench_headers(&headers, 0, &sum_legacy);
+	ms_fused = __bench_headers(&headers, 1, &sum_fused);
+
+	if (sum_legacy != sum_fused) {
+		fprintf(stderr, "header sum mismatch!!!\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("stream: %llu bytes x %d, replies: %d\n", (unsigned long long)sb.len, BENCH_ROUND_NUM, count);
+	printf("parse: %.1f ms\n", ms_parse);
+	printf("headers: %d\n", BENCH_HEADER_NUM);
+	printf("find_str + loop: %.1f ms\n", ms_legacy);
+	printf("fused:           %.1f ms\n", ms_fused);
+
+	free(sb.data);
+	free(headers.data);
+	return EXIT_SUCCESS;
+}
@@ -185,6 +185,7 @@ typedef struct {
     u_int               failed;
 } nx_pool_data_t;
 
+/* still the allocator of reply_parser/ and rdb_parser/, only the cmd pipelines left it for CRedisCmdPipelineList */
 struct nx_pool_s {
     nx_pool_data_t      d;
     size_t              max;
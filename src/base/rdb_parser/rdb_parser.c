@@ -166,58 +166,90 @@ rdb_parse_dumped_data_once(rdb_parser_t *rp, bip_buf_t *bb)
 
     rc = OB_AGAIN;
 
-    while (rc != OB_ERROR_PREMATURE
-        && rp->state != PARSE_RDB_OVER) {
+    while (rp->state != PARSE_RDB_OVER
+        && (rc == OB_AGAIN || rc == OB_OVER)) {
 
         rc = build_dumped_data(rp, bb);
+
+        /* a DUMP is one object, nothing follows it but the footer */
+        if (rc == OB_OVER)
+            rp->state = PARSE_RDB_OVER;
     }
     return rc;
 }
 
+void
+rdb_parse_dumped_data_begin(rdb_parser_t *rp, func_walk_rdb_object cb, void *payload)
+{
+    reset_rdb_parser(rp);
+    rdb_parse_bind_walk_cb(rp, cb, payload);
+}
+
 int
-rdb_parse_dumped_data(rdb_parser_t *rp, func_walk_rdb_object cb, void *payload, const char *s, size_t len)
+rdb_parse_dumped_data_feed(rdb_parser_t *rp, const char *s, size_t len, size_t remain)
 {
     int rc;
 
     bip_buf_t *bb;
     char *p1;
-    const char *s1;
-    size_t reserved, consume, remain;
-    
-    reset_rdb_parser(rp);
-    rdb_parse_bind_walk_cb(rp, cb, payload);
+    size_t reserved, consume, footer;
 
-    bb = rp->in_bb;
-    bip_buf_reset(bb);
-    
-    /* Write the footer, this is how it looks like:
-    * ----------------+---------------------+---------------+
-    * ... RDB payload | 2 bytes RDB version | 8 bytes CRC64 |
-    * ----------------+---------------------+---------------+
-    * RDB version and CRC are both in little endian.
+#define __max(a,b) (((a) > (b)) ? (a) : (b))
+#define __min(a,b) (((a) < (b)) ? (a) : (b))
+
+    /* Write the footer, this is how it looks like:
+    * ----------------+---------------------+---------------+
+    * ... RDB payload | 2 bytes RDB version | 8 bytes CRC64 |
+    * ----------------+---------------------+---------------+
+    * RDB version and CRC are both in little endian.
     */
-    /* 10 = 2 version + 8 crc */
-    remain = len - 10;
-    s1 = s;
+    /* 10 = 2 version + 8 crc, the part of it inside "s" is skipped */
+    footer = (remain < 10) ? 10 - remain : 0;
+    len -= __min(len, footer);
 
-    while (remain > 0) {
-        p1 = bip_buf_reserve(bb, &reserved);
+    bb = rp->in_bb;
+    rc = OB_ERROR_PREMATURE;
 
-#define __max(a,b) (((a) > (b)) ? (a) : (b))
-#define __min(a,b) (((a) < (b)) ? (a) : (b))
+    while (len > 0) {
+        p1 = bip_buf_reserve(bb, &reserved);
+        if (NULL == p1) {
+            /* full, nothing more can be parsed out of it */
+            rc = OB_ERROR_PREMATURE;
+            break;
+        }
 
-        consume = __min(reserved, remain);
-        remain -= consume;
-        nx_memcpy(p1, s1, consume);
+        consume = __min(reserved, len);
+        len -= consume;
+        nx_memcpy(p1, s, consume);
         bip_buf_commit(bb, consume);
-        s1 += consume;
+        s += consume;
 
         rc = rdb_parse_dumped_data_once(rp, bb);
+        if (rc != OB_OVER
+            && rc != OB_AGAIN
+            && rc != OB_ERROR_PREMATURE) {
+            break;
+        }
     }
 
+    /* the last piece: premature now means truncated */
+    if (0 == remain) {
+        if (PARSE_RDB_OVER == rp->state)
+            return OB_OVER;
+
+        if (rc >= 0)
+            rc = OB_ERROR_PREMATURE;
+    }
     return rc;
 }
 
+int
+rdb_parse_dumped_data(rdb_parser_t *rp, func_walk_rdb_object cb, void *payload, const char *s, size_t len)
+{
+    rdb_parse_dumped_data_begin(rp, cb, payload);
+    return rdb_parse_dumped_data_feed(rp, s, len, 0);
+}
+
 int
 rdb_parse_file(rdb_parser_t *rp, const char *path)
 {
@@ -7,6 +7,9 @@ enum BUILD_ARRAY_TAG {
     BUILD_ARRAY_ELEMENT,
 };
 
+static void __visit_aggregate(redis_reply_parser_t *rrp, redis_reply_t *r, int64_t len);
+static void __visit_element(redis_reply_parser_t *rrp, redis_reply_t *r);
+
 static int __build_array_len(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_buf_t *bb, redis_reply_t *r);
 static int __build_array_element_type(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_buf_t *bb, redis_reply_t *r);
 static int __build_array_element(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_buf_t *bb, redis_reply_t *r);
@@ -20,13 +23,28 @@ __build_array_len(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_buf
     rc = r_build_integer(rrp, rrb, bb, &len);
 
     if (rc == RRB_OVER) {
+        /* map and attribute count pairs */
+        if (r->type == REDIS_REPLY_LEADING_TYPE_MAP
+            || r->type == REDIS_REPLY_LEADING_TYPE_ATTRIBUTE) {
+            len *= 2;
+        }
+
+        if (rrp->elem_cb) {
+            __visit_aggregate(rrp, r, len);
+        }
+
         if (len > 0) {
             
             rrb->store_len = 0; /* string len */
             rrb->len = (uint32_t)len; /* array len */
 
-            /* pre-alloc */
-            r->arrval = nx_array_create(rrp->r_pool, rrb->len, sizeof(redis_reply_t));
+            /* pre-alloc -- streamed elements take turns in one slot, nested aggregates go with their element */
+            if (rrp->streaming) {
+                r->arrval = nx_array_create((r == rrp->r) ? rrp->r_pool : rrp->elem_pool, 1, sizeof(redis_reply_t));
+            }
+            else {
+                r->arrval = nx_array_create(rrp->r_pool, rrb->len, sizeof(redis_reply_t));
+            }
 
             /* next state */
             rrb->state = BUILD_ARRAY_ELEMENT_TYPE;
@@ -53,40 +71,22 @@ __build_array_element_type(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb
 {
     size_t n;
     uint8_t leading, type;
-
-    redis_reply_chain_t **ll;
+    redis_reply_t *r2;
 
     if ((n = redis_reply_read_leading(rrp, bb, &leading)) == 0)
         return RRB_ERROR_PREMATURE;
 
-    type = REDIS_REPLY_LEADING_TYPE_UNKNOWN;
-
-    switch (leading) {
-    case '+': /* simple string */
-        type = REDIS_REPLY_LEADING_TYPE_SIMPLE_STRING;
-        break;
-
-    case '-': /* error string */
-        type = REDIS_REPLY_LEADING_TYPE_ERROR_STRING;
-        break;
-
-    case ':': /* integer */
-        type = REDIS_REPLY_LEADING_TYPE_INTEGER;
-        break;
-
-    case '$': /* bulk string */
-        type = REDIS_REPLY_LEADING_TYPE_BULK_STRING;
-        break;
-
-    case '*': /* array */
-        type = REDIS_REPLY_LEADING_TYPE_ARRAY;
-        break;
-
-    default:
+    if ((type = redis_reply_leading_type(leading)) == REDIS_REPLY_LEADING_TYPE_UNKNOWN)
         return RRB_ERROR_INVALID_LEADING_CHAR;
-    }
 
     r->elemtype = type;
+
+    if (rrp->streaming) {
+        /* the slot of the last element is reused */
+        r2 = (r->arrval->nelts > 0) ? nx_array_at(r->arrval, 0) : nx_array_push(r->arrval);
+        redis_reply_init(r2);
+        r2->type = type;
+    }
 
     bip_buf_decommit(bb, n);
     rrp->parsed += n;
@@ -104,39 +104,30 @@ __build_array_element(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip
     redis_reply_t *r2;
 
     /* alloc child-reply in array */
-    r2 = nx_array_at(r->arrval, rrb->arridx);
-    if (NULL == r2) {
-        r2 = nx_array_push(r->arrval);
-        redis_reply_init(r2);
-        r2->type = r->elemtype;
+    if (rrp->streaming) {
+        r2 = nx_array_at(r->arrval, 0);
+    }
+    else {
+        r2 = nx_array_at(r->arrval, rrb->arridx);
+        if (NULL == r2) {
+            r2 = nx_array_push(r->arrval);
+            redis_reply_init(r2);
+            r2->type = r->elemtype;
+        }
     }
 
-    switch (r2->type) {
-    case REDIS_REPLY_LEADING_TYPE_SIMPLE_STRING:
-        rc = r_build_simple_string(rrp, rrb, bb, r2);
-        break;
+    rc = r_build_typed(rrp, rrb, bb, r2);
 
-    case REDIS_REPLY_LEADING_TYPE_ERROR_STRING:
-        rc = r_build_simple_string(rrp, rrb, bb, r2);
-        break;
-
-    case REDIS_REPLY_LEADING_TYPE_INTEGER:
-        rc = r_build_integer(rrp, rrb, bb, &r2->intval);
-        break;
-
-    case REDIS_REPLY_LEADING_TYPE_BULK_STRING:
-        rc = r_build_bulk_string(rrp, rrb, bb, r2);
-        break;
-
-    case REDIS_REPLY_LEADING_TYPE_ARRAY:
-        rc = r_build_array(rrp, rrb, bb, r2);
-        break;
+    if (rc == RRB_OVER) {
+        if (rrp->streaming) {
+            __visit_element(rrp, r2);
+        }
 
-    default:
-        return RRB_ERROR_INVALID_LEADING_CHAR;
-    }
+        /* attribute of the next element is not counted by the aggregate */
+        if (r2->type == REDIS_REPLY_LEADING_TYPE_ATTRIBUTE) {
+            ++rrb->len;
+        }
 
-    if (rc == RRB_OVER) {
         /* next array element */
         ++rrb->arridx;
 
@@ -150,6 +141,65 @@ __build_array_element(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip
     return rc;
 }
 
+static void
+__visit_aggregate(redis_reply_parser_t *rrp, redis_reply_t *r, int64_t len)
+{
+    /* element num */
+    r->intval = (len > 0) ? len : 0;
+    r->is_null = (len < 0);
+
+    if (r == rrp->r) {
+        /* the reply itself, the visitor decides */
+        if (0 == rrp->elem_cb(r, 0, rrp->elem_payload)) {
+            return;
+        }
+
+        rrp->streaming = 1;
+        rrp->str_pool = rrp->elem_pool;
+    }
+    else if (!rrp->streaming) {
+        return;
+    }
+    else {
+        /* attribute and what is inside are not visited */
+        if (r->type == REDIS_REPLY_LEADING_TYPE_ATTRIBUTE
+            && 0 == rrp->skip_depth) {
+            rrp->skip_depth = rrp->elem_depth + 1;
+        }
+
+        if (0 == rrp->skip_depth) {
+            rrp->elem_cb(r, rrp->elem_depth, rrp->elem_payload);
+        }
+    }
+
+    if (len > 0) {
+        ++rrp->elem_depth;
+    }
+}
+
+static void
+__visit_element(redis_reply_parser_t *rrp, redis_reply_t *r)
+{
+    if (redis_reply_type_is_aggregate(r->type)) {
+        /* over, it is visited ahead of its elements */
+        if (r->intval > 0) {
+            --rrp->elem_depth;
+        }
+
+        if (rrp->skip_depth > rrp->elem_depth) {
+            rrp->skip_depth = 0;
+        }
+    }
+    else if (0 == rrp->skip_depth) {
+        rrp->elem_cb(r, rrp->elem_depth, rrp->elem_payload);
+    }
+
+    /* an element of the reply itself is done, nothing in "elem_pool" is referred any more */
+    if (1 == rrp->elem_depth) {
+        nx_reset_pool(rrp->elem_pool);
+    }
+}
+
 int
 r_build_array(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_buf_t *bb, redis_reply_t *r)
 {
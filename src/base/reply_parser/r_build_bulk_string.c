@@ -14,10 +14,12 @@ enum BUILD_BULK_STRING_TAG {
     BUILD_BULK_STRING_IDLE = 0,
     BUILD_BULK_STRING_STORE_LEN,
     BUILD_BULK_STRING_PLAIN,
+    BUILD_BULK_STRING_SINK,
 };
 
 static int __build_bulk_string_store_len(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_buf_t *bb, redis_reply_t *r);
 static int __build_bulk_string_plain(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_buf_t *bb, redis_reply_t *r);
+static int __build_bulk_string_sink(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_buf_t *bb, redis_reply_t *r);
 
 static int
 __build_bulk_string_store_len(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_buf_t *bb, redis_reply_t *r)
@@ -34,10 +36,26 @@ __build_bulk_string_store_len(redis_reply_parser_t *rrp, redis_reply_builder_t *
             /* "len==0" means empty, format: "$0\r\n\r\n" */
             rrb->store_len = (uint32_t)len; /* string len */
             rrb->len = 1; /* array len */
+
+            /* top level bulk string, the sink may take it piece by piece */
+            if (rrp->bulk_sink != NULL
+                && r == rrp->r
+                && r->type == REDIS_REPLY_LEADING_TYPE_BULK_STRING
+                && rrp->bulk_sink(r, NULL, 0, rrb->store_len, rrp->bulk_sink_payload)) {
+
+                rrp->sinking = 1;
+                rrb->len = 0; /* bytes consumed, tail "\r\n" included */
+                r->vall = NULL;
+                r->vall_tail = NULL;
+
+                /* next state */
+                rrb->state = BUILD_BULK_STRING_SINK;
+                return RRB_AGAIN;
+            }
 
             /* pre-alloc */
-            r->vall_tail = alloc_simple_string_buf_chain_link(rrp->r_pool, &r->vall);
-            r->vall_tail->buf = nx_create_temp_buf(rrp->r_pool, rrb->store_len + 3); /* 3 means with tail "\r\n" and "\0" */
+            r->vall_tail = alloc_simple_string_buf_chain_link(rrp->str_pool, &r->vall);
+            r->vall_tail->buf = alloc_bulk_string_buf(rrp, rrb->store_len + 3); /* 3 means with tail "\r\n" and "\0" */
 
             /* next state */
             rrb->state = BUILD_BULK_STRING_PLAIN;
@@ -106,6 +124,49 @@ __build_bulk_string_plain(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb,
     return RRB_ERROR_PREMATURE;
 }
 
+static int
+__build_bulk_string_sink(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_buf_t *bb, redis_reply_t *r)
+{
+    size_t buf_size, want_size, consume_size, data_size, i;
+    char *p1;
+
+    buf_size = bip_buf_get_committed_size(bb);
+    p1 = bip_buf_get_contiguous_block(bb);
+
+    want_size = rrb->store_len + 2 - rrb->len;
+    consume_size = __min(buf_size, want_size);
+    data_size = 0;
+
+    if (consume_size == 0) {
+        return RRB_ERROR_PREMATURE;
+    }
+
+    /* string bytes go to the sink in place, nothing is copied */
+    if (rrb->len < rrb->store_len) {
+        data_size = __min(consume_size, rrb->store_len - rrb->len);
+        rrp->bulk_sink(r, p1, data_size, rrb->store_len - rrb->len - data_size, rrp->bulk_sink_payload);
+    }
+
+    /* validate end sequence, it may come in pieces too */
+    for (i = data_size; i < consume_size; ++i) {
+        if (p1[i] != "\r\n"[rrb->len + i - rrb->store_len]) {
+            return RRB_ERROR_INVALID_BULK_STRING;
+        }
+    }
+
+    /* part consume */
+    bip_buf_decommit(bb, consume_size);
+    rrp->parsed += consume_size;
+    rrb->len += (uint32_t)consume_size;
+
+    if (consume_size == want_size) {
+        r->bytes = rrb->store_len;
+        return RRB_OVER;
+    }
+
+    return RRB_ERROR_PREMATURE;
+}
+
 int
 r_build_bulk_string(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_buf_t *bb, redis_reply_t *r)
 {
@@ -127,6 +188,10 @@ r_build_bulk_string(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_b
             rc = __build_bulk_string_plain(rrp, sub_rrb, bb, r);
             break;
 
+        case BUILD_BULK_STRING_SINK:
+            rc = __build_bulk_string_sink(rrp, sub_rrb, bb, r);
+            break;
+
         default:
             rc = RRB_ERROR_INVALID_RRB_STATE;
             break;
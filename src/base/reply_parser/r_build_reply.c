@@ -32,32 +32,8 @@ __build_reply_type(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_bu
     if ((n = redis_reply_read_leading(rrp, bb, &leading)) == 0)
         return RRB_ERROR_PREMATURE;
 
-    type = REDIS_REPLY_LEADING_TYPE_UNKNOWN;
-
-    switch (leading) {
-    case '+': /* simple string */
-        type = REDIS_REPLY_LEADING_TYPE_SIMPLE_STRING;
-        break;
-
-    case '-': /* error string */
-        type = REDIS_REPLY_LEADING_TYPE_ERROR_STRING;
-        break;
-
-    case ':': /* integer */
-        type = REDIS_REPLY_LEADING_TYPE_INTEGER;
-        break;
-
-    case '$': /* bulk string */
-        type = REDIS_REPLY_LEADING_TYPE_BULK_STRING;
-        break;
-
-    case '*': /* array */
-        type = REDIS_REPLY_LEADING_TYPE_ARRAY;
-        break;
-
-    default:
+    if ((type = redis_reply_leading_type(leading)) == REDIS_REPLY_LEADING_TYPE_UNKNOWN)
         return RRB_ERROR_INVALID_LEADING_CHAR;
-    }
 
     /* reply type */
     r = rrp->r;
@@ -74,24 +50,42 @@ __build_reply_type(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_bu
 static int
 __build_reply_content(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_buf_t *bb)
 {
-    redis_reply_t *r;
+    return r_build_typed(rrp, rrb, bb, rrp->r);
+}
 
-    r = rrp->r;
+int
+r_build_typed(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_buf_t *bb, redis_reply_t *r)
+{
+    int rc;
 
     switch (r->type) {
     case REDIS_REPLY_LEADING_TYPE_SIMPLE_STRING:
-        return r_build_simple_string(rrp, rrb, bb, r);
-
     case REDIS_REPLY_LEADING_TYPE_ERROR_STRING:
+    case REDIS_REPLY_LEADING_TYPE_DOUBLE:
+    case REDIS_REPLY_LEADING_TYPE_BOOLEAN:
+    case REDIS_REPLY_LEADING_TYPE_BIG_NUMBER:
+        /* one line, the text is converted by the reply consumer */
         return r_build_simple_string(rrp, rrb, bb, r);
 
+    case REDIS_REPLY_LEADING_TYPE_NULL:
+        if ((rc = r_build_simple_string(rrp, rrb, bb, r)) == RRB_OVER) {
+            r->is_null = 1;
+        }
+        return rc;
+
     case REDIS_REPLY_LEADING_TYPE_INTEGER:
         return r_build_integer(rrp, rrb, bb, &r->intval);
 
     case REDIS_REPLY_LEADING_TYPE_BULK_STRING:
+    case REDIS_REPLY_LEADING_TYPE_BLOB_ERROR:
+    case REDIS_REPLY_LEADING_TYPE_VERBATIM_STRING:
         return r_build_bulk_string(rrp, rrb, bb, r);
 
     case REDIS_REPLY_LEADING_TYPE_ARRAY:
+    case REDIS_REPLY_LEADING_TYPE_MAP:
+    case REDIS_REPLY_LEADING_TYPE_SET:
+    case REDIS_REPLY_LEADING_TYPE_ATTRIBUTE:
+    case REDIS_REPLY_LEADING_TYPE_PUSH:
         return r_build_array(rrp, rrb, bb, r);
 
     default:
@@ -4,4 +4,7 @@
 
 int  r_build_reply(redis_reply_parser_t *rrp, bip_buf_t *bb);
 
+/* build the content of "r" by its type, shared by top level and aggregate elements */
+int  r_build_typed(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb, bip_buf_t *bb, redis_reply_t *r);
+
 /* EOF */
\ No newline at end of file
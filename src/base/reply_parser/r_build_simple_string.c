@@ -1,4 +1,5 @@
 #include "r_build_factory.h"
+#include "reply_scan.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -23,8 +24,8 @@ __build_simple_string_init(redis_reply_parser_t *rrp, redis_reply_builder_t *rrb
 {
     (void *)bb;
 
-    r->vall_tail = alloc_simple_string_buf_chain_link(rrp->r_pool, &r->vall);
-    r->vall_tail->buf = nx_create_temp_buf(rrp->r_pool, SIMPLE_STRING_TEMP_BUFF_SIZE);
+    r->vall_tail = alloc_simple_string_buf_chain_link(rrp->str_pool, &r->vall);
+    r->vall_tail->buf = nx_create_temp_buf(rrp->str_pool, SIMPLE_STRING_TEMP_BUFF_SIZE);
 
     rrb->store_len = 0; /* string len */
     rrb->len = 1; /* array len */
@@ -50,7 +51,7 @@ __build_simple_string_plain(redis_reply_parser_t *rrp, redis_reply_builder_t *rr
         return RRB_ERROR_PREMATURE;
 
     p1 = bip_buf_get_contiguous_block(bb);
-    p2 = bip_buf_find_str(bb, "\r\n", 2);
+    p2 = (char *)redis_reply_scan_crlf(p1, buf_size);
     remain_size = consume_size = 0;
 
     reply_ok = 0;
@@ -77,16 +78,17 @@ __build_simple_string_plain(redis_reply_parser_t *rrp, redis_reply_builder_t *rr
         freespace = b->end - b->last;
         append_size = __min(freespace, remain_size);
         if (0 == append_size) {
-            r->vall_tail = alloc_simple_string_buf_chain_link(rrp->r_pool, &r->vall_tail);
-            r->vall_tail->buf = nx_create_temp_buf(rrp->r_pool, SIMPLE_STRING_TEMP_BUFF_SIZE);
+            r->vall_tail = alloc_simple_string_buf_chain_link(rrp->str_pool, &r->vall_tail);
+            r->vall_tail->buf = nx_create_temp_buf(rrp->str_pool, SIMPLE_STRING_TEMP_BUFF_SIZE);
 
             ++rrb->len;
             continue;
         }
 
         /* append */
-        s = b->pos;
+        s = b->last;
         nx_memcpy(s, p1, append_size);
+        p1 += append_size;
         rrb->store_len += append_size;
 
         /* remain */
@@ -1,4 +1,5 @@
 #include "reply_build_helper.h"
+#include "reply_scan.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -29,6 +30,36 @@ alloc_simple_string_buf_chain_link(nx_pool_t *pool, nx_chain_t **ll)
     }
     return cl;
 }
+
+nx_buf_t *
+alloc_bulk_string_buf(redis_reply_parser_t *rrp, size_t size)
+{
+    nx_buf_t *b;
+    u_char *p;
+
+    /* a streamed element is dropped after its visit, so is its string */
+    if (rrp->bulk_alloc == NULL
+        || rrp->streaming) {
+        return nx_create_temp_buf(rrp->str_pool, size);
+    }
+
+    /* bytes go to the external storage directly, which outlives "r_pool" */
+    p = rrp->bulk_alloc(size, rrp->bulk_payload);
+    if (p == NULL) {
+        return NULL;
+    }
+
+    b = nx_calloc_buf(rrp->r_pool);
+    if (b == NULL) {
+        return NULL;
+    }
+
+    b->start = p;
+    b->pos = p;
+    b->last = p;
+    b->end = p + size;
+    return b;
+}
 
 void
 redis_reply_as_string(redis_reply_t *r, char *buf, size_t *len)
@@ -48,6 +79,61 @@ redis_reply_as_string(redis_reply_t *r, char *buf, size_t *len)
     (*len) = s - buf;
 }
 
+uint8_t
+redis_reply_leading_type(uint8_t leading)
+{
+    switch (leading) {
+    case '+': /* simple string */
+        return REDIS_REPLY_LEADING_TYPE_SIMPLE_STRING;
+
+    case '-': /* error string */
+        return REDIS_REPLY_LEADING_TYPE_ERROR_STRING;
+
+    case ':': /* integer */
+        return REDIS_REPLY_LEADING_TYPE_INTEGER;
+
+    case '$': /* bulk string */
+        return REDIS_REPLY_LEADING_TYPE_BULK_STRING;
+
+    case '*': /* array */
+        return REDIS_REPLY_LEADING_TYPE_ARRAY;
+
+    case '_': /* null, format: "_\r\n" */
+        return REDIS_REPLY_LEADING_TYPE_NULL;
+
+    case ',': /* double, format: ",1.23\r\n" */
+        return REDIS_REPLY_LEADING_TYPE_DOUBLE;
+
+    case '#': /* boolean, format: "#t\r\n" */
+        return REDIS_REPLY_LEADING_TYPE_BOOLEAN;
+
+    case '(': /* big number */
+        return REDIS_REPLY_LEADING_TYPE_BIG_NUMBER;
+
+    case '!': /* blob error, framed as bulk string */
+        return REDIS_REPLY_LEADING_TYPE_BLOB_ERROR;
+
+    case '=': /* verbatim string, framed as bulk string, format: "=15\r\ntxt:Some string\r\n" */
+        return REDIS_REPLY_LEADING_TYPE_VERBATIM_STRING;
+
+    case '%': /* map */
+        return REDIS_REPLY_LEADING_TYPE_MAP;
+
+    case '~': /* set */
+        return REDIS_REPLY_LEADING_TYPE_SET;
+
+    case '|': /* attribute */
+        return REDIS_REPLY_LEADING_TYPE_ATTRIBUTE;
+
+    case '>': /* push */
+        return REDIS_REPLY_LEADING_TYPE_PUSH;
+
+    default:
+        break;
+    }
+    return REDIS_REPLY_LEADING_TYPE_UNKNOWN;
+}
+
 size_t
 redis_reply_read_leading(redis_reply_parser_t *rrp, bip_buf_t *bb, uint8_t *out)
 {
@@ -67,35 +153,14 @@ size_t
 redis_reply_read_integer(redis_reply_parser_t *rrp, bip_buf_t *bb, int64_t *out)
 {
     size_t bytes = 2;
-    char *p1, *p2, *ptr;
-    size_t append_size, consume_size;
-    int64_t v64, negative_mul;
-    
+    size_t buf_size;
+    char *p1;
+
     /* at least include "\r\n" */
-    if (bip_buf_get_committed_size(bb) < bytes)
+    buf_size = bip_buf_get_committed_size(bb);
+    if (buf_size < bytes)
         return 0;
 
     p1 = bip_buf_get_contiguous_block(bb);
-    p2 = bip_buf_find_str(bb, "\r\n", 2);
-
-    if (NULL == p2)
-        return 0;
-
-    append_size = p2 - p1;
-    consume_size = append_size + 2;
-
-    /* to integer */
-    v64 = 0;
-    negative_mul = 1;
-    for (ptr = p1; ptr < p2; ++ptr) {
-        if (*ptr == '-') {
-            negative_mul = -1;
-            continue;
-        }
-
-        v64 = v64 * 10 + ((*ptr) - '0');
-    }
-
-    (*out) = v64 * negative_mul;
-    return consume_size;
+    return redis_reply_scan_integer(p1, buf_size, out);
 }
\ No newline at end of file
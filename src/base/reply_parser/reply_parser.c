@@ -21,6 +21,16 @@ enum PARSE_REDIS_REPLY_TAG {
     PARSE_REDIS_REPLY_OVER,
 };
 
+static void
+__end_streaming(redis_reply_parser_t *rrp)
+{
+    rrp->streaming = 0;
+    rrp->elem_depth = 0;
+    rrp->skip_depth = 0;
+    rrp->str_pool = rrp->r_pool;
+    nx_reset_pool(rrp->elem_pool);
+}
+
 redis_reply_parser_t *
 create_reply_parser(func_process_redis_reply cb, void *payload)
 {
@@ -43,6 +53,9 @@ create_reply_parser(func_process_redis_reply cb, void *payload)
     rrp->r_cb = cb;
     rrp->r_payload = payload;
 
+    rrp->elem_pool = nx_create_pool(REDIS_PARSER_REPLY_POOL_SIZE);
+    rrp->str_pool = rrp->r_pool;
+
     return rrp;
 }
 
@@ -50,6 +63,7 @@ void
 destroy_reply_parser(redis_reply_parser_t *rrp)
 {
     bip_buf_destroy(rrp->in_bb);
+    nx_destroy_pool(rrp->elem_pool);
     nx_destroy_pool(rrp->r_pool);
     nx_destroy_pool(rrp->pool);
     nx_free(rrp);
@@ -83,6 +97,17 @@ reset_reply_parser(redis_reply_parser_t *rrp)
     }
     rrp->pool->d.next = NULL;
 
+    /* reset and shrink element pool */
+    __end_streaming(rrp);
+    rrp->sinking = 0;
+    p = rrp->elem_pool->d.next;
+    while (p) {
+        tmp = p->d.next;
+        nx_free(p);
+        p = tmp;
+    }
+    rrp->elem_pool->d.next = NULL;
+
     bip_buf_reset(rrp->in_bb);
 
     rrp->stack_rrb = nx_array_create(rrp->pool, 16, sizeof(redis_reply_builder_t));
@@ -91,10 +116,31 @@ reset_reply_parser(redis_reply_parser_t *rrp)
     redis_reply_init(rrp->r);
 }
 
+void
+set_reply_parser_bulk_alloc(redis_reply_parser_t *rrp, func_alloc_bulk_string alloc, void *payload)
+{
+    rrp->bulk_alloc = alloc;
+    rrp->bulk_payload = payload;
+}
+
+void
+set_reply_parser_element_visitor(redis_reply_parser_t *rrp, func_visit_redis_element cb, void *payload)
+{
+    rrp->elem_cb = cb;
+    rrp->elem_payload = payload;
+}
+
+void
+set_reply_parser_bulk_sink(redis_reply_parser_t *rrp, func_sink_bulk_string sink, void *payload)
+{
+    rrp->bulk_sink = sink;
+    rrp->bulk_sink_payload = payload;
+}
+
 int
 redis_reply_parse_once(redis_reply_parser_t *rrp, bip_buf_t *bb)
 {
-    int rc;
+    int rc, cb_rc;
 
     rc = RRB_AGAIN;
 
@@ -106,7 +152,14 @@ redis_reply_parse_once(redis_reply_parser_t *rrp, bip_buf_t *bb)
         case PARSE_REDIS_REPLY_RUNNING:
             if ((rc = r_build_reply(rrp, bb)) == RRB_OVER) {
                 /* process reply */
-                if (0 == rrp->r_cb(rrp->r, rrp->r_payload)) {
+                cb_rc = rrp->r_cb(rrp->r, rrp->r_payload);
+
+                if (rrp->streaming) {
+                    __end_streaming(rrp);
+                }
+                rrp->sinking = 0;
+
+                if (0 == cb_rc) {
                     redis_reply_clear(rrp);
                 }
                 else {
@@ -0,0 +1,77 @@
+#include "reply_scan.h"
+
+#include <string.h>
+
+/* bulk bodies are length-prefixed and never searched, only the short
+   simple-string and header lines get here */
+const char *
+redis_reply_scan_crlf(const char *p, size_t len)
+{
+    const char *s, *end;
+
+    if (len < 2)
+        return NULL;
+
+    /* the '\n' must be in range too */
+    s = p;
+    end = p + len - 1;
+
+    while (s < end) {
+        s = memchr(s, '\r', end - s);
+        if (s == NULL)
+            return NULL;
+
+        if (s[1] == '\n')
+            return s;
+
+        ++s;
+    }
+    return NULL;
+}
+
+size_t
+redis_reply_scan_integer(const char *p, size_t len, int64_t *out)
+{
+    const char *s, *end, *crlf;
+    uint64_t v64;
+    unsigned d;
+    int negative;
+
+    s = p;
+    end = p + len;
+    v64 = 0;
+    negative = 0;
+
+    if (s < end && *s == '-') {
+        negative = 1;
+        ++s;
+    }
+
+    /* headers are short, the digits are consumed while looking for the '\r' */
+    while (s < end) {
+        d = (unsigned)(uint8_t)(*s) - '0';
+        if (d > 9)
+            break;
+
+        v64 = v64 * 10 + d;
+        ++s;
+    }
+
+    if (end - s < 2) {
+        /* wait for the "\r\n" */
+        if (s == end || *s == '\r')
+            return 0;
+    }
+    else if (s[0] == '\r' && s[1] == '\n') {
+        (*out) = negative ? -(int64_t)v64 : (int64_t)v64;
+        return s + 2 - p;
+    }
+
+    /* junk before the "\r\n" is skipped, value is the leading digits */
+    crlf = redis_reply_scan_crlf(s, end - s);
+    if (crlf == NULL)
+        return 0;
+
+    (*out) = negative ? -(int64_t)v64 : (int64_t)v64;
+    return crlf + 2 - p;
+}
@@ -0,0 +1,185 @@
+//------------------------------------------------------------------------------
+//  bench_callback.cpp
+//  (C) 2016 n.lee
+//------------------------------------------------------------------------------
+#include "base/RedisCallback.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_LOOP_NUM     1000000
+#define BENCH_BATCH_NUM    500
+
+static size_t s_alloc_num = 0;
+
+void *
+operator new(size_t sz) {
+	++s_alloc_num;
+	void *p = malloc(sz ? sz : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void
+operator delete(void *p) noexcept {
+	free(p);
+}
+
+void
+operator delete(void *p, size_t) noexcept {
+	free(p);
+}
+
+/* stands in for CRedisReply, the callbacks only move it */
+struct bench_reply_t {
+	std::string _value;
+	int64_t _integer = 0;
+};
+
+/* what a proxy hands to Commit(): the user callback bound with the key */
+using user_cb_t = std::function<void(bool)>;
+
+//------------------------------------------------------------------------------
+/**
+	before: std::function everywhere, one trunk work item bound per reply
+*/
+using reply_cb_t = std::function<void(bench_reply_t&&)>;
+
+static void
+__commit_std(const std::string& sKey, int& nDone, std::vector<reply_cb_t>& vPipeline, std::vector<std::function<void()>>& vTrunk) {
+
+	user_cb_t userCb = [&nDone](bool bOk) { nDone += bOk ? 1 : 0; };
+
+	// local copy as the proxies make it -- a captured const ref is a const member, copied on every move
+	std::string sIdHash = sKey;
+	reply_cb_t rcb = std::bind([sIdHash](user_cb_t& cb, bench_reply_t&& reply) {
+		cb(reply._integer > 0);
+	}, std::move(userCb), std::placeholders::_1);
+
+	// CRedisClient::Commit()
+	std::vector<std::function<void()>> *pTrunk = &vTrunk;
+	reply_cb_t pcb = std::bind([pTrunk](reply_cb_t& cb, bench_reply_t&& reply) {
+		// CRedisClientTrunkQueue::Add()
+		pTrunk->emplace_back(std::bind([](reply_cb_t& on_got_reply, bench_reply_t& r) {
+			on_got_reply(std::move(r));
+		}, std::move(cb), std::move(reply)));
+	}, std::move(rcb), std::placeholders::_1);
+
+	vPipeline.emplace_back(std::move(pcb));
+}
+
+//------------------------------------------------------------------------------
+/**
+	after: CRedisCallback, replies go into a reused batch
+*/
+using new_reply_cb_t = CRedisCallback<void(bench_reply_t&&)>;
+using new_pipeline_cb_t = CRedisCallback<void(bench_reply_t&&), REDIS_CALLBACK_INLINE_SIZE + 64>;
+
+struct batch_item_t {
+	new_reply_cb_t _cb;
+	bench_reply_t _reply;
+};
+
+static void
+__commit_inline(const std::string& sKey, int& nDone, std::vector<new_pipeline_cb_t>& vPipeline, std::vector<batch_item_t>& vBatch) {
+
+	user_cb_t userCb = [&nDone](bool bOk) { nDone += bOk ? 1 : 0; };
+
+	std::string sIdHash = sKey;
+	new_reply_cb_t rcb = std::bind([sIdHash](user_cb_t& cb, bench_reply_t&& reply) {
+		cb(reply._integer > 0);
+	}, std::move(userCb), std::placeholders::_1);
+
+	std::vector<batch_item_t> *pBatch = &vBatch;
+	new_pipeline_cb_t pcb = std::bind([pBatch](new_reply_cb_t& cb, bench_reply_t&& reply) {
+		pBatch->emplace_back();
+		pBatch->back()._cb = std::move(cb);
+		pBatch->back()._reply = std::move(reply);
+	}, std::move(rcb), std::placeholders::_1);
+
+	vPipeline.emplace_back(std::move(pcb));
+}
+
+int main(int argc, char **argv)
+{
+	using clock_type = std::chrono::steady_clock;
+
+	std::string sKey = "user:1000:profile";
+	int nDoneStd = 0, nDoneInline = 0, i, j;
+	size_t szAllocStd, szAllocInline;
+
+	std::vector<reply_cb_t> vPipelineStd;
+	std::vector<std::function<void()>> vTrunk;
+	std::vector<new_pipeline_cb_t> vPipelineInline;
+	std::vector<batch_item_t> vBatch;
+
+	vPipelineStd.reserve(BENCH_BATCH_NUM);
+	vTrunk.reserve(BENCH_BATCH_NUM);
+	vPipelineInline.reserve(BENCH_BATCH_NUM);
+	vBatch.reserve(BENCH_BATCH_NUM);
+
+	/* commit a batch, reply all of it, run the callbacks on "main thread" */
+	size_t szAlloc0 = s_alloc_num;
+	auto t0 = clock_type::now();
+	for (i = 0; i < BENCH_LOOP_NUM / BENCH_BATCH_NUM; ++i) {
+		for (j = 0; j < BENCH_BATCH_NUM; ++j) {
+			__commit_std(sKey, nDoneStd, vPipelineStd, vTrunk);
+		}
+
+		for (auto& cb : vPipelineStd) {
+			bench_reply_t reply;
+			reply._integer = 1;
+			cb(std::move(reply));
+		}
+		vPipelineStd.clear();
+
+		for (auto& work : vTrunk) {
+			work();
+		}
+		vTrunk.clear();
+	}
+	auto t1 = clock_type::now();
+	szAllocStd = s_alloc_num - szAlloc0;
+
+	szAlloc0 = s_alloc_num;
+	for (i = 0; i < BENCH_LOOP_NUM / BENCH_BATCH_NUM; ++i) {
+		for (j = 0; j < BENCH_BATCH_NUM; ++j) {
+			__commit_inline(sKey, nDoneInline, vPipelineInline, vBatch);
+		}
+
+		for (auto& cb : vPipelineInline) {
+			bench_reply_t reply;
+			reply._integer = 1;
+			cb(std::move(reply));
+		}
+		vPipelineInline.clear();
+
+		for (auto& item : vBatch) {
+			item._cb(std::move(item._reply));
+		}
+		vBatch.clear();
+	}
+	auto t2 = clock_type::now();
+	szAllocInline = s_alloc_num - szAlloc0;
+
+	if (nDoneStd != BENCH_LOOP_NUM
+		|| nDoneInline != BENCH_LOOP_NUM) {
+		fprintf(stderr, "callback count mismatch: %d, %d\n", nDoneStd, nDoneInline);
+		return EXIT_FAILURE;
+	}
+
+	long long llStd = (long long)std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+	long long llInline = (long long)std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+
+	printf("commands: %d, inline size: %d\n", BENCH_LOOP_NUM, REDIS_CALLBACK_INLINE_SIZE);
+	printf("std::function:  %.2f allocs/command, %lld us\n", (double)szAllocStd / BENCH_LOOP_NUM, llStd);
+	printf("CRedisCallback: %.2f allocs/command, %lld us\n", (double)szAllocInline / BENCH_LOOP_NUM, llInline);
+	return EXIT_SUCCESS;
+}
+
+/** -- EOF -- **/
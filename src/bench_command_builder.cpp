@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------------
+//  bench_command_builder.cpp
+//  (C) 2016 n.lee
+//------------------------------------------------------------------------------
+#include "RedisCommandBuilder.h"
+
+#include <chrono>
+#include <stdlib.h>
+
+#define BENCH_LOOP_NUM     1000000
+#define BENCH_PIPELINE_NUM 64
+
+static int
+__check_same_output()
+{
+	std::string sKey = "user:1000:profile";
+	std::string sVal(300, 'v');
+	std::vector<std::string> vField = { "name", "level", "gold" };
+
+	std::string sSingle, sOld, sNew;
+	int nOld = 0, nNew = 0;
+
+	CRedisCommandBuilder::Build({ "SET", sKey, sVal }, sSingle, sOld, nOld);
+	CRedisCommandBuilder::Encode(sNew, nNew, "SET", sKey, sVal);
+
+	CRedisCommandBuilder::Build({ "LRANGE", sKey, std::to_string(-100), std::to_string(1234567890) }, sSingle, sOld, nOld);
+	CRedisCommandBuilder::Encode(sNew, nNew, "LRANGE", sKey, -100, 1234567890);
+
+	std::vector<std::string> vPiece = { "HDEL", sKey };
+	vPiece.insert(vPiece.end(), vField.begin(), vField.end());
+	CRedisCommandBuilder::Build(vPiece, sSingle, sOld, nOld);
+	CRedisCommandBuilder::Encode(sNew, nNew, "HDEL", sKey, vField);
+
+	if (sOld != sNew || nOld != nNew) {
+		fprintf(stderr, "output mismatch:\n[%s]\n[%s]\n", sOld.c_str(), sNew.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	using clock_type = std::chrono::steady_clock;
+
+	std::string sKey = "user:1000:profile";
+	std::string sField = "level";
+	std::string sVal(64, 'v');
+
+	std::string sSingle, sAll;
+	int nBuiltNum = 0, i, j;
+	size_t szTotal = 0;
+
+	if (__check_same_output() != 0) {
+		return EXIT_FAILURE;
+	}
+
+	sAll.reserve(1024 * 256);
+
+	/* old: vector<string> + std::to_string + two appends */
+	auto t0 = clock_type::now();
+	for (i = 0; i < BENCH_LOOP_NUM / BENCH_PIPELINE_NUM; ++i) {
+		for (j = 0; j < BENCH_PIPELINE_NUM; ++j) {
+			CRedisCommandBuilder::Build({ "HSET", sKey, sField, sVal }, sSingle, sAll, nBuiltNum);
+			CRedisCommandBuilder::Build({ "LRANGE", sKey, std::to_string(j), std::to_string(j + 100) }, sSingle, sAll, nBuiltNum);
+		}
+		szTotal += sAll.length();
+		sAll.resize(0);
+	}
+	auto t1 = clock_type::now();
+
+	/* new: variadic encoder */
+	for (i = 0; i < BENCH_LOOP_NUM / BENCH_PIPELINE_NUM; ++i) {
+		for (j = 0; j < BENCH_PIPELINE_NUM; ++j) {
+			CRedisCommandBuilder::Encode(sAll, nBuiltNum, "HSET", sKey, sField, sVal);
+			CRedisCommandBuilder::Encode(sAll, nBuiltNum, "LRANGE", sKey, j, j + 100);
+		}
+		szTotal += sAll.length();
+		sAll.resize(0);
+	}
+	auto t2 = clock_type::now();
+
+	long long llOld = (long long)std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+	long long llNew = (long long)std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+
+	printf("commands: %d x 2, bytes: %llu\n", BENCH_LOOP_NUM, (unsigned long long)szTotal);
+	printf("Build():  %lld us\n", llOld);
+	printf("Encode(): %lld us\n", llNew);
+	return EXIT_SUCCESS;
+}
+
+/** -- EOF -- **/
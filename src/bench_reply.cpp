@@ -0,0 +1,173 @@
+//------------------------------------------------------------------------------
+//  bench_reply.cpp
+//  (C) 2016 n.lee
+//------------------------------------------------------------------------------
+#include "base/RedisReply.h"
+#include "base/RedisFlatReply.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_ROUND_NUM        200
+#define BENCH_FIELD_NUM        5000	// HGETALL reply of 10k elements
+
+static size_t s_alloc_num = 0;
+static size_t s_alloc_bytes = 0;
+
+void *
+operator new(size_t sz) {
+	++s_alloc_num;
+	s_alloc_bytes += sz;
+	void *p = malloc(sz ? sz : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void
+operator delete(void *p) noexcept {
+	free(p);
+}
+
+void
+operator delete(void *p, size_t) noexcept {
+	free(p);
+}
+
+//------------------------------------------------------------------------------
+/**
+	before: one CRedisReply per element, as SetArrayReply() built them
+*/
+static CRedisReply
+__build_tree(const std::vector<std::string>& vText) {
+	std::vector<CRedisReply> vReply;
+	vReply.reserve(vText.size());
+
+	for (auto& text : vText) {
+		CRedisReply reply2;
+		reply2.set(std::string(text), CRedisReply::string_type::bulk_string);
+		vReply.emplace_back(std::move(reply2));
+	}
+
+	CRedisReply reply;
+	reply.set(std::move(vReply));
+	return reply;
+}
+
+//------------------------------------------------------------------------------
+/**
+	after: 16-byte nodes, the bytes in the reply slab
+*/
+static CRedisReply
+__build_flat(const std::vector<std::string>& vText) {
+	auto flat = std::make_shared<CRedisFlatReply>(std::make_shared<CRedisReplySlab>());
+	flat->Reserve(vText.size() + 1);
+	flat->AddNodes(1);
+
+	uint32_t uNum = (uint32_t)vText.size();
+	uint32_t uFirst = flat->AddNodes(uNum);
+
+	CRedisFlatReply::node_t& root = flat->NodeAt(0);
+	root._type = (uint8_t)CRedisReply::type::array;
+	root._size = uNum;
+	root._first = uFirst;
+
+	uint32_t i;
+	for (i = 0; i < uNum; ++i) {
+		const std::string& text = vText[i];
+		char *p = flat->Alloc(text.length());
+		memcpy(p, text.data(), text.length());
+
+		CRedisFlatReply::node_t& node = flat->NodeAt(uFirst + i);
+		node._type = (uint8_t)CRedisReply::type::bulk_string;
+		node._size = (uint32_t)text.length();
+		node._data = p;
+	}
+
+	CRedisReply reply;
+	reply.set_flat(flat, 0);
+	return reply;
+}
+
+int main(int argc, char **argv)
+{
+	using clock_type = std::chrono::steady_clock;
+
+	std::vector<std::string> vText;
+	int i, j;
+	char chText[64];
+
+	for (i = 0; i < BENCH_FIELD_NUM; ++i) {
+		snprintf(chText, sizeof(chText), "field:%d", i);
+		vText.emplace_back(chText);
+		snprintf(chText, sizeof(chText), "{\"level\":%d,\"exp\":%d}", i % 100, i * 37);
+		vText.emplace_back(chText);
+	}
+
+	size_t szSumTree = 0, szSumFlat = 0, szSumCompat = 0;
+	size_t szAlloc0, szBytes0;
+	size_t szAllocTree, szBytesTree, szAllocFlat, szBytesFlat;
+
+	/* build and walk every element */
+	szAlloc0 = s_alloc_num;
+	szBytes0 = s_alloc_bytes;
+	auto t0 = clock_type::now();
+	for (j = 0; j < BENCH_ROUND_NUM; ++j) {
+		CRedisReply reply = __build_tree(vText);
+		for (auto& r : reply.as_array()) {
+			szSumTree += r.as_view()._size;
+		}
+	}
+	auto t1 = clock_type::now();
+	szAllocTree = (s_alloc_num - szAlloc0) / BENCH_ROUND_NUM;
+	szBytesTree = (s_alloc_bytes - szBytes0) / BENCH_ROUND_NUM;
+
+	szAlloc0 = s_alloc_num;
+	szBytes0 = s_alloc_bytes;
+	auto t2 = clock_type::now();
+	for (j = 0; j < BENCH_ROUND_NUM; ++j) {
+		CRedisReply reply = __build_flat(vText);
+		CRedisReplyElement element = reply.as_element();
+		size_t k, szNum = element.size();
+		for (k = 0; k < szNum; ++k) {
+			szSumFlat += element[k].as_view()._size;
+		}
+	}
+	auto t3 = clock_type::now();
+	szAllocFlat = (s_alloc_num - szAlloc0) / BENCH_ROUND_NUM;
+	szBytesFlat = (s_alloc_bytes - szBytes0) / BENCH_ROUND_NUM;
+
+	/* flat reply read through as_array(), as the proxies do */
+	auto t4 = clock_type::now();
+	for (j = 0; j < BENCH_ROUND_NUM; ++j) {
+		CRedisReply reply = __build_flat(vText);
+		for (auto& r : reply.as_array()) {
+			szSumCompat += r.as_view()._size;
+		}
+	}
+	auto t5 = clock_type::now();
+
+	if (szSumTree != szSumFlat
+		|| szSumTree != szSumCompat) {
+		fprintf(stderr, "element size mismatch: %zu, %zu, %zu\n", szSumTree, szSumFlat, szSumCompat);
+		return EXIT_FAILURE;
+	}
+
+	auto us = [](clock_type::duration d) {
+		return (long long)std::chrono::duration_cast<std::chrono::microseconds>(d).count() / BENCH_ROUND_NUM;
+	};
+
+	printf("elements: %d, sizeof(CRedisReply): %zu, sizeof(node_t): %zu\n",
+		BENCH_FIELD_NUM * 2, sizeof(CRedisReply), sizeof(CRedisFlatReply::node_t));
+	printf("tree:            %zu allocs, %zu bytes, %lld us/reply\n", szAllocTree, szBytesTree, us(t1 - t0));
+	printf("flat:            %zu allocs, %zu bytes, %lld us/reply\n", szAllocFlat, szBytesFlat, us(t3 - t2));
+	printf("flat + as_array: %lld us/reply\n", us(t5 - t4));
+	return EXIT_SUCCESS;
+}
+
+/** -- EOF -- **/
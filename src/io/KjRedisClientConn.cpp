@@ -7,7 +7,11 @@
 #include "servercore/capnp/kj/windows-sanity.h"
 #include "servercore/capnp/kj/debug.h"
 
+#include "servercore/capnp/kj/vector.h"
+
 #include <time.h>
+#include <stdlib.h>
+#include <atomic>
 
 #include "../RedisRootContextDef.hpp"
 #include "base/RedisError.h"
@@ -63,7 +67,84 @@ write_redis_connection_crash_error(const char *err_txt) {
 	fclose(ferr);
 }
 
-static uint64_t s_redis_client_connid = 91110000;
+static redis_cmd_pipepline_t
+clone_init_pipeline(redis_cmd_pipepline_t& init) {
+	// init pipelines are sent again on every connect, callbacks are move-only so the clone calls back
+	// through the original, which lives as long as the connection
+	redis_cmd_pipepline_t *pInit = &init;
+
+	redis_cmd_pipepline_t cp;
+	cp._sn = init._sn;
+	cp._commands = init._commands;
+	cp._built_num = init._built_num;
+	cp._processed_num = 0;
+	if (init._reply_cb)
+		cp._reply_cb = [pInit](CRedisReply&& reply) { pInit->_reply_cb(std::move(reply)); };
+	if (init._dispose_cb)
+		cp._dispose_cb = [pInit]() { pInit->_dispose_cb(); };
+	cp._state = init._state;
+	return cp;
+}
+
+/* byte offset of command "nCount" in encoded commands, npos when they are fewer */
+static size_t
+skip_commands(const std::string& sCommands, int nCount) {
+	const char *p = sCommands.data();
+	size_t szLen = sCommands.length();
+	size_t pos = 0;
+	long long llArgc, llArgLen;
+
+	for (; nCount > 0; --nCount) {
+		if (pos >= szLen || '*' != p[pos])
+			return std::string::npos;
+
+		llArgc = strtoll(p + pos + 1, nullptr, 10);
+		pos = sCommands.find("\r\n", pos);
+		if (std::string::npos == pos)
+			return std::string::npos;
+		pos += 2;
+
+		for (; llArgc > 0; --llArgc) {
+			if (pos >= szLen || '$' != p[pos])
+				return std::string::npos;
+
+			llArgLen = strtoll(p + pos + 1, nullptr, 10);
+			pos = sCommands.find("\r\n", pos);
+			if (std::string::npos == pos)
+				return std::string::npos;
+			pos += 2 + (size_t)llArgLen + 2;
+		}
+	}
+	return (pos <= szLen) ? pos : std::string::npos;
+}
+
+/* commits of a merged pipeline which got their tail reply are never sent again */
+static void
+cut_replied_segments(redis_cmd_pipepline_t& cp) {
+	int nReplied = cp._segment_base + cp._processed_num;
+	int nBase = cp._segment_base;
+
+	for (int nEnd : cp._vSegmentEnd) {
+		if (nEnd > nReplied)
+			break;
+		nBase = nEnd;
+	}
+
+	if (nBase <= cp._segment_base)
+		return;
+
+	size_t pos = skip_commands(cp._commands, nBase - cp._segment_base);
+	if (std::string::npos == pos) {
+		fprintf(stderr, "[KjRedisClientConn::OnClientConnect()] bad merged pipeline, sent again as it is!!!\n");
+		return;
+	}
+
+	cp._commands.erase(0, pos);
+	cp._built_num -= nBase - cp._segment_base;
+	cp._segment_base = nBase;
+}
+
+static std::atomic<uint64_t> s_redis_client_connid(91110000);
 
 //------------------------------------------------------------------------------
 /**
@@ -73,7 +154,22 @@ KjRedisClientConn::KjRedisClientConn(kj::Own<KjPipeEndpointIoContext> endpointCo
 	: _endpointContext(kj::mv(endpointContext))
 	, _refParam(param)
 	, _tsCommon(redis_get_servercore()->NewTaskSet(*this))
-	, _kjconn(kj::addRef(*_endpointContext), ++s_redis_client_connid) {
+	, _kjconn(kj::addRef(*_endpointContext), ++s_redis_client_connid)
+	, _rand((unsigned)(_kjconn.GetConnId() ^ (uint64_t)time(nullptr))) {
+	// every pipeline leaving "_dqCommon" hands its command buffer back
+	_dqCommon.SetRecycleCb([this](redis_cmd_pipepline_t& cp) {
+		if (cp._element_cb || cp._chunk_cb) --_nStreamingNum;
+		if (_refWorkQueue) _refWorkQueue->Recycle(cp);
+	});
+
+	_builder.SetStreamProvider([this](size_t nth) {
+		return StreamVisitorAt(nth);
+	});
+
+	_builder.SetSinkProvider([this](size_t nth) {
+		return BulkSinkAt(nth);
+	});
+
 	//
 	Init();
 }
@@ -102,23 +198,58 @@ KjRedisClientConn::OnClientConnect(KjRedisTcpConn&, uint64_t connid) {
 	// schedule
 	redis_get_servercore()->ScheduleTask(*_tsCommon.get(), kj::mv(p1));
 
+	// back to normal
+	if (_bFastFail) {
+		fprintf(stderr, "[KjRedisClientConn::OnClientConnect()] connid(%08llu)host(%s)port(%d), leave fast-fail after (%d) reconnect(s).\n",
+			_kjconn.GetConnId(), _kjconn.GetHost().cStr(), _kjconn.GetPort(), _nReconnectAttempts);
+		_bFastFail = false;
+	}
+	_nReconnectAttempts = 0;
+
+	// tracking is gone with the old connection, and so are the invalidations of what it read
+	if (_refParam._refNearCache) {
+		_nTrackingRedirectId = 0;
+		_refParam._refNearCache->InvalidateAll();
+	}
+
+	// nothing is in flight on a new connection
+	AddInflight(-_nInflightBytes);
+	_bInflightHeld = false;
+
 	// connection init
 	{
-		std::deque<redis_cmd_pipepline_t> dqTmp;
-		dqTmp.insert(dqTmp.end(), _dqInit.begin(), _dqInit.end());
-
-		for (auto& cp : _dqCommon) {
-			if (cp._sn > 0
-				&& cp._state < redis_cmd_pipepline_t::PROCESS_OVER) {
-				// it is common cmd pipeline and not process over yest
-				dqTmp.emplace_back(std::move(cp));
+		// keep common cmd pipelines which are not process over yet, in place
+		auto it = _dqCommon.begin();
+		while (it != _dqCommon.end()) {
+			if ((*it)._sn > 0
+				&& (*it)._state < redis_cmd_pipepline_t::PROCESS_OVER) {
+				++it;
+				continue;
 			}
+
+			// internal ones (sn 0) lost on the old connection never get a reply, tell their owner
+			if ((*it)._state < redis_cmd_pipepline_t::PROCESS_OVER
+				&& (*it)._dispose_cb)
+				(*it)._dispose_cb();
+
+			it = _dqCommon.erase(it);
+		}
+
+		// init ahead of them
+		it = _dqCommon.begin();
+		for (auto& init : _dqInit) {
+			it = _dqCommon.emplace(it, clone_init_pipeline(init));
+			++it;
 		}
-		_dqCommon.swap(dqTmp);
 
 		for (auto& cp : _dqCommon) {
-			// resending
+			if (cp._processed_num > 0
+				&& !cp._vSegmentEnd.empty())
+				cut_replied_segments(cp);
+
+			// resending, every reply comes again
 			cp._state = redis_cmd_pipepline_t::SENDING;
+			cp._processed_num = 0;
 		}
 
 		// recommit
@@ -152,7 +283,16 @@ KjRedisClientConn::OnClientReceive(KjRedisTcpConn&, bip_buf_t& bb) {
 	while (_builder.IsReplyAvailable()) {
 
 		CRedisReply reply = _builder.PopReply();
-		if (reply.is_error()) {
+
+		// out of band, no pipeline waits for it
+		if (reply.is_push()) {
+			OnPush(reply);
+			continue;
+		}
+
+		// cluster redirect goes to the pipeline, the cluster pool sends it again
+		if (reply.is_error()
+			&& !(_refParam._bCluster && IsClusterRedirect(reply))) {
 
 			std::string sDesc = "[KjRedisClientConn::OnClientReceive()] !!! reply error !!! ";
 			sDesc += reply.as_string();
@@ -191,10 +331,93 @@ KjRedisClientConn::OnClientReceive(KjRedisTcpConn&, bip_buf_t& bb) {
 
 			cp._state = redis_cmd_pipepline_t::PROCESS_OVER;
 
+			if (cp._sn > 0 && _pipelineOverCb) _pipelineOverCb(*this, cp);
+
+			AddInflight(-(int64_t)cp._commands.length());
+
 			//
 			_dqCommon.pop_front();
 			--_committing_num;
 		}
+		else if (cp._segment_cb
+			&& !(cp._deadline && cp._deadline->_fired)) {
+			// merged commit, it may be the tail reply of one of them
+			cp._segment_cb(cp._segment_base + cp._processed_num, std::move(reply));
+		}
+	}
+
+	// replies made room for the pipelines held back
+	if (_bInflightHeld) {
+		_bInflightHeld = false;
+		Commit();
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+KjRedisClientConn&
+KjRedisClientConn::Send(redis_cmd_pipepline_t& cp) {
+
+	if (_bFastFail
+		&& cp._sn > 0) {
+		FailPipeline(cp, "CONNDOWN fast-fail, redis connection is down");
+		if (_refWorkQueue) _refWorkQueue->Recycle(cp);
+		return *this;
+	}
+
+	cp._state = redis_cmd_pipepline_t::SENDING;
+	if (cp._element_cb || cp._chunk_cb) ++_nStreamingNum;
+	_dqCommon.emplace_back(std::move(cp));
+
+	if (!IsConnected()
+		&& _refParam._nReplayLimit > 0)
+		TrimReplay();
+
+	return *this;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+KjRedisClientConn::IsClusterRedirect(CRedisReply& reply) {
+	// EXEC of a transaction with a redirected command in it is aborted, the whole of it is sent again
+	const std::string& sError = reply.as_string();
+	return 0 == sError.compare(0, 6, "MOVED ")
+		|| 0 == sError.compare(0, 4, "ASK ")
+		|| 0 == sError.compare(0, 9, "EXECABORT");
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClientConn::OnPush(CRedisReply& reply) {
+
+	std::vector<CRedisReply>& v = reply.as_array();
+	if (v.size() < 2
+		|| !v[0].is_string()
+		|| v[0].as_string() != "invalidate")
+		return;
+
+	CRedisNearCache *nearCache = _refParam._refNearCache;
+	if (!nearCache)
+		return;
+
+	// ["invalidate", [key, ...]], null means flushing all
+	if (v[1].is_null()) {
+		nearCache->InvalidateAll();
+		return;
+	}
+
+	for (auto& key : v[1].as_array()) {
+		if (key.is_string()) {
+			nearCache->Invalidate(key.as_string());
+		}
 	}
 }
 
@@ -278,12 +501,34 @@ KjRedisClientConn::Init() {
 	std::string sCommands;
 	int nBuiltNum = 0;
 
+	// reply mode
+	_builder.SetViewMode(_refParam._bReplyView);
+
 	// auth
 	const std::string& sPassword = _refParam._sPassword;
 	if (sPassword.length() > 0) {
 
 		std::string sSingleCommand;
 		CRedisCommandBuilder::Build({ "AUTH", sPassword }, sSingleCommand, sCommands, nBuiltNum);
+
+		//
+		auto cp = CKjRedisClientWorkQueue::CreateCmdPipeline(
+			0,
+			sCommands,
+			nBuiltNum,
+			nullptr,
+			nullptr);
+
+		//
+		_dqInit.emplace_back(std::move(cp));
+		sCommands.resize(0);
+		nBuiltNum = 0;
+	}
+
+	// protocol
+	if (_refParam._nProtocol >= 3) {
+
+		CRedisCommandBuilder::Encode(sCommands, nBuiltNum, "HELLO", 3);
 
 		//
 		auto cp = CKjRedisClientWorkQueue::CreateCmdPipeline(
@@ -299,11 +544,7 @@ KjRedisClientConn::Init() {
 		nBuiltNum = 0;
 	}
 
-	// test cmsgpack
-	std::string sTestcmsgpack("577017df0566f25df93daa49115c0290597c3c36");
-	_refParam._mapScript[sTestcmsgpack] = "local t={1,'abc2',3};local p=cmsgpack.pack(t);local u=cmsgpack.unpack(p);return {t,p,u}";
-
-	// register script
+	// register script -- "_mapScript" is shared by all pooled connections, read only here
 	for (auto& iter : _refParam._mapScript) {
 
 		const std::string& sSha = iter.first;
@@ -355,17 +596,27 @@ KjRedisClientConn::Init() {
 */
 void
 KjRedisClientConn::DelayReconnect() {
-	//
-	const int nDelaySeconds = 3;
 
 	if (!_bDelayReconnecting) {
 		_bDelayReconnecting = true;
 
-		fprintf(stderr, "[KjRedisClientConn::DelayReconnect()] connid(%08llu)host(%s)port(%d), reconnect after (%d) seconds...\n",
-			_kjconn.GetConnId(), _kjconn.GetHost().cStr(), _kjconn.GetPort(), nDelaySeconds);
+		++_nReconnectAttempts;
+		if (!_bFastFail
+			&& _refParam._nFastFailAttempts > 0
+			&& _nReconnectAttempts >= _refParam._nFastFailAttempts) {
+			EnterFastFail();
+		}
+		else if (_refParam._nReplayLimit > 0) {
+			TrimReplay();
+		}
+
+		int nDelayMs = NextReconnectDelayMs();
+
+		fprintf(stderr, "[KjRedisClientConn::DelayReconnect()] connid(%08llu)host(%s)port(%d), reconnect(%d) after (%d) ms...\n",
+			_kjconn.GetConnId(), _kjconn.GetHost().cStr(), _kjconn.GetPort(), _nReconnectAttempts, nDelayMs);
 
 		// "redis client delay reconnect"
-		auto p1 = _endpointContext->AfterDelay(nDelaySeconds * kj::SECONDS)
+		auto p1 = _endpointContext->AfterDelay(nDelayMs * kj::MILLISECONDS)
 			.then([this]() {
 
 			_bDelayReconnecting = false;
@@ -380,33 +631,344 @@ KjRedisClientConn::DelayReconnect() {
 //------------------------------------------------------------------------------
 /**
 
+*/
+int
+KjRedisClientConn::NextReconnectDelayMs() {
+
+	int nMinMs = (_refParam._nReconnectMinMs > 0) ? _refParam._nReconnectMinMs : 1;
+	int nMaxMs = (_refParam._nReconnectMaxMs > nMinMs) ? _refParam._nReconnectMaxMs : nMinMs;
+	int nDelayMs = nMinMs;
+	int i;
+
+	for (i = 1; i < _nReconnectAttempts && nDelayMs < nMaxMs; ++i) {
+		nDelayMs = (nDelayMs > nMaxMs / 2) ? nMaxMs : nDelayMs * 2;
+	}
+
+	// jitter into [1/2, 1]
+	return nDelayMs / 2 + (int)(_rand() % (unsigned)(nDelayMs - nDelayMs / 2 + 1));
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClientConn::FailPipeline(redis_cmd_pipepline_t& cp, const std::string& sDesc) {
+
+	CRedisReply reply(sDesc, CRedisReply::string_type::error);
+
+	if (cp._reply_cb) cp._reply_cb(std::move(reply));
+	if (cp._dispose_cb) cp._dispose_cb();
+
+	cp._state = redis_cmd_pipepline_t::PROCESS_OVER;
+
+	if (cp._sn > 0 && _pipelineOverCb) _pipelineOverCb(*this, cp);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+redis_cmd_pipepline_t *
+KjRedisClientConn::StreamingPipelineAt(size_t nth) {
+
+	if (_nStreamingNum <= 0)
+		return nullptr;
+
+	// replies come in the order of committing pipelines, each of them gets its tail reply last
+	for (auto& cp : _dqCommon) {
+		if (cp._state < redis_cmd_pipepline_t::COMMITTING)
+			break;
+
+		size_t szRemain = (size_t)(cp._built_num - cp._processed_num);
+		if (nth < szRemain) {
+			if (nth + 1 < szRemain)
+				return nullptr;
+
+			return &cp;
+		}
+		nth -= szRemain;
+	}
+	return nullptr;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+const redis_element_cb_t *
+KjRedisClientConn::StreamVisitorAt(size_t nth) {
+	// visits nothing, for a pipeline whose deadline fired
+	static const redis_element_cb_t s_discard;
+
+	redis_cmd_pipepline_t *cp = StreamingPipelineAt(nth);
+	if (!cp
+		|| !cp->_element_cb)
+		return nullptr;
+
+	if (cp->_deadline
+		&& cp->_deadline->_fired)
+		return &s_discard;
+
+	return &cp->_element_cb;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+const redis_bulk_chunk_cb_t *
+KjRedisClientConn::BulkSinkAt(size_t nth) {
+	// takes nothing, for a pipeline whose deadline fired
+	static const redis_bulk_chunk_cb_t s_discard;
+
+	redis_cmd_pipepline_t *cp = StreamingPipelineAt(nth);
+	if (!cp
+		|| !cp->_chunk_cb)
+		return nullptr;
+
+	if (cp->_deadline
+		&& cp->_deadline->_fired)
+		return &s_discard;
+
+	return &cp->_chunk_cb;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClientConn::TrimReplay() {
+
+	size_t szUnsent = 0;
+	for (auto& cp : _dqCommon) {
+		if (cp._sn > 0
+			&& cp._state < redis_cmd_pipepline_t::COMMITTING)
+			++szUnsent;
+	}
+
+	// oldest first
+	auto it = _dqCommon.begin();
+	while (szUnsent > _refParam._nReplayLimit
+		&& it != _dqCommon.end()) {
+
+		redis_cmd_pipepline_t& cp = (*it);
+		if (cp._sn > 0
+			&& cp._state < redis_cmd_pipepline_t::COMMITTING) {
+
+			FailPipeline(cp, "CONNDOWN replay buffer is full, redis connection is down");
+			it = _dqCommon.erase(it);
+			--szUnsent;
+			continue;
+		}
+		++it;
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+int
+KjRedisClientConn::OldestUnsentSn() {
+
+	for (auto& cp : _dqCommon) {
+		if (cp._sn > 0
+			&& cp._state < redis_cmd_pipepline_t::COMMITTING)
+			return cp._sn;
+	}
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+int
+KjRedisClientConn::DropUnsent(int nSn, const std::string& sDesc) {
+
+	int nCount = 0;
+	auto it = _dqCommon.begin();
+	while (it != _dqCommon.end()) {
+		redis_cmd_pipepline_t& cp = (*it);
+		if (cp._sn == nSn
+			&& cp._state < redis_cmd_pipepline_t::COMMITTING) {
+
+			FailPipeline(cp, sDesc);
+			it = _dqCommon.erase(it);
+			++nCount;
+			continue;
+		}
+		++it;
+	}
+	return nCount;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClientConn::EnterFastFail() {
+
+	fprintf(stderr, "[KjRedisClientConn::EnterFastFail()] connid(%08llu)host(%s)port(%d), enter fast-fail after (%d) reconnect(s)!!!\n",
+		_kjconn.GetConnId(), _kjconn.GetHost().cStr(), _kjconn.GetPort(), _nReconnectAttempts);
+
+	_bFastFail = true;
+
+	// init pipelines (sn 0) are built again on connect
+	auto it = _dqCommon.begin();
+	while (it != _dqCommon.end()) {
+		redis_cmd_pipepline_t& cp = (*it);
+		if (cp._sn > 0
+			&& cp._state < redis_cmd_pipepline_t::COMMITTING) {
+
+			FailPipeline(cp, "CONNDOWN fast-fail, redis connection is down");
+			it = _dqCommon.erase(it);
+			continue;
+		}
+		++it;
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
 */
 kj::Promise<void>
 KjRedisClientConn::CommitLoop() {
 
 	if (IsConnected()) {
+		// the write in flight picks up the rest when it is done
+		if (_bWriting)
+			return kj::READY_NOW;
+
+		if (_refParam._refNearCache)
+			EnableTracking();
+
+		DropExpired();
+
+		// coalesce sending cmd pipelines into one scatter-gather write
+		kj::Vector<kj::ArrayPtr<const kj::byte>> vPieces;
+		size_t szBatch = 0;
+
 		for (auto& cp : _dqCommon) {
 			if (redis_cmd_pipepline_t::SENDING == cp._state) {
 
-				_kjconn.Write(cp._commands.c_str(), cp._commands.length());
-				
+				size_t szLen = cp._commands.length();
+				if (vPieces.size() > 0
+					&& szBatch + szLen > _refParam._nCommitBatchBytes) {
+					// batch is full
+					break;
+				}
+
+				if (_refParam._nMaxInflightBytes > 0
+					&& _nInflightBytes > 0
+					&& (size_t)_nInflightBytes + szLen > _refParam._nMaxInflightBytes) {
+					// too much unreplied, OnClientReceive() commits again
+					_bInflightHeld = true;
+					if (_refCounters) ++_refCounters->_heldWriteNum;
+					break;
+				}
+
+				vPieces.add(kj::arrayPtr((const kj::byte *)cp._commands.data(), szLen));
+				szBatch += szLen;
+				AddInflight((int64_t)szLen);
+
 				cp._state = redis_cmd_pipepline_t::COMMITTING;
 				++_committing_num;
 			}
 		}
-		
+
 		// commit over
-		return kj::READY_NOW;
-	}
-	else {
-		// "redis client commit loop"
-		auto p1 = _endpointContext->AfterDelay(1 * kj::SECONDS)
+		if (vPieces.size() <= 0)
+			return kj::READY_NOW;
+
+		// "_commands" of committing pipelines stay in "_dqCommon" until their replies arrive
+		_bWriting = true;
+
+		auto pieces = vPieces.releaseAsArray();
+		auto p1 = _kjconn.Write(pieces.asPtr())
+			.attach(kj::mv(pieces))
 			.then([this]() {
 
+			_bWriting = false;
 			return CommitLoop();
 		});
 		return p1;
 	}
+	else {
+		// nothing to poll for, OnClientConnect() commits everything kept for replay
+		return kj::READY_NOW;
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClientConn::DropExpired() {
+
+	// timed out before being sent, the server never sees them -- sent ones wait for their replies
+	auto it = _dqCommon.begin();
+	while (it != _dqCommon.end()) {
+		redis_cmd_pipepline_t& cp = (*it);
+		if (redis_cmd_pipepline_t::SENDING == cp._state
+			&& cp._deadline
+			&& cp._deadline->_fired) {
+
+			cp._state = redis_cmd_pipepline_t::PROCESS_OVER;
+
+			if (cp._sn > 0 && _pipelineOverCb) _pipelineOverCb(*this, cp);
+
+			it = _dqCommon.erase(it);
+			continue;
+		}
+		++it;
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClientConn::EnableTracking() {
+
+	int64_t nRedirectId = _refParam._refNearCache->TrackingRedirectId();
+	if (nRedirectId <= 0
+		|| nRedirectId == _nTrackingRedirectId)
+		return;
+
+	// must be ahead of every read not sent yet
+	auto it = _dqCommon.begin();
+	while (it != _dqCommon.end()
+		&& redis_cmd_pipepline_t::SENDING != (*it)._state) {
+		++it;
+	}
+
+	if (it == _dqCommon.end())
+		return;
+
+	std::string sCommands;
+	int nBuiltNum = 0;
+	if (CRedisNearCache::TRACKING_SELF == nRedirectId)
+		CRedisCommandBuilder::Encode(sCommands, nBuiltNum, "CLIENT", "TRACKING", "on");
+	else
+		CRedisCommandBuilder::Encode(sCommands, nBuiltNum, "CLIENT", "TRACKING", "on", "REDIRECT", nRedirectId);
+
+	auto cp = CKjRedisClientWorkQueue::CreateCmdPipeline(
+		0,
+		sCommands,
+		nBuiltNum,
+		nullptr,
+		nullptr);
+	cp._state = redis_cmd_pipepline_t::SENDING;
+
+	_dqCommon.emplace(it, std::move(cp));
+	_nTrackingRedirectId = nRedirectId;
 }
 
 //------------------------------------------------------------------------------
@@ -440,6 +1002,10 @@ KjRedisClientConn::taskFailed(kj::Exception&& exception) {
 			cp._state = redis_cmd_pipepline_t::QUEUEING;
 		}
 		_committing_num = 0;
+		_bWriting = false;
+
+		AddInflight(-_nInflightBytes);
+		_bInflightHeld = false;
 
 		//
 		DelayReconnect();
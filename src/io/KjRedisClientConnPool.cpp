@@ -0,0 +1,151 @@
+//------------------------------------------------------------------------------
+//  KjRedisClientConnPool.cpp
+//  (C) 2016 n.lee
+//------------------------------------------------------------------------------
+#include "KjRedisClientConnPool.hpp"
+
+#include "../RedisRootContextDef.hpp"
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+KjRedisClientConnPool::KjRedisClientConnPool(kj::Own<KjPipeEndpointIoContext> endpointContext, redis_stub_param_t& param, int nPoolSize) {
+	//
+	if (nPoolSize < 1)
+		nPoolSize = 1;
+
+	_vConn.reserve(nPoolSize);
+	_vNeedCommit.resize(nPoolSize, false);
+
+	for (int i = 0; i < nPoolSize; ++i) {
+		auto conn = kj::heap<KjRedisClientConn>(kj::addRef(*endpointContext), param);
+		conn->SetPipelineOverCb(
+			std::bind(&KjRedisClientConnPool::OnPipelineOver, this, std::placeholders::_1, std::placeholders::_2));
+		_vConn.emplace_back(kj::mv(conn));
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+KjRedisClientConnPool::~KjRedisClientConnPool() {
+
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClientConnPool::Open(redis_stub_param_t& param) {
+	for (auto& conn : _vConn) {
+		conn->Open(param);
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClientConnPool::Close() {
+	for (auto& conn : _vConn) {
+		conn->Close();
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+KjRedisClientConnPool&
+KjRedisClientConnPool::Send(redis_cmd_pipepline_t& cp) {
+
+	size_t idx = SelectConn(cp._caller);
+
+	// the caller is in flight on this connection now, caller 0 has no ordering to keep
+	if (cp._caller != 0) {
+		caller_route_t& route = _mapCallerRoute[cp._caller];
+		route._connIdx = idx;
+		++route._pending;
+	}
+
+	_vConn[idx]->Send(cp);
+	_vNeedCommit[idx] = true;
+	return *this;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+KjRedisClientConnPool&
+KjRedisClientConnPool::Commit() {
+
+	for (size_t i = 0; i < _vConn.size(); ++i) {
+		if (_vNeedCommit[i]) {
+			_vNeedCommit[i] = false;
+			_vConn[i]->Commit();
+		}
+	}
+	return *this;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+size_t
+KjRedisClientConnPool::SelectConn(uint32_t uCaller) {
+
+	// keep caller's ordering
+	if (uCaller != 0) {
+		auto it = _mapCallerRoute.find(uCaller);
+		if (it != _mapCallerRoute.end()
+			&& (*it).second._pending > 0) {
+			return (*it).second._connIdx;
+		}
+	}
+
+	// least-loaded, scan from a rotating start so that ties are spread
+	size_t szCount = _vConn.size();
+	size_t szBest = _nextIdx % szCount;
+	size_t szBestLoad = _vConn[szBest]->UncommittedSize();
+	size_t i, idx, load;
+
+	for (i = 1; i < szCount && szBestLoad > 0; ++i) {
+		idx = (_nextIdx + i) % szCount;
+		load = _vConn[idx]->UncommittedSize();
+		if (load < szBestLoad) {
+			szBest = idx;
+			szBestLoad = load;
+		}
+	}
+
+	_nextIdx = szBest + 1;
+	return szBest;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClientConnPool::OnPipelineOver(KjRedisClientConn&, redis_cmd_pipepline_t& cp) {
+
+	if (cp._caller == 0)
+		return;
+
+	auto it = _mapCallerRoute.find(cp._caller);
+	if (it != _mapCallerRoute.end()) {
+		caller_route_t& route = (*it).second;
+		if (--route._pending <= 0) {
+			// no pipeline in flight, caller is free to move
+			_mapCallerRoute.erase(it);
+		}
+	}
+}
+
+/** -- EOF -- **/
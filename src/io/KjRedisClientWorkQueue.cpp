@@ -5,19 +5,29 @@
 #include "KjRedisClientWorkQueue.hpp"
 
 #include <future>
+#include <unordered_map>
 #include "../RedisRootContextDef.hpp"
 #include "../RedisClient.h"
 
-#include "KjRedisClientConn.hpp"
+#include "KjRedisClientConnPool.hpp"
+#include "KjRedisClusterConnPool.hpp"
+#include "KjRedisReplicaPool.hpp"
+#include "KjRedisTimerWheel.hpp"
 
 struct redis_client_thread_env_t {
 	svrcore_pipeworker_t       *worker;
 
 	kj::Own<kj::TaskSet>        tasks;
-	kj::Own<KjRedisClientConn>  conn;
+	kj::Own<KjRedisClientConnPool> pool;
+	kj::Own<KjRedisClusterConnPool> cluster;
+	kj::Own<KjRedisReplicaPool> replicas;
+	kj::Own<KjRedisTimerWheel> wheel;
 };
 static thread_local redis_client_thread_env_t *stl_env = nullptr;
 
+static std::atomic<uint64_t> s_work_queue_id(0);
+static thread_local std::unordered_map<uint64_t, CKjRedisClientWorkQueue::producer_t *> stl_producers;
+
 static kj::Promise<void>
 check_quit_loop(CKjRedisClientWorkQueue& q, redis_client_thread_env_t& env, kj::PromiseFulfiller<void> *fulfiller) {
 	if (!q.IsDone()) {
@@ -34,6 +44,101 @@ check_quit_loop(CKjRedisClientWorkQueue& q, redis_client_thread_env_t& env, kj::
 	return kj::READY_NOW;
 }
 
+static void
+arm_deadline(redis_client_thread_env_t& env, redis_cmd_pipepline_t& cp) {
+	// the callbacks wait in "_deadline", whoever comes first fires them: the tail reply or the wheel.
+	// The pipeline itself stays where it is, so a late reply is still counted by its connection.
+	// Not make_shared(): the weak pointer of the wheel must not keep the callbacks' storage
+	std::shared_ptr<redis_cmd_pipepline_deadline_t> deadline(new redis_cmd_pipepline_deadline_t);
+	deadline->_reply_cb = std::move(cp._reply_cb);
+	deadline->_dispose_cb = std::move(cp._dispose_cb);
+
+	uint32_t uTimeoutMs = cp._timeout_ms;
+	std::weak_ptr<redis_cmd_pipepline_deadline_t> weakDeadline = deadline;
+	KjRedisTimerWheel::handle_t timer = env.wheel->Add(uTimeoutMs, [weakDeadline, uTimeoutMs]() {
+		auto deadline = weakDeadline.lock();
+		if (!deadline
+			|| deadline->_fired)
+			return;
+
+		deadline->_fired = true;
+
+		char chDesc[128];
+		snprintf(chDesc, sizeof(chDesc), "TIMEOUT cmd pipeline is not replied in %u ms", uTimeoutMs);
+		CRedisReply reply(std::string(chDesc), CRedisReply::string_type::error);
+
+		if (deadline->_reply_cb) deadline->_reply_cb(std::move(reply));
+		if (deadline->_dispose_cb) deadline->_dispose_cb();
+	});
+
+	// the wheel entry goes with the reply, not when the timeout runs out -- both are on this thread
+	KjRedisTimerWheel *wheel = env.wheel.get();
+	cp._reply_cb = [deadline, wheel, timer](CRedisReply&& reply) {
+		if (deadline->_fired)
+			return;
+
+		deadline->_fired = true;
+		wheel->Cancel(timer);
+
+		if (deadline->_reply_cb) deadline->_reply_cb(std::move(reply));
+		if (deadline->_dispose_cb) deadline->_dispose_cb();
+	};
+	cp._dispose_cb = nullptr;
+	cp._deadline = deadline;
+}
+
+static void
+fail_pipeline(redis_cmd_pipepline_t& cp, const char *desc) {
+	CRedisReply reply(std::string(desc), CRedisReply::string_type::error);
+
+	if (cp._reply_cb) cp._reply_cb(std::move(reply));
+	if (cp._dispose_cb) cp._dispose_cb();
+
+	cp._state = redis_cmd_pipepline_t::PROCESS_OVER;
+}
+
+static bool
+drop_oldest(CKjRedisClientWorkQueue& q, redis_client_thread_env_t& env) {
+	// pipelines queued on the connections and not written yet, the oldest of all of them
+	std::vector<KjRedisClientConn *> vConn;
+	auto collect = [&vConn](KjRedisClientConn& conn) {
+		vConn.emplace_back(&conn);
+	};
+
+	if (env.cluster.get() != nullptr)
+		env.cluster->ForEachConn(collect);
+	else
+		env.pool->ForEachConn(collect);
+
+	if (env.replicas.get() != nullptr)
+		env.replicas->ForEachConn(collect);
+
+	static const std::string s_sDesc = "BUSY dropped for newer cmd pipelines";
+
+	KjRedisClientConn *oldest = nullptr;
+	int nOldestSn = 0;
+	for (auto& conn : vConn) {
+		int nSn = conn->OldestUnsentSn();
+		if (nSn > 0
+			&& (!oldest || nSn < nOldestSn)) {
+			oldest = conn;
+			nOldestSn = nSn;
+		}
+	}
+
+	// all of them are written already
+	if (!oldest)
+		return false;
+
+	// commands of a split pipeline may wait on other nodes too
+	for (auto& conn : vConn) {
+		conn->DropUnsent(nOldestSn, s_sDesc);
+	}
+
+	++q.Counters()._droppedNum;
+	return true;
+}
+
 static kj::Promise<void>
 read_pipe_loop(CKjRedisClientWorkQueue& q, redis_client_thread_env_t& env, kj::AsyncIoStream& stream) {
 
@@ -43,14 +148,43 @@ read_pipe_loop(CKjRedisClientWorkQueue& q, redis_client_thread_env_t& env, kj::A
 			//
 			// Get next work item.
 			//
-			int nCount = 0;
-			while (q.Callbacks().try_dequeue(q._opCmd)) {
-				env.conn->Send(q._opCmd);
-				++nCount;
-			}
+			int nCount = q.Drain([&q, &env](redis_cmd_pipepline_t& cp) {
+				if (cp._rejected) {
+					fail_pipeline(cp, "BUSY too many pending cmd pipelines");
+					q.Recycle(cp);
+					return;
+				}
+
+				// ahead of sending it, so it is never the one dropped -- nothing to drop refuses it instead
+				if (cp._drop_oldest
+					&& !drop_oldest(q, env)) {
+					++q.Counters()._failedNum;
+					fail_pipeline(cp, "BUSY too many pending cmd pipelines");
+					q.Recycle(cp);
+					return;
+				}
+
+				if (cp._timeout_ms > 0)
+					arm_deadline(env, cp);
+
+				if (env.cluster.get() != nullptr)
+					env.cluster->Send(cp);
+				else if (!cp._replica
+					|| env.replicas.get() == nullptr
+					|| !env.replicas->Send(cp))
+					env.pool->Send(cp);
+			});
 
 			if (nCount > 0) {
-				env.conn->Commit();
+				if (env.cluster.get() != nullptr) {
+					env.cluster->Commit();
+				}
+				else {
+					env.pool->Commit();
+
+					if (env.replicas.get() != nullptr)
+						env.replicas->Commit();
+				}
 			}
 			return read_pipe_loop(q, env, stream);
 		});
@@ -62,11 +196,19 @@ read_pipe_loop(CKjRedisClientWorkQueue& q, redis_client_thread_env_t& env, kj::A
 /**
 
 */
-CKjRedisClientWorkQueue::CKjRedisClientWorkQueue(CRedisClient *pRedisHandle, redis_stub_param_t& param)
+CKjRedisClientWorkQueue::CKjRedisClientWorkQueue(CRedisClient *pRedisHandle, redis_stub_param_t& param, int nConnPoolSize)
 	: _refRedisHandle(pRedisHandle)
 	, _refParam(param)
-	, _callbacks(256) {
-
+	, _nConnPoolSize(nConnPoolSize)
+	, _queueId(++s_work_queue_id)
+	, _nProducerNum(0)
+	, _sharedProducer(-1)
+	, _nRoomWaiterNum(0)
+	, _opCodeSend(0) {
+	//
+	for (auto& producer : _arrProducer) {
+		producer.store(nullptr, std::memory_order_relaxed);
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -74,7 +216,10 @@ CKjRedisClientWorkQueue::CKjRedisClientWorkQueue(CRedisClient *pRedisHandle, red
 
 */
 CKjRedisClientWorkQueue::~CKjRedisClientWorkQueue() {
-
+	int nProducerNum = _nProducerNum.load(std::memory_order_acquire);
+	for (int i = 0; i < nProducerNum; ++i) {
+		delete _arrProducer[i].exchange(nullptr);
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -84,18 +229,49 @@ CKjRedisClientWorkQueue::~CKjRedisClientWorkQueue() {
 void
 CKjRedisClientWorkQueue::Run(svrcore_pipeworker_t *worker) {
 	//
+	_workerThreadId = std::this_thread::get_id();
+
 	stl_env = new redis_client_thread_env_t;
 	stl_env->worker = worker;
 	stl_env->tasks = redis_get_servercore()->NewTaskSet(*this);
-	stl_env->conn = kj::heap<KjRedisClientConn>(kj::addRef(*worker->endpointContext), _refParam);
+	stl_env->wheel = kj::heap<KjRedisTimerWheel>(kj::addRef(*worker->endpointContext), *stl_env->tasks);
+	if (_refParam._bCluster)
+		stl_env->cluster = kj::heap<KjRedisClusterConnPool>(kj::addRef(*worker->endpointContext), _refParam);
+	else
+		stl_env->pool = kj::heap<KjRedisClientConnPool>(kj::addRef(*worker->endpointContext), _refParam, _nConnPoolSize);
+
+	if (!_refParam._bCluster
+		&& !_refParam._vReplica.empty())
+		stl_env->replicas = kj::heap<KjRedisReplicaPool>(kj::addRef(*worker->endpointContext), _refParam, _nConnPoolSize);
+
+	// in-flight bytes and command buffers of every connection
+	if (stl_env->cluster.get() != nullptr)
+		stl_env->cluster->SetWorkQueue(this);
+	else
+		stl_env->pool->SetWorkQueue(this);
+
+	if (stl_env->replicas.get() != nullptr)
+		stl_env->replicas->SetWorkQueue(this);
 
 	//
 	InitTasks();
 
 	// thread dispose
-	stl_env->conn->Close();
-	stl_env->conn = nullptr;
+	if (stl_env->cluster.get() != nullptr) {
+		stl_env->cluster->Close();
+		stl_env->cluster = nullptr;
+	}
+	else {
+		stl_env->pool->Close();
+		stl_env->pool = nullptr;
+	}
+
+	if (stl_env->replicas.get() != nullptr) {
+		stl_env->replicas->Close();
+		stl_env->replicas = nullptr;
+	}
 	stl_env->tasks = nullptr;
+	stl_env->wheel = nullptr;
 
 	delete stl_env;
 	stl_env = nullptr;
@@ -110,30 +286,162 @@ CKjRedisClientWorkQueue::Run(svrcore_pipeworker_t *worker) {
 bool
 CKjRedisClientWorkQueue::Add(redis_cmd_pipepline_t&& cmd) {
 
+	// never dropped: a blocking waiter must wake up and the admitted slot must be released
 	if (_done) {
 		// error
-		fprintf(stderr, "[CKjRedisClientWorkQueue::Add()] can't enqueue, callback is dropped!!!");
+		fprintf(stderr, "[CKjRedisClientWorkQueue::Add()] can't enqueue, cmd pipeline is failed!!!");
+		fail_pipeline(cmd, "SHUTDOWN cmd pipeline is not sent, the client is shut down");
 		return false;
 	}
 
 	//
 	// Add work item.
 	//
-	if (!_callbacks.enqueue(std::move(cmd))) {
+	producer_t *producer = LocalProducer();
+	cmd._owner = producer->_index;
+
+	bool bEnqueued;
+	if (producer->_index >= 0) {
+		bEnqueued = producer->_callbacks.enqueue(std::move(cmd));
+	}
+	else {
+		std::lock_guard<std::mutex> lock(_mtxSharedProducer);
+		bEnqueued = producer->_callbacks.enqueue(std::move(cmd));
+	}
+
+	// "cmd" is not moved from when it fails
+	if (!bEnqueued) {
 		// error
-		fprintf(stderr, "[CKjRedisClientWorkQueue::Add()] enqueue failed, callback is dropped!!!");
+		fprintf(stderr, "[CKjRedisClientWorkQueue::Add()] enqueue failed, cmd pipeline is failed!!!");
+		fail_pipeline(cmd, "OOM cmd pipeline can't be queued");
 		return false;
 	}
 
-	// write opcode to trunk pipe
-	++_opCodeSend;
-	redis_get_servercore()->PipeNotify(*_refRedisHandle->_refPipeWorker->pipeThread.pipe.get(), _opCodeSend);
+	// write opcode to trunk pipe -- unless one is already waiting to be read
+	if (!_signal.Raise())
+		return true;
+
+	char chOpCode = ++_opCodeSend;
+	redis_get_servercore()->PipeNotify(*_refPipeWorker->pipeThread.pipe.get(), chOpCode);
 	return true;
 }
 
 //------------------------------------------------------------------------------
 /**
 
+*/
+void
+CKjRedisClientWorkQueue::TakeRecycledBuffer(std::string& sBuf) {
+
+	producer_t *producer = LocalProducer();
+	if (producer->_index >= 0
+		&& producer->_recycled.try_dequeue(sBuf))
+		return;
+
+	sBuf.resize(0);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CKjRedisClientWorkQueue::Recycle(redis_cmd_pipepline_t& cp) {
+
+	int nOwner = cp._owner;
+	cp._owner = -1;
+
+	if (nOwner < 0
+		|| nOwner >= _nProducerNum.load(std::memory_order_acquire)
+		|| cp._commands.capacity() > MAX_RECYCLED_BUFFER_BYTES)
+		return;
+
+	// the pipe worker is the only writer of "_recycled"
+	producer_t *producer = _arrProducer[nOwner].load(std::memory_order_acquire);
+	cp._commands.resize(0);
+	producer->_recycled.try_enqueue(std::move(cp._commands));
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CKjRedisClientWorkQueue::Admit(redis_cmd_pipepline_t& cp) {
+
+	int64_t nMax = (int64_t)_refParam._nMaxPendingPipelines;
+
+	if (nMax > 0
+		&& _counters._pendingNum.load(std::memory_order_acquire) >= nMax) {
+
+		switch (_refParam._eBackpressurePolicy) {
+		case redis_stub_param_t::BACKPRESSURE_FAIL:
+			++_counters._failedNum;
+			cp._rejected = true;
+			break;
+
+		case redis_stub_param_t::BACKPRESSURE_DROP_OLDEST:
+			cp._drop_oldest = true;
+			break;
+
+		default:
+			// the pipe worker releases them, so the wait never depends on the calling thread
+			++_counters._blockedNum;
+			++_nRoomWaiterNum;
+			{
+				std::unique_lock<std::mutex> lock(_mtxRoom);
+				_cvRoom.wait(lock, [this, nMax]() {
+					return _done
+						|| _counters._pendingNum.load() < nMax;
+				});
+			}
+			--_nRoomWaiterNum;
+			break;
+		}
+	}
+
+	// rejected ones are pending too, until the pipe worker fails them
+	_counters._pendingNum.fetch_add(1, std::memory_order_acq_rel);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+CKjRedisClientWorkQueue::producer_t *
+CKjRedisClientWorkQueue::LocalProducer() {
+
+	auto it = stl_producers.find(_queueId);
+	if (it != stl_producers.end()) {
+		return (*it).second;
+	}
+
+	// register new producer thread -- the only locked path
+	producer_t *producer = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(_mtxProducer);
+
+		int nProducerNum = _nProducerNum.load(std::memory_order_relaxed);
+		if (nProducerNum >= MAX_PRODUCER_NUM) {
+			// slower, but nothing is lost
+			fprintf(stderr, "[CKjRedisClientWorkQueue::LocalProducer()] too many producer threads (%d), the shared queue is used!!!\n",
+				nProducerNum);
+			producer = &_sharedProducer;
+		}
+		else {
+			producer = new producer_t(nProducerNum);
+			_arrProducer[nProducerNum].store(producer, std::memory_order_release);
+			_nProducerNum.store(nProducerNum + 1, std::memory_order_release);
+		}
+	}
+
+	stl_producers[_queueId] = producer;
+	return producer;
+}
+
+//------------------------------------------------------------------------------
+/**
+
 */
 void
 CKjRedisClientWorkQueue::Finish() {
@@ -142,6 +450,12 @@ CKjRedisClientWorkQueue::Finish() {
 	//
 	_done = true;
 
+	// blocked producers give up waiting
+	{
+		std::lock_guard<std::mutex> lock(_mtxRoom);
+		_cvRoom.notify_all();
+	}
+
 	// wait until finished
 	while (!_finished) {
 		util_sleep(10);
@@ -156,7 +470,13 @@ void
 CKjRedisClientWorkQueue::InitTasks() {
 
 	auto paf = kj::newPromiseAndFulfiller<void>();
-	stl_env->conn->Open(_refParam);
+	if (stl_env->cluster.get() != nullptr)
+		stl_env->cluster->Open(_refParam);
+	else
+		stl_env->pool->Open(_refParam);
+
+	if (stl_env->replicas.get() != nullptr)
+		stl_env->replicas->Open();
 
 	// "check_quit_loop"
 	stl_env->tasks->add(
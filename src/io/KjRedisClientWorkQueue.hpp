@@ -6,6 +6,10 @@
 	(C) 2016 n.lee
 */
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
 
 #include "servercore/base/IServerCore.h"
 
@@ -14,43 +18,132 @@
 #include "base/redis_service_def.h"
 #include "base/IRedisService.h"
 
+#include "KjRedisWakeupSignal.hpp"
+
 class CRedisClient;
 
 //------------------------------------------------------------------------------
 /**
 @brief CKjRedisClientWorkQueue
+
+//!
+//! multi-producer submission: each producer thread owns a SPSC queue, the pipe worker drains them all.
+//! Threads past "MAX_PRODUCER_NUM" share one more queue, taking turns under a lock
+//!
 */
 class CKjRedisClientWorkQueue : public kj::TaskSet::ErrorHandler {
 public:
-	explicit CKjRedisClientWorkQueue(CRedisClient *pRedisHandle, redis_stub_param_t& param);
+	explicit CKjRedisClientWorkQueue(CRedisClient *pRedisHandle, redis_stub_param_t& param, int nConnPoolSize);
 	~CKjRedisClientWorkQueue();
 
 	using CallbackEntry = redis_cmd_pipepline_t;
 
+	static const int MAX_PRODUCER_NUM = 64;
+
+	//! command buffers waiting for reuse per producer, and the largest one kept
+	static const int MAX_RECYCLED_BUFFER_NUM = 1024;
+	static const size_t MAX_RECYCLED_BUFFER_BYTES = 64 * 1024;
+
+	struct producer_t {
+		explicit producer_t(int nIndex) : _index(nIndex), _callbacks(256), _recycled(MAX_RECYCLED_BUFFER_NUM) {}
+		int _index;
+		moodycamel::ReaderWriterQueue<CallbackEntry> _callbacks;
+
+		//! the other way round: command buffers of finished pipelines, from the pipe worker back to the producer
+		moodycamel::ReaderWriterQueue<std::string> _recycled;
+	};
+
+	//! backpressure counters, updated by producers, the pipe worker and its connections
+	struct counters_t {
+		std::atomic<int64_t> _pendingNum{ 0 };
+		std::atomic<int64_t> _inflightBytes{ 0 };
+		std::atomic<uint64_t> _blockedNum{ 0 };
+		std::atomic<uint64_t> _failedNum{ 0 };
+		std::atomic<uint64_t> _droppedNum{ 0 };
+		std::atomic<uint64_t> _heldWriteNum{ 0 };
+	};
+
 	void						Run(svrcore_pipeworker_t *worker);
 
+	//! false when the pipeline can't be queued -- it is failed at once, on the calling thread
 	bool						Add(redis_cmd_pipepline_t&& cmd);
 
+	//! producer side, after Add(): "sBuf" (moved into the pipeline) takes a recycled buffer, if any
+	void						TakeRecycledBuffer(std::string& sBuf);
+
+	//! consumer side: hand "_commands" of a finished pipeline back to the producer which built it.
+	//! Never allocates -- a full queue or an oversized buffer just lets it go
+	void						Recycle(redis_cmd_pipepline_t& cp);
+
+	//! producer side, ahead of Add(): count one more pending pipeline and apply "_eBackpressurePolicy"
+	//! when there are "_nMaxPendingPipelines" already, by "_rejected" or "_drop_oldest" of "cp". Producers
+	//! racing on the last room may overshoot the limit by a few
+	void						Admit(redis_cmd_pipepline_t& cp);
+
+	//! an admitted pipeline is called back, wakes producers blocked in Admit() -- if there are any
+	void						Release() {
+		_counters._pendingNum.fetch_sub(1);
+
+		if (_nRoomWaiterNum.load() > 0) {
+			std::lock_guard<std::mutex> lock(_mtxRoom);
+			_cvRoom.notify_all();
+		}
+	}
+
+	counters_t&					Counters() {
+		return _counters;
+	}
+
 	bool						IsDone() {
 		return _done;
 	}
 
-	moodycamel::ReaderWriterQueue<CallbackEntry>& Callbacks() {
-		return _callbacks;
+	//! replies may go to the trunk queue only from the pipe worker, see Add()
+	bool						IsWorkerThread() const {
+		return std::this_thread::get_id() == _workerThreadId;
+	}
+
+	//! consumer side: dequeue from every producer, returns dequeued num
+	template<typename F>
+	int							Drain(F&& f) {
+		int nCount = 0;
+
+		// adds from now on notify again
+		_signal.Clear();
+
+		int nProducerNum = _nProducerNum.load(std::memory_order_acquire);
+		for (int i = 0; i < nProducerNum; ++i) {
+			producer_t *producer = _arrProducer[i].load(std::memory_order_acquire);
+			while (producer->_callbacks.try_dequeue(_opCmd)) {
+				f(_opCmd);
+				++nCount;
+			}
+		}
+
+		// the only consumer, no lock on this side
+		while (_sharedProducer._callbacks.try_dequeue(_opCmd)) {
+			f(_opCmd);
+			++nCount;
+		}
+		return nCount;
 	}
 
 	void						Finish();
 
 private:
 	void						InitTasks();
+
+	//! queue of the calling thread, registered on first use -- "_sharedProducer" when all are taken
+	producer_t *				LocalProducer();
 
 public:
 	static redis_cmd_pipepline_t	CreateCmdPipeline(
 		int nSn,
 		const std::string& sCommands,
 		int nBuiltNum,
-		redis_reply_cb_t&& reply_cb,
-		dispose_cb_t&& dispose_cb) {
+		redis_pipeline_cb_t&& reply_cb,
+		dispose_cb_t&& dispose_cb,
+		uint32_t uCaller = 0) {
 
 		redis_cmd_pipepline_t cp;
 		cp._sn = nSn;
@@ -60,9 +153,31 @@ public:
 		cp._reply_cb = std::move(reply_cb);
 		cp._dispose_cb = std::move(dispose_cb);
 		cp._state = redis_cmd_pipepline_t::QUEUEING;
+		cp._caller = uCaller;
 		return cp;
 	}
 
+	//! "sCommands" is moved in, no copy
+	static redis_cmd_pipepline_t	CreateCmdPipeline(
+		int nSn,
+		std::string&& sCommands,
+		int nBuiltNum,
+		redis_pipeline_cb_t&& reply_cb,
+		dispose_cb_t&& dispose_cb,
+		uint32_t uCaller = 0) {
+
+		redis_cmd_pipepline_t cp;
+		cp._sn = nSn;
+		cp._commands = std::move(sCommands);
+		cp._built_num = nBuiltNum;
+		cp._processed_num = 0;
+		cp._reply_cb = std::move(reply_cb);
+		cp._dispose_cb = std::move(dispose_cb);
+		cp._state = redis_cmd_pipepline_t::QUEUEING;
+		cp._caller = uCaller;
+		return cp;
+	}
+
 private:
 	//! 
 	void taskFailed(kj::Exception&& exception) override;
@@ -70,13 +185,36 @@ private:
 private:
 	CRedisClient *_refRedisHandle;
 	redis_stub_param_t& _refParam;
+	int _nConnPoolSize;
 
 	volatile bool _done = false;
 	volatile bool _finished = false;
-	moodycamel::ReaderWriterQueue<CallbackEntry> _callbacks;
+
+	//! producers are only appended (under "_mtxProducer"), never removed before dtor
+	uint64_t _queueId;
+	std::mutex _mtxProducer;
+	std::atomic<producer_t *> _arrProducer[MAX_PRODUCER_NUM];
+	std::atomic<int> _nProducerNum;
+
+	//! index -1: its pipelines keep their command buffers, "_recycled" of it is never used
+	std::mutex _mtxSharedProducer;
+	producer_t _sharedProducer;
+
+	//! submissions before the next Drain() share one opcode
+	KjRedisWakeupSignal _signal;
+
+	counters_t _counters;
+
+	//! BACKPRESSURE_BLOCK: producers waiting for room, Release() signals "_cvRoom" only when there are some
+	std::atomic<int> _nRoomWaiterNum;
+	std::mutex _mtxRoom;
+	std::condition_variable _cvRoom;
 
 public:
-	char _opCodeSend = 0;
+	svrcore_pipeworker_t *_refPipeWorker = nullptr;
+	std::thread::id _workerThreadId;
+
+	std::atomic<char> _opCodeSend;
 	char _opCodeRecvBuf[1024];
 
 	CallbackEntry _opCmd;
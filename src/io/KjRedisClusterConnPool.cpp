@@ -0,0 +1,668 @@
+//------------------------------------------------------------------------------
+//  KjRedisClusterConnPool.cpp
+//  (C) 2016 n.lee
+//------------------------------------------------------------------------------
+#include "KjRedisClusterConnPool.hpp"
+
+#include <ctype.h>
+#include <stdlib.h>
+
+#include "../RedisRootContextDef.hpp"
+#include "RedisCommandBuilder.h"
+#include "base/crc16.h"
+
+//! commands without key, they follow the key of the commands around them
+static const char *s_keyless_commands[] = {
+	"MULTI", "EXEC", "DISCARD", "UNWATCH", "PING", "ECHO", "INFO", "TIME", "DBSIZE", "SCRIPT",
+	"CLIENT", "CLUSTER", "HELLO", "AUTH", "SELECT", "ASKING", "READONLY", "READWRITE", "KEYS",
+	"RANDOMKEY", "FLUSHDB", "FLUSHALL",
+};
+
+//! commands with more than one key: args "_first" to "_last" by "_step", a negative "_last" counts
+//! from the end as in COMMAND INFO
+struct key_spec_t {
+	const char *_name;
+	int _first;
+	int _last;
+	int _step;
+};
+
+static const key_spec_t s_multi_key_commands[] = {
+	{ "MGET", 1, -1, 1 }, { "MSET", 1, -1, 2 }, { "MSETNX", 1, -1, 2 }, { "DEL", 1, -1, 1 },
+	{ "UNLINK", 1, -1, 1 }, { "EXISTS", 1, -1, 1 }, { "TOUCH", 1, -1, 1 }, { "WATCH", 1, -1, 1 },
+	{ "SUNION", 1, -1, 1 }, { "SINTER", 1, -1, 1 }, { "SDIFF", 1, -1, 1 }, { "SUNIONSTORE", 1, -1, 1 },
+	{ "SINTERSTORE", 1, -1, 1 }, { "SDIFFSTORE", 1, -1, 1 }, { "PFCOUNT", 1, -1, 1 }, { "PFMERGE", 1, -1, 1 },
+	{ "BLPOP", 1, -2, 1 }, { "BRPOP", 1, -2, 1 }, { "RENAME", 1, 2, 1 }, { "RENAMENX", 1, 2, 1 },
+	{ "RPOPLPUSH", 1, 2, 1 }, { "BRPOPLPUSH", 1, 2, 1 }, { "LMOVE", 1, 2, 1 }, { "SMOVE", 1, 2, 1 },
+	{ "COPY", 1, 2, 1 },
+};
+
+static const char *s_crossslot_desc = "CROSSSLOT Keys in request don't hash to the same slot";
+
+static bool
+is_command(const char *name, size_t len, const char *cmd) {
+	size_t i;
+	for (i = 0; i < len && cmd[i]; ++i) {
+		if (toupper((unsigned char)name[i]) != cmd[i])
+			return false;
+	}
+	return i == len && '\0' == cmd[i];
+}
+
+static bool
+read_header(char chLeading, const std::string& sCommands, size_t& pos, long long& llOut) {
+	const char *p = sCommands.data();
+	size_t szLen = sCommands.length();
+	long long llVal = 0;
+
+	if (pos >= szLen || p[pos] != chLeading)
+		return false;
+
+	for (++pos; pos < szLen && p[pos] >= '0' && p[pos] <= '9'; ++pos) {
+		llVal = llVal * 10 + (p[pos] - '0');
+	}
+
+	if (pos + 2 > szLen
+		|| p[pos] != '\r'
+		|| p[pos + 1] != '\n')
+		return false;
+
+	pos += 2;
+	llOut = llVal;
+	return true;
+}
+
+static bool
+is_redirect(const std::string& sError) {
+	return 0 == sError.compare(0, 6, "MOVED ")
+		|| 0 == sError.compare(0, 4, "ASK ");
+}
+
+static void
+fail_pipeline(redis_cmd_pipepline_t& cp, const char *desc) {
+	CRedisReply reply(std::string(desc), CRedisReply::string_type::error);
+
+	if (cp._reply_cb) cp._reply_cb(std::move(reply));
+	if (cp._dispose_cb) cp._dispose_cb();
+
+	cp._state = redis_cmd_pipepline_t::PROCESS_OVER;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+KjRedisClusterConnPool::KjRedisClusterConnPool(kj::Own<KjPipeEndpointIoContext> endpointContext, redis_stub_param_t& param)
+	: _endpointContext(kj::mv(endpointContext))
+	, _refParam(param)
+	, _vSlotNode(SLOT_NUM, 0) {
+	// seed node
+	NodeAt(param._ip, param._port);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+KjRedisClusterConnPool::~KjRedisClusterConnPool() {
+
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClusterConnPool::Open(redis_stub_param_t& param) {
+
+	_bOpened = true;
+
+	for (auto& node : _vNode) {
+		fprintf(stderr, "[KjRedisClusterConnPool::Open()] connect to node ip(%s)port(%d)...\n",
+			node._sHost.c_str(), node._port);
+
+		node._conn->Connect(node._sHost, node._port);
+	}
+
+	// slot map
+	RefreshSlots();
+	Commit();
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClusterConnPool::Close() {
+	for (auto& node : _vNode) {
+		node._conn->Close();
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClusterConnPool::SetWorkQueue(CKjRedisClientWorkQueue *workQueue) {
+	_refWorkQueue = workQueue;
+	for (auto& node : _vNode) {
+		node._conn->SetWorkQueue(workQueue);
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+KjRedisClusterConnPool&
+KjRedisClusterConnPool::Send(redis_cmd_pipepline_t& cp) {
+
+	if (!SplitCommands(cp._commands, _vCmd)
+		|| _vCmd.size() <= 0) {
+
+		fprintf(stderr, "[KjRedisClusterConnPool::Send()] bad commands, sent to the seed node as it is!!!\n");
+
+		_vNode[0]._conn->Send(cp);
+		_vNode[0]._bNeedCommit = true;
+		return *this;
+	}
+
+	// one unit per command, a transaction stays in one unit up to EXEC or DISCARD, or the end
+	auto split = std::make_shared<split_t>();
+	std::vector<unit_t>& vUnit = split->_vUnit;
+	bool bCrossSlot = false;
+
+	for (auto& cmd : _vCmd) {
+		if (vUnit.empty()
+			|| !vUnit.back()._bOpen) {
+			vUnit.emplace_back();
+			vUnit.back()._offset = cmd._offset;
+			vUnit.back()._bMulti = cmd._bMulti;
+			vUnit.back()._bOpen = cmd._bMulti;
+		}
+
+		unit_t& unit = vUnit.back();
+		unit._len = cmd._offset + cmd._len - unit._offset;
+		++unit._num;
+
+		if (cmd._bExec)
+			unit._bOpen = false;
+
+		if (cmd._bCrossSlot
+			|| (cmd._slot >= 0 && unit._slot >= 0 && cmd._slot != unit._slot))
+			bCrossSlot = true;
+
+		if (unit._slot < 0)
+			unit._slot = cmd._slot;
+	}
+
+	// a MOVED reply would move only a part of it, so none of it is sent
+	if (bCrossSlot) {
+		fprintf(stderr, "[KjRedisClusterConnPool::Send()] keys of a transaction or a multi-key command are not in one hash slot!!!\n");
+
+		fail_pipeline(cp, s_crossslot_desc);
+		if (_refWorkQueue) _refWorkQueue->Recycle(cp);
+		return *this;
+	}
+
+	// keyless units ahead of the first key go with it, the others with the unit before them
+	int nSlot = 0;
+	for (auto& unit : vUnit) {
+		if (unit._slot >= 0) {
+			nSlot = unit._slot;
+			break;
+		}
+	}
+
+	for (auto& unit : vUnit) {
+		if (unit._slot >= 0)
+			nSlot = unit._slot;
+		else
+			unit._slot = nSlot;
+	}
+
+	split->_cp = std::move(cp);
+	split->_cp._built_num = (int)_vCmd.size();
+	split->_remain = (int)vUnit.size();
+
+	for (size_t i = 0; i < vUnit.size(); ++i) {
+		SendUnit(split, (int)i, _vSlotNode[vUnit[i]._slot], false, 0);
+	}
+	return *this;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+KjRedisClusterConnPool&
+KjRedisClusterConnPool::Commit() {
+
+	for (auto& node : _vNode) {
+		if (node._bNeedCommit) {
+			node._bNeedCommit = false;
+			node._conn->Commit();
+		}
+	}
+	return *this;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+int
+KjRedisClusterConnPool::KeySlot(const char *key, size_t len) {
+
+	size_t s, e;
+
+	// hash tag: only the part between the first '{' and the next '}' is hashed
+	for (s = 0; s < len; ++s) {
+		if ('{' == key[s])
+			break;
+	}
+
+	if (s < len) {
+		for (e = s + 1; e < len; ++e) {
+			if ('}' == key[e])
+				break;
+		}
+
+		if (e < len
+			&& e != s + 1) {
+			key += s + 1;
+			len = e - s - 1;
+		}
+	}
+	return crc16(key, (int)len) & (SLOT_NUM - 1);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+KjRedisClusterConnPool::SplitCommands(const std::string& sCommands, std::vector<command_t>& vCmd) {
+
+	const char *base = sCommands.data();
+	size_t szLen = sCommands.length();
+	size_t pos = 0, szArgPos;
+	long long llArgc, llArgLen, llFirst, llLast, llStep, i;
+	int nSlot;
+
+	const char *arg[3];
+	size_t argLen[3];
+
+	vCmd.resize(0);
+
+	while (pos < szLen) {
+		command_t cmd;
+		cmd._offset = pos;
+
+		if (!read_header('*', sCommands, pos, llArgc)
+			|| llArgc <= 0)
+			return false;
+
+		szArgPos = pos;
+		for (i = 0; i < llArgc; ++i) {
+			if (!read_header('$', sCommands, pos, llArgLen)
+				|| pos + llArgLen + 2 > szLen)
+				return false;
+
+			if (i < 3) {
+				arg[i] = base + pos;
+				argLen[i] = (size_t)llArgLen;
+			}
+			pos += (size_t)llArgLen + 2;
+		}
+		cmd._len = pos - cmd._offset;
+
+		// key args, the first one by default
+		llFirst = 1;
+		llLast = 1;
+		llStep = 1;
+
+		if (is_command(arg[0], argLen[0], "EVAL")
+			|| is_command(arg[0], argLen[0], "EVALSHA")) {
+			// EVAL script numkeys key [key ...] arg [arg ...]
+			llFirst = 3;
+			llLast = (llArgc >= 3) ? 2 + atoi(std::string(arg[2], argLen[2]).c_str()) : 0;
+		}
+		else if (is_command(arg[0], argLen[0], "MULTI")) {
+			cmd._bMulti = true;
+			llLast = 0;
+		}
+		else if (is_command(arg[0], argLen[0], "EXEC")
+			|| is_command(arg[0], argLen[0], "DISCARD")) {
+			cmd._bExec = true;
+			llLast = 0;
+		}
+		else {
+			for (auto name : s_keyless_commands) {
+				if (is_command(arg[0], argLen[0], name)) {
+					llLast = 0;
+					break;
+				}
+			}
+
+			for (auto& spec : s_multi_key_commands) {
+				if (is_command(arg[0], argLen[0], spec._name)) {
+					llFirst = spec._first;
+					llLast = (spec._last < 0) ? llArgc + spec._last : spec._last;
+					llStep = spec._step;
+					break;
+				}
+			}
+
+			// keys being watched belong to the transaction after them
+			if (is_command(arg[0], argLen[0], "WATCH"))
+				cmd._bMulti = true;
+		}
+
+		if (llLast > llArgc - 1)
+			llLast = llArgc - 1;
+
+		// walk the args again for the keys
+		if (llFirst <= llLast) {
+			pos = szArgPos;
+			for (i = 0; i < llArgc; ++i) {
+				read_header('$', sCommands, pos, llArgLen);
+
+				if (i >= llFirst
+					&& i <= llLast
+					&& 0 == (i - llFirst) % llStep) {
+					nSlot = KeySlot(base + pos, (size_t)llArgLen);
+
+					if (cmd._slot < 0)
+						cmd._slot = nSlot;
+					else if (cmd._slot != nSlot)
+						cmd._bCrossSlot = true;
+				}
+				pos += (size_t)llArgLen + 2;
+			}
+		}
+
+		vCmd.emplace_back(cmd);
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+size_t
+KjRedisClusterConnPool::NodeAt(const std::string& sHost, unsigned short port) {
+
+	size_t i;
+	for (i = 0; i < _vNode.size(); ++i) {
+		if (_vNode[i]._port == port
+			&& _vNode[i]._sHost == sHost) {
+			return i;
+		}
+	}
+
+	node_t node;
+	node._sHost = sHost;
+	node._port = port;
+	node._conn = kj::heap<KjRedisClientConn>(kj::addRef(*_endpointContext), _refParam);
+	node._conn->SetWorkQueue(_refWorkQueue);
+
+	if (_bOpened) {
+		fprintf(stderr, "[KjRedisClusterConnPool::NodeAt()] connect to new node ip(%s)port(%d)...\n",
+			sHost.c_str(), port);
+
+		node._conn->Connect(sHost, port);
+	}
+
+	_vNode.emplace_back(kj::mv(node));
+	return i;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClusterConnPool::SendUnit(const split_ptr_t& split, int nUnit, size_t nodeIdx, bool bAsking, int nRedirect) {
+
+	unit_t& unit = split->_vUnit[nUnit];
+	std::string sCommands;
+	int nBuiltNum = 0;
+
+	if (bAsking) {
+		CRedisCommandBuilder::Encode(sCommands, nBuiltNum, "ASKING");
+	}
+	sCommands.append(split->_cp._commands, unit._offset, unit._len);
+	nBuiltNum += unit._num;
+
+	// every unit is a pipeline of its own, the connection still writes them in one batch
+	auto cp = CKjRedisClientWorkQueue::CreateCmdPipeline(
+		split->_cp._sn,
+		sCommands,
+		nBuiltNum,
+		[this, split, nUnit, nRedirect](CRedisReply&& reply) {
+		OnUnitReply(split, nUnit, nRedirect, std::move(reply));
+	},
+		nullptr,
+		split->_cp._caller);
+
+	// the queued commands of a transaction are replied ahead of EXEC
+	if (unit._bMulti) {
+		cp._segment_cb = [split, nUnit](int, CRedisReply&& reply) {
+			unit_t& unit = split->_vUnit[nUnit];
+			if (unit._sRedirect.empty()
+				&& reply.is_error()
+				&& is_redirect(reply.as_string())) {
+				unit._sRedirect = reply.as_string();
+			}
+		};
+	}
+
+	node_t& node = _vNode[nodeIdx];
+	node._conn->Send(cp);
+	node._bNeedCommit = true;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClusterConnPool::OnUnitReply(const split_ptr_t& split, int nUnit, int nRedirect, CRedisReply&& reply) {
+
+	unit_t& unit = split->_vUnit[nUnit];
+	std::string sRedirect;
+	bool bAsk;
+	int nSlot;
+	std::string sHost;
+	unsigned short port;
+
+	if (unit._bMulti)
+		sRedirect.swap(unit._sRedirect);
+	else if (reply.is_error())
+		sRedirect = reply.as_string();
+
+	if (!sRedirect.empty()
+		&& ParseRedirect(sRedirect, bAsk, nSlot, sHost, port)) {
+
+		if (bAsk && unit._bMulti) {
+			// ASKING only holds for MULTI after it, the queued commands would be redirected again
+			fprintf(stderr, "[KjRedisClusterConnPool::OnUnitReply()] transaction is asked to another node, reply(%s)!!!\n",
+				sRedirect.c_str());
+		}
+		else if (nRedirect < MAX_REDIRECT_NUM) {
+			size_t nodeIdx = NodeAt(sHost, port);
+
+			if (!bAsk) {
+				// the slot is moved for good, others may have moved with it
+				_vSlotNode[nSlot] = (uint16_t)nodeIdx;
+				RefreshSlots();
+			}
+
+			// an aborted transaction did nothing, it goes again as a whole
+			SendUnit(split, nUnit, nodeIdx, bAsk, nRedirect + 1);
+			Commit();
+			return;
+		}
+		else {
+			fprintf(stderr, "[KjRedisClusterConnPool::OnUnitReply()] too many redirects, reply(%s)!!!\n",
+				sRedirect.c_str());
+		}
+	}
+
+	redis_cmd_pipepline_t& cp = split->_cp;
+
+	if (nUnit == (int)split->_vUnit.size() - 1) {
+		split->_tailReply = std::move(reply);
+	}
+
+	// process over -- all units are replied, run callback on the tail reply
+	if (--split->_remain <= 0) {
+		if (cp._reply_cb) cp._reply_cb(std::move(split->_tailReply));
+		if (cp._dispose_cb) cp._dispose_cb();
+
+		cp._state = redis_cmd_pipepline_t::PROCESS_OVER;
+
+		// sub-pipelines copied out of it are not recycled, the original buffer is
+		if (_refWorkQueue) _refWorkQueue->Recycle(cp);
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+KjRedisClusterConnPool::ParseRedirect(const std::string& sError, bool& bAsk, int& nSlot, std::string& sHost, unsigned short& port) {
+
+	size_t szSlotPos, szAddrPos, szPortPos;
+
+	if (0 == sError.compare(0, 6, "MOVED ")) {
+		bAsk = false;
+		szSlotPos = 6;
+	}
+	else if (0 == sError.compare(0, 4, "ASK ")) {
+		bAsk = true;
+		szSlotPos = 4;
+	}
+	else {
+		return false;
+	}
+
+	szAddrPos = sError.find(' ', szSlotPos);
+	if (std::string::npos == szAddrPos)
+		return false;
+
+	++szAddrPos;
+
+	// ipv6 address has ':' in it too
+	szPortPos = sError.rfind(':');
+	if (std::string::npos == szPortPos
+		|| szPortPos < szAddrPos)
+		return false;
+
+	nSlot = atoi(sError.c_str() + szSlotPos);
+	if (nSlot < 0 || nSlot >= SLOT_NUM)
+		return false;
+
+	sHost = sError.substr(szAddrPos, szPortPos - szAddrPos);
+	port = (unsigned short)atoi(sError.c_str() + szPortPos + 1);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClusterConnPool::RefreshSlots() {
+
+	time_t tmNow = time(nullptr);
+	if (_bRefreshing
+		&& tmNow - _tmRefresh < REFRESH_TIMEOUT_SECONDS)
+		return;
+
+	_bRefreshing = true;
+	_tmRefresh = tmNow;
+
+	// any node knows the whole map, prefer a connected one
+	_refreshNodeIdx = 0;
+	for (size_t i = 0; i < _vNode.size(); ++i) {
+		if (_vNode[i]._conn->IsConnected()) {
+			_refreshNodeIdx = i;
+			break;
+		}
+	}
+
+	std::string sCommands;
+	int nBuiltNum = 0;
+	CRedisCommandBuilder::Encode(sCommands, nBuiltNum, "CLUSTER", "SLOTS");
+
+	auto cp = CKjRedisClientWorkQueue::CreateCmdPipeline(
+		0,
+		sCommands,
+		nBuiltNum,
+		[this](CRedisReply&& reply) {
+		OnSlotsReply(std::move(reply));
+	},
+		[this]() {
+		// also when it is lost with the connection and never replied, see KjRedisClientConn::OnClientConnect()
+		_bRefreshing = false;
+	});
+
+	node_t& node = _vNode[_refreshNodeIdx];
+	node._conn->Send(cp);
+	node._bNeedCommit = true;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisClusterConnPool::OnSlotsReply(CRedisReply&& reply) {
+
+	_bRefreshing = false;
+
+	if (!reply.is_array())
+		return;
+
+	// [[start, end, [host, port, id], replica ...], ...]
+	std::string sReplyHost = _vNode[_refreshNodeIdx]._sHost;
+	int nStart, nEnd, s;
+
+	for (auto& range : reply.as_array()) {
+		if (!range.is_array()
+			|| range.as_array().size() < 3)
+			continue;
+
+		std::vector<CRedisReply>& v = range.as_array();
+		if (!v[2].is_array()
+			|| v[2].as_array().size() < 2)
+			continue;
+
+		std::vector<CRedisReply>& master = v[2].as_array();
+		std::string sHost = master[0].is_string() ? master[0].as_string() : std::string();
+		unsigned short port = (unsigned short)master[1].as_integer();
+
+		// empty host means the node which replied
+		if (sHost.empty()
+			|| "?" == sHost)
+			sHost = sReplyHost;
+
+		nStart = (int)v[0].as_integer();
+		nEnd = (int)v[1].as_integer();
+		if (nStart < 0) nStart = 0;
+		if (nEnd >= SLOT_NUM) nEnd = SLOT_NUM - 1;
+
+		uint16_t nodeIdx = (uint16_t)NodeAt(sHost, port);
+		for (s = nStart; s <= nEnd; ++s) {
+			_vSlotNode[s] = nodeIdx;
+		}
+	}
+}
+
+/** -- EOF -- **/
@@ -0,0 +1,168 @@
+//------------------------------------------------------------------------------
+//  KjRedisReplicaPool.cpp
+//  (C) 2016 n.lee
+//------------------------------------------------------------------------------
+#include "KjRedisReplicaPool.hpp"
+
+#include "../RedisRootContextDef.hpp"
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+KjRedisReplicaPool::KjRedisReplicaPool(kj::Own<KjPipeEndpointIoContext> endpointContext, redis_stub_param_t& param, int nPoolSize) {
+	//
+	_vReplica.reserve(param._vReplica.size());
+
+	for (auto& endpoint : param._vReplica) {
+		std::unique_ptr<replica_t> replica(new replica_t);
+		replica->_param = param;
+		replica->_param._ip = endpoint._ip;
+		replica->_param._port = endpoint._port;
+		replica->_param._vReplica.clear();
+
+		// no tracking on replicas, near cache fills only come from the master
+		replica->_param._refNearCache = nullptr;
+		replica->_pool = kj::heap<KjRedisClientConnPool>(kj::addRef(*endpointContext), replica->_param, nPoolSize);
+		_vReplica.emplace_back(std::move(replica));
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+KjRedisReplicaPool::~KjRedisReplicaPool() {
+
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisReplicaPool::Open() {
+	for (auto& replica : _vReplica) {
+		replica->_pool->Open(replica->_param);
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisReplicaPool::Close() {
+	for (auto& replica : _vReplica) {
+		replica->_pool->Close();
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+KjRedisReplicaPool::Send(redis_cmd_pipepline_t& cp) {
+
+	int idx = Select();
+	if (idx < 0)
+		return false;
+
+	replica_t& replica = *_vReplica[idx];
+	++replica._pending;
+
+	// the reply callback runs on this pipe worker thread too
+	auto tmSend = std::chrono::steady_clock::now();
+	replica_t *pReplica = &replica;
+	cp._reply_cb = std::bind([pReplica, tmSend](redis_pipeline_cb_t& reply_cb, CRedisReply&& reply) {
+		OnReply(*pReplica, tmSend);
+
+		if (reply_cb)
+			reply_cb(std::move(reply));
+	}, std::move(cp._reply_cb), std::placeholders::_1);
+
+	replica._pool->Send(cp);
+	replica._bNeedCommit = true;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+KjRedisReplicaPool&
+KjRedisReplicaPool::Commit() {
+
+	for (auto& replica : _vReplica) {
+		if (replica->_bNeedCommit) {
+			replica->_bNeedCommit = false;
+			replica->_pool->Commit();
+		}
+	}
+	return *this;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+int
+KjRedisReplicaPool::Select() {
+
+	int nBest = -1;
+	int64_t nBestScore = 0;
+	int64_t nScore;
+	int i;
+
+	for (i = 0; i < (int)_vReplica.size(); ++i) {
+		replica_t& replica = *_vReplica[i];
+		if (!IsConnected(replica))
+			continue;
+
+		// expected wait: latency of one pipeline times the pipelines ahead of it
+		nScore = (replica._latencyUs + 1) * (replica._pending + 1);
+		if (nBest < 0
+			|| nScore < nBestScore) {
+			nBest = i;
+			nBestScore = nScore;
+		}
+	}
+	return nBest;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+KjRedisReplicaPool::IsConnected(replica_t& replica) {
+
+	size_t i;
+	for (i = 0; i < replica._pool->Size(); ++i) {
+		if (replica._pool->ConnAt(i).IsConnected())
+			return true;
+	}
+	return false;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisReplicaPool::OnReply(replica_t& replica, std::chrono::steady_clock::time_point tmSend) {
+
+	int64_t nUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tmSend).count();
+
+	--replica._pending;
+
+	if (0 == replica._latencyUs) {
+		replica._latencyUs = nUs;
+	}
+	else {
+		replica._latencyUs += (nUs - replica._latencyUs) * LATENCY_SAMPLE_WEIGHT / 8;
+	}
+}
+
+/** -- EOF -- **/
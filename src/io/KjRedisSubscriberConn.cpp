@@ -64,6 +64,25 @@ write_redis_connection_crash_error(const char *err_txt) {
 	fclose(ferr);
 }
 
+static redis_cmd_pipepline_t
+clone_init_pipeline(redis_cmd_pipepline_t& init) {
+	// init pipelines are sent again on every connect, callbacks are move-only so the clone calls back
+	// through the original, which lives as long as the connection
+	redis_cmd_pipepline_t *pInit = &init;
+
+	redis_cmd_pipepline_t cp;
+	cp._sn = init._sn;
+	cp._commands = init._commands;
+	cp._built_num = init._built_num;
+	cp._processed_num = 0;
+	if (init._reply_cb)
+		cp._reply_cb = [pInit](CRedisReply&& reply) { pInit->_reply_cb(std::move(reply)); };
+	if (init._dispose_cb)
+		cp._dispose_cb = [pInit]() { pInit->_dispose_cb(); };
+	cp._state = init._state;
+	return cp;
+}
+
 static uint64_t s_redis_subscriber_connid = 91120000;
 
 //------------------------------------------------------------------------------
@@ -112,7 +131,9 @@ KjRedisSubscriberConn::OnClientConnect(KjRedisTcpConn&, uint64_t connid) {
 	// connection init
 	{
 		std::deque<redis_cmd_pipepline_t> dqTmp;
-		dqTmp.insert(dqTmp.end(), _dqInit.begin(), _dqInit.end());
+		for (auto& init : _dqInit) {
+			dqTmp.emplace_back(clone_init_pipeline(init));
+		}
 
 		for (auto& cp : _dqCommon) {
 			if (cp._sn > 0
@@ -188,6 +209,16 @@ KjRedisSubscriberConn::OnClientReceive(KjRedisTcpConn&, bip_buf_t& bb) {
 					_refWorkCb2(std::move(sPattern), std::move(sChannel), std::move(sMessage));
 				}
 			}
+			else if (v.size() >= 3
+				&& v[0].is_string()
+				&& v[1].is_string()
+				&& (v[2].is_array() || v[2].is_null())) {
+				// tracking invalidation -- ["message", "__redis__:invalidate", [key, ...]], null means flushing all
+				bIsMessage = (v[0].as_string() == "message");
+				if (bIsMessage) {
+					OnInvalidate(v[2]);
+				}
+			}
 			else if (v.size() >= 3
 				&& v[0].is_string()
 				&& v[1].is_string()
@@ -344,6 +375,90 @@ KjRedisSubscriberConn::Init() {
 		sCommands.resize(0);
 		nBuiltNum = 0;
 	}
+
+	// protocol -- pub/sub messages come as push frames, parsed as arrays all the same
+	if (_refParam._nProtocol >= 3) {
+
+		CRedisCommandBuilder::Encode(sCommands, nBuiltNum, "HELLO", 3);
+
+		auto cp = CKjRedisSubscriberWorkQueue::CreateCmdPipeline(
+			0,
+			sCommands,
+			nBuiltNum,
+			nullptr,
+			nullptr);
+
+		//
+		_dqInit.emplace_back(std::move(cp));
+		sCommands.resize(0);
+		nBuiltNum = 0;
+	}
+
+	// near cache -- RESP2 client connections redirect tracking invalidations to us, by our client id
+	CRedisNearCache *nearCache = _refParam._refNearCache;
+	if (nearCache
+		&& _refParam._nProtocol < 3) {
+
+		CRedisCommandBuilder::Encode(sCommands, nBuiltNum, "CLIENT", "ID");
+
+		redis_reply_cb_t func = [nearCache](CRedisReply&& reply) {
+			if (reply.ok()
+				&& reply.is_integer()) {
+				nearCache->SetTrackingRedirectId(reply.as_integer());
+			}
+		};
+
+		auto cp = CKjRedisSubscriberWorkQueue::CreateCmdPipeline(
+			0,
+			sCommands,
+			nBuiltNum,
+			std::move(func),
+			nullptr);
+
+		//
+		_dqInit.emplace_back(std::move(cp));
+		sCommands.resize(0);
+		nBuiltNum = 0;
+
+		// subscribe
+		CRedisCommandBuilder::Encode(sCommands, nBuiltNum, "SUBSCRIBE", "__redis__:invalidate");
+
+		auto cp2 = CKjRedisSubscriberWorkQueue::CreateCmdPipeline(
+			0,
+			sCommands,
+			nBuiltNum,
+			nullptr,
+			nullptr);
+
+		//
+		_dqInit.emplace_back(std::move(cp2));
+		sCommands.resize(0);
+		nBuiltNum = 0;
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisSubscriberConn::OnInvalidate(CRedisReply& keys) {
+
+	CRedisNearCache *nearCache = _refParam._refNearCache;
+	if (!nearCache)
+		return;
+
+	if (keys.is_null()) {
+		// FLUSHALL, FLUSHDB
+		nearCache->InvalidateAll();
+		return;
+	}
+
+	for (auto& key : keys.as_array()) {
+		if (key.is_string()) {
+			nearCache->Invalidate(key.as_string());
+		}
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -422,6 +537,11 @@ KjRedisSubscriberConn::taskFailed(kj::Exception&& exception) {
 	fprintf(stderr, chDesc);
 	write_redis_connection_crash_error(chDesc);
 
+	// invalidations are lost until the redirect is set up again
+	if (_refParam._refNearCache
+		&& _refParam._nProtocol < 3)
+		_refParam._refNearCache->SetTrackingRedirectId(0);
+
 	// schedule eval later to avoid destroying self task set
 	redis_get_servercore()->ScheduleEvalLaterFunc([this]() {
 
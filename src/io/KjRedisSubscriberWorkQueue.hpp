@@ -54,7 +54,7 @@ public:
 		int nSn,
 		const std::string& sCommands,
 		int nBuiltNum,
-		redis_reply_cb_t&& reply_cb,
+		redis_pipeline_cb_t&& reply_cb,
 		dispose_cb_t&& dispose_cb) {
 
 		redis_cmd_pipepline_t cp;
@@ -0,0 +1,192 @@
+//------------------------------------------------------------------------------
+//  KjRedisTimerWheel.cpp
+//  (C) 2016 n.lee
+//------------------------------------------------------------------------------
+#include "KjRedisTimerWheel.hpp"
+
+#include "../RedisRootContextDef.hpp"
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+KjRedisTimerWheel::KjRedisTimerWheel(kj::Own<KjPipeEndpointIoContext> endpointContext, kj::TaskSet& tasks)
+	: _endpointContext(kj::mv(endpointContext))
+	, _refTasks(tasks)
+	, _vSlot(SLOT_NUM) {
+
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+KjRedisTimerWheel::~KjRedisTimerWheel() {
+
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+KjRedisTimerWheel::handle_t
+KjRedisTimerWheel::Add(uint32_t uTimeoutMs, expire_cb_t&& cb) {
+
+	if (!_bTicking) {
+		// idle wheel starts over from now
+		_bTicking = true;
+		_tmLastTick = std::chrono::steady_clock::now();
+		redis_get_servercore()->ScheduleTask(_refTasks, TickLoop());
+	}
+
+	// at least one tick, the current slot is already behind
+	uint32_t uTicks = (uTimeoutMs + TICK_MS - 1) / TICK_MS;
+	if (uTicks < 1)
+		uTicks = 1;
+
+	uint32_t uIdx;
+	if (_vFree.size() > 0) {
+		uIdx = _vFree.back();
+		_vFree.pop_back();
+	}
+	else {
+		uIdx = (uint32_t)_vTimer.size();
+		_vTimer.resize(uIdx + 1);
+	}
+
+	timer_t& t = _vTimer[uIdx];
+	t._rounds = (uTicks - 1) / SLOT_NUM;
+	t._cb = std::move(cb);
+	Insert(uIdx, (_nCursor + uTicks) % SLOT_NUM);
+	++_nTimerNum;
+
+	handle_t h;
+	h._idx = uIdx;
+	h._gen = t._gen;
+	return h;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+KjRedisTimerWheel::Cancel(const handle_t& h) {
+
+	if (h._idx >= _vTimer.size()
+		|| _vTimer[h._idx]._gen != h._gen)
+		return false;
+
+	// swap with the last one of its slot, a timer being expired is in no slot
+	timer_t& t = _vTimer[h._idx];
+	if (t._slot != NO_SLOT) {
+		std::vector<uint32_t>& vSlot = _vSlot[t._slot];
+		uint32_t uLast = vSlot.back();
+		vSlot[t._pos] = uLast;
+		_vTimer[uLast]._pos = t._pos;
+		vSlot.pop_back();
+	}
+
+	Free(h._idx);
+	--_nTimerNum;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisTimerWheel::Insert(uint32_t uIdx, size_t nSlot) {
+
+	timer_t& t = _vTimer[uIdx];
+	t._slot = (uint32_t)nSlot;
+	t._pos = (uint32_t)_vSlot[nSlot].size();
+	_vSlot[nSlot].emplace_back(uIdx);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisTimerWheel::Free(uint32_t uIdx) {
+
+	timer_t& t = _vTimer[uIdx];
+	t._cb = nullptr;
+	t._slot = NO_SLOT;
+	++t._gen;
+	_vFree.emplace_back(uIdx);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+kj::Promise<void>
+KjRedisTimerWheel::TickLoop() {
+
+	return _endpointContext->AfterDelay(TICK_MS * kj::MILLISECONDS)
+		.then([this]() -> kj::Promise<void> {
+
+		Advance();
+
+		if (_nTimerNum > 0)
+			return TickLoop();
+
+		_bTicking = false;
+		return kj::READY_NOW;
+	});
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjRedisTimerWheel::Advance() {
+
+	auto tmNow = std::chrono::steady_clock::now();
+	int64_t nTicks = std::chrono::duration_cast<std::chrono::milliseconds>(tmNow - _tmLastTick).count() / TICK_MS;
+	_tmLastTick += std::chrono::milliseconds(nTicks * TICK_MS);
+
+	while (nTicks-- > 0
+		&& _nTimerNum > 0) {
+
+		_nCursor = (_nCursor + 1) % SLOT_NUM;
+
+		// callbacks may add timers, even into this slot, and cancel the ones after them
+		std::vector<uint32_t>& vSlot = _vSlot[_nCursor];
+		for (auto uIdx : vSlot) {
+			timer_t& t = _vTimer[uIdx];
+			t._slot = NO_SLOT;
+
+			handle_t h;
+			h._idx = uIdx;
+			h._gen = t._gen;
+			_vExpiring.emplace_back(h);
+		}
+		vSlot.clear();
+
+		for (auto& h : _vExpiring) {
+			if (_vTimer[h._idx]._gen != h._gen)
+				continue;
+
+			timer_t& t = _vTimer[h._idx];
+			if (t._rounds > 0) {
+				--t._rounds;
+				Insert(h._idx, _nCursor);
+				continue;
+			}
+
+			// freed ahead of the call, "_vTimer" may grow in it
+			expire_cb_t cb = std::move(t._cb);
+			Free(h._idx);
+			--_nTimerNum;
+			cb();
+		}
+		_vExpiring.clear();
+	}
+}
+
+/** -- EOF -- **/
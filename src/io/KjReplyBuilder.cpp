@@ -5,6 +5,8 @@
 #include "KjReplyBuilder.hpp"
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 #include "base/RedisError.h"
 
 static int
@@ -14,6 +16,77 @@ on_build_reply(redis_reply_t *r, void *payload) {
 	return 0;
 }
 
+static void *
+on_alloc_bulk_string(size_t size, void *payload) {
+	KjReplyBuilder *builder = static_cast<KjReplyBuilder *>(payload);
+	return builder->AllocBulkString(size);
+}
+
+static int
+on_visit_element(redis_reply_t *r, int depth, void *payload) {
+	KjReplyBuilder *builder = static_cast<KjReplyBuilder *>(payload);
+	return builder->VisitElement(r, depth);
+}
+
+static int
+on_sink_bulk_string(redis_reply_t *r, const char *data, size_t len, size_t remain, void *payload) {
+	KjReplyBuilder *builder = static_cast<KjReplyBuilder *>(payload);
+	return builder->SinkBulkString(r, data, len, remain);
+}
+
+static CRedisReply::type
+element_type(uint8_t leading) {
+	switch (leading) {
+	case REDIS_REPLY_LEADING_TYPE_SIMPLE_STRING:
+		return CRedisReply::type::simple_string;
+	case REDIS_REPLY_LEADING_TYPE_ERROR_STRING:
+	case REDIS_REPLY_LEADING_TYPE_BLOB_ERROR:
+		return CRedisReply::type::error;
+	case REDIS_REPLY_LEADING_TYPE_INTEGER:
+		return CRedisReply::type::integer;
+	case REDIS_REPLY_LEADING_TYPE_BULK_STRING:
+		return CRedisReply::type::bulk_string;
+	case REDIS_REPLY_LEADING_TYPE_DOUBLE:
+		return CRedisReply::type::double_number;
+	case REDIS_REPLY_LEADING_TYPE_BOOLEAN:
+		return CRedisReply::type::boolean;
+	case REDIS_REPLY_LEADING_TYPE_BIG_NUMBER:
+		return CRedisReply::type::big_number;
+	case REDIS_REPLY_LEADING_TYPE_VERBATIM_STRING:
+		return CRedisReply::type::verbatim_string;
+	case REDIS_REPLY_LEADING_TYPE_ARRAY:
+		return CRedisReply::type::array;
+	case REDIS_REPLY_LEADING_TYPE_MAP:
+		return CRedisReply::type::map;
+	case REDIS_REPLY_LEADING_TYPE_SET:
+		return CRedisReply::type::set;
+	case REDIS_REPLY_LEADING_TYPE_PUSH:
+		return CRedisReply::type::push;
+	default:
+		return CRedisReply::type::null;
+	}
+}
+
+static bool
+count_flat_nodes(redis_reply_t *r, size_t& szNum) {
+	if (!redis_reply_type_is_aggregate(r->type)
+		|| r->is_null
+		|| !r->arrval)
+		return true;
+
+	int i;
+	for (i = 0; i < r->arrval->nelts; ++i) {
+		redis_reply_t *r2 = (redis_reply_t *)nx_array_at(r->arrval, i);
+		if (REDIS_REPLY_LEADING_TYPE_ATTRIBUTE == r2->type)
+			return false;
+
+		++szNum;
+		if (!count_flat_nodes(r2, szNum))
+			return false;
+	}
+	return true;
+}
+
 //------------------------------------------------------------------------------
 /**
 
@@ -33,6 +106,149 @@ KjReplyBuilder::~KjReplyBuilder() {
 //------------------------------------------------------------------------------
 /**
 
+*/
+void
+KjReplyBuilder::SetViewMode(bool bView) {
+	_bViewMode = bView;
+	set_reply_parser_bulk_alloc(_parser, bView ? on_alloc_bulk_string : nullptr, this);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+char *
+KjReplyBuilder::AllocBulkString(size_t size) {
+	// one slab per reply, created by its first bulk string
+	if (!_slab) {
+		_slab = std::make_shared<CRedisReplySlab>();
+	}
+	return _slab->Alloc(size);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjReplyBuilder::SetStreamProvider(stream_provider_t&& provider) {
+	_streamProvider = std::move(provider);
+	set_reply_parser_element_visitor(_parser, _streamProvider ? on_visit_element : nullptr, this);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+int
+KjReplyBuilder::VisitElement(redis_reply_t *r, int depth) {
+
+	if (0 == depth) {
+		// the reply itself, streamed if its pipeline asks for it
+		_refVisitor = nullptr;
+
+		if (r->is_null
+			|| (REDIS_REPLY_LEADING_TYPE_ARRAY != r->type
+				&& REDIS_REPLY_LEADING_TYPE_MAP != r->type
+				&& REDIS_REPLY_LEADING_TYPE_SET != r->type))
+			return 0;
+
+		_refVisitor = _streamProvider(_nAvailableNum);
+		if (!_refVisitor)
+			return 0;
+
+		_nStreamedNum = r->intval;
+		return 1;
+	}
+
+	if (!(*_refVisitor))
+		return 0;
+
+	redis_reply_element_t elem;
+	elem._depth = depth;
+	elem._type = element_type(r->type);
+	elem._null = (0 != r->is_null);
+	elem._size = 0;
+	elem._integer = 0;
+	elem._view = CRedisReply::string_view_t{ nullptr, 0 };
+
+	if (redis_reply_type_is_aggregate(r->type)) {
+		elem._size = (size_t)r->intval;
+	}
+	else if (REDIS_REPLY_LEADING_TYPE_INTEGER == r->type) {
+		elem._integer = r->intval;
+	}
+	else if (r->vall) {
+		if (!r->vall->next) {
+			// one piece, read in place
+			elem._view = CRedisReply::string_view_t{ (const char *)r->vall->buf->pos, r->bytes };
+		}
+		else {
+			_sElementText = ReplyText(r);
+			elem._view = CRedisReply::string_view_t{ _sElementText.data(), _sElementText.length() };
+		}
+
+		if (REDIS_REPLY_LEADING_TYPE_BOOLEAN == r->type)
+			elem._integer = (elem._view._size > 0 && 't' == elem._view._data[0]) ? 1 : 0;
+	}
+
+	// nothing may unwind through the parser
+	try {
+		(*_refVisitor)(elem);
+	}
+	catch (const std::exception& e) {
+		fprintf(stderr, "[KjReplyBuilder::VisitElement()] visitor exception(%s)!!!\n", e.what());
+	}
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjReplyBuilder::SetSinkProvider(sink_provider_t&& provider) {
+	_sinkProvider = std::move(provider);
+	set_reply_parser_bulk_sink(_parser, _sinkProvider ? on_sink_bulk_string : nullptr, this);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+int
+KjReplyBuilder::SinkBulkString(redis_reply_t *r, const char *data, size_t len, size_t remain) {
+
+	if (!data) {
+		// the reply itself, sunk if its pipeline asks for it
+		_refSink = _sinkProvider(_nAvailableNum);
+		if (!_refSink)
+			return 0;
+
+		_nSunkBytes = (int64_t)remain;
+		if (remain > 0)
+			return 1;
+
+		// empty, no piece is coming: the last one is given here
+		data = "";
+	}
+
+	if (!(*_refSink))
+		return 1;
+
+	// nothing may unwind through the parser
+	try {
+		(*_refSink)(data, len, remain);
+	}
+	catch (const std::exception& e) {
+		fprintf(stderr, "[KjReplyBuilder::SinkBulkString()] sink exception(%s)!!!\n", e.what());
+	}
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+/**
+
 */
 bool
 KjReplyBuilder::BuildReply(bip_buf_t& bb) {
@@ -65,23 +281,13 @@ KjReplyBuilder::SetReply(CRedisReply& reply, redis_reply_t *r) {
 	else {
 		switch (r->type) {
 		case REDIS_REPLY_LEADING_TYPE_SIMPLE_STRING: {
-			std::string str;
-			size_t len;
-			
-			if (r->bytes > 0)
-			str.resize(r->bytes);
-			redis_reply_as_string(r, (char *)str.c_str(), &len);
-			reply.set(std::move(str), CRedisReply::string_type::simple_string);
+			reply.set(ReplyText(r), CRedisReply::string_type::simple_string);
 			break;
 		}
 
-		case REDIS_REPLY_LEADING_TYPE_ERROR_STRING: {
-			std::string str;
-			size_t len;
-
-			str.resize(r->bytes);
-			redis_reply_as_string(r, (char *)str.c_str(), &len);
-			reply.set(std::move(str), CRedisReply::string_type::error);
+		case REDIS_REPLY_LEADING_TYPE_ERROR_STRING:
+		case REDIS_REPLY_LEADING_TYPE_BLOB_ERROR: {
+			reply.set(ReplyText(r), CRedisReply::string_type::error);
 			break;
 		}
 
@@ -91,17 +297,55 @@ KjReplyBuilder::SetReply(CRedisReply& reply, redis_reply_t *r) {
 		}
 
 		case REDIS_REPLY_LEADING_TYPE_BULK_STRING: {
-			std::string str;
-			size_t len;
+			if (_bViewMode && r->vall) {
+				// bytes are already in the slab
+				reply.set_view((const char *)r->vall->buf->pos, r->bytes, CRedisReply::string_type::bulk_string, _slab);
+				break;
+			}
+
+			reply.set(ReplyText(r), CRedisReply::string_type::bulk_string);
+			break;
+		}
+
+		case REDIS_REPLY_LEADING_TYPE_DOUBLE: {
+			// "inf", "-inf" and "nan" are understood by strtod() too
+			std::string str = ReplyText(r);
+			double d = strtod(str.c_str(), nullptr);
+			reply.set_double(d, std::move(str));
+			break;
+		}
 
-			str.resize(r->bytes);
-			redis_reply_as_string(r, (char *)str.c_str(), &len);
-			reply.set(std::move(str), CRedisReply::string_type::bulk_string);
+		case REDIS_REPLY_LEADING_TYPE_BOOLEAN: {
+			std::string str = ReplyText(r);
+			reply.set_boolean(str.length() > 0 && 't' == str[0]);
 			break;
 		}
 
-		case REDIS_REPLY_LEADING_TYPE_ARRAY: {
-			SetArrayReply(reply, r->elemtype, r->arrval);
+		case REDIS_REPLY_LEADING_TYPE_BIG_NUMBER: {
+			reply.set(ReplyText(r), CRedisReply::string_type::big_number);
+			break;
+		}
+
+		case REDIS_REPLY_LEADING_TYPE_VERBATIM_STRING: {
+			// "xxx:" ahead of the text is the format
+			std::string str = ReplyText(r);
+			char chFormat[4] = { 0 };
+			if (str.length() >= 4
+				&& ':' == str[3]) {
+				memcpy(chFormat, str.c_str(), 3);
+				str.erase(0, 4);
+			}
+			reply.set(std::move(str), CRedisReply::string_type::verbatim_string);
+			reply.set_verbatim_format(chFormat);
+			break;
+		}
+
+		case REDIS_REPLY_LEADING_TYPE_ARRAY:
+		case REDIS_REPLY_LEADING_TYPE_MAP:
+		case REDIS_REPLY_LEADING_TYPE_SET:
+		case REDIS_REPLY_LEADING_TYPE_ATTRIBUTE:
+		case REDIS_REPLY_LEADING_TYPE_PUSH: {
+			SetArrayReply(reply, r->type, r->arrval);
 			break;
 		}
 
@@ -122,6 +366,7 @@ KjReplyBuilder::SetReply(CRedisReply& reply, redis_reply_t *r) {
 void
 KjReplyBuilder::SetArrayReply(CRedisReply& reply, uint8_t arrtype, nx_array_t *arrval) {
 	std::vector<CRedisReply> vReply;
+	std::vector<CRedisReply> vAttrs;
 
 	if (arrval && arrval->nelts > 0) {
 		redis_reply_t *r;
@@ -133,12 +378,210 @@ KjReplyBuilder::SetArrayReply(CRedisReply& reply, uint8_t arrtype, nx_array_t *a
 			CRedisReply reply2;
 			r = (redis_reply_t *)nx_array_at(arrval, i);
 			SetReply(reply2, r);
-			vReply.emplace_back(reply2);
+
+			if (REDIS_REPLY_LEADING_TYPE_ATTRIBUTE == r->type) {
+				// attribute goes with the next element
+				vAttrs = std::move(reply2.as_array());
+				continue;
+			}
+
+			if (vAttrs.size() > 0) {
+				reply2.set_attributes(std::move(vAttrs));
+				vAttrs.clear();
+			}
+			vReply.emplace_back(std::move(reply2));
 		}
 	}
 
 	//
-	reply.set(std::move(vReply));
+	switch (arrtype) {
+	case REDIS_REPLY_LEADING_TYPE_MAP:
+		reply.set_aggregate(std::move(vReply), CRedisReply::type::map);
+		break;
+
+	case REDIS_REPLY_LEADING_TYPE_SET:
+		reply.set_aggregate(std::move(vReply), CRedisReply::type::set);
+		break;
+
+	case REDIS_REPLY_LEADING_TYPE_PUSH:
+		reply.set_aggregate(std::move(vReply), CRedisReply::type::push);
+		break;
+
+	default:
+		// attribute is kept as flattened array until it is attached
+		reply.set(std::move(vReply));
+		break;
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+bool
+KjReplyBuilder::SetFlatReply(CRedisReply& reply, redis_reply_t *r) {
+
+	// null aggregate is an empty array, as SetArrayReply() makes it
+	size_t szNum = 1;
+	if (r->is_null
+		|| !count_flat_nodes(r, szNum))
+		return false;
+
+	// strings which are not in the slab yet are copied into it
+	if (!_slab) {
+		_slab = std::make_shared<CRedisReplySlab>();
+	}
+
+	auto flat = std::make_shared<CRedisFlatReply>(_slab);
+	flat->Reserve(szNum);
+	flat->AddNodes(1);
+	FlattenReply(*flat, 0, r);
+
+	reply.set_flat(flat, 0);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjReplyBuilder::FlattenReply(CRedisFlatReply& flat, uint32_t idx, redis_reply_t *r) {
+
+	if (r->is_null)
+		return;
+
+	switch (r->type) {
+	case REDIS_REPLY_LEADING_TYPE_SIMPLE_STRING: {
+		FlattenText(flat, idx, r);
+		flat.NodeAt(idx)._type = (uint8_t)CRedisReply::type::simple_string;
+		break;
+	}
+
+	case REDIS_REPLY_LEADING_TYPE_ERROR_STRING:
+	case REDIS_REPLY_LEADING_TYPE_BLOB_ERROR: {
+		FlattenText(flat, idx, r);
+		flat.NodeAt(idx)._type = (uint8_t)CRedisReply::type::error;
+		break;
+	}
+
+	case REDIS_REPLY_LEADING_TYPE_INTEGER: {
+		CRedisFlatReply::node_t& node = flat.NodeAt(idx);
+		node._type = (uint8_t)CRedisReply::type::integer;
+		node._intval = r->intval;
+		break;
+	}
+
+	case REDIS_REPLY_LEADING_TYPE_BULK_STRING: {
+		if (_bViewMode && r->vall) {
+			// bytes are already in the slab
+			CRedisFlatReply::node_t& node = flat.NodeAt(idx);
+			node._data = (const char *)r->vall->buf->pos;
+			node._size = (uint32_t)r->bytes;
+		}
+		else {
+			FlattenText(flat, idx, r);
+		}
+		flat.NodeAt(idx)._type = (uint8_t)CRedisReply::type::bulk_string;
+		break;
+	}
+
+	case REDIS_REPLY_LEADING_TYPE_DOUBLE: {
+		// text only, CRedisReplyElement::as_double() parses it
+		FlattenText(flat, idx, r);
+		flat.NodeAt(idx)._type = (uint8_t)CRedisReply::type::double_number;
+		break;
+	}
+
+	case REDIS_REPLY_LEADING_TYPE_BOOLEAN: {
+		CRedisFlatReply::node_t& node = flat.NodeAt(idx);
+		node._type = (uint8_t)CRedisReply::type::boolean;
+		node._intval = (r->bytes > 0 && r->vall && 't' == *r->vall->buf->pos) ? 1 : 0;
+		break;
+	}
+
+	case REDIS_REPLY_LEADING_TYPE_BIG_NUMBER: {
+		FlattenText(flat, idx, r);
+		flat.NodeAt(idx)._type = (uint8_t)CRedisReply::type::big_number;
+		break;
+	}
+
+	case REDIS_REPLY_LEADING_TYPE_VERBATIM_STRING: {
+		// "xxx:" is kept, see CRedisReplyElement::as_view()
+		FlattenText(flat, idx, r);
+		flat.NodeAt(idx)._type = (uint8_t)CRedisReply::type::verbatim_string;
+		break;
+	}
+
+	case REDIS_REPLY_LEADING_TYPE_ARRAY:
+	case REDIS_REPLY_LEADING_TYPE_MAP:
+	case REDIS_REPLY_LEADING_TYPE_SET:
+	case REDIS_REPLY_LEADING_TYPE_PUSH: {
+		CRedisReply::type t = CRedisReply::type::array;
+		if (REDIS_REPLY_LEADING_TYPE_MAP == r->type)
+			t = CRedisReply::type::map;
+		else if (REDIS_REPLY_LEADING_TYPE_SET == r->type)
+			t = CRedisReply::type::set;
+		else if (REDIS_REPLY_LEADING_TYPE_PUSH == r->type)
+			t = CRedisReply::type::push;
+
+		// elements side by side, nested aggregates put theirs behind -- nodes are addressed by index,
+		// references don't survive AddNodes()
+		uint32_t uNum = (r->arrval) ? (uint32_t)r->arrval->nelts : 0;
+		uint32_t uFirst = flat.AddNodes(uNum);
+
+		CRedisFlatReply::node_t& node = flat.NodeAt(idx);
+		node._type = (uint8_t)t;
+		node._size = uNum;
+		node._first = uFirst;
+
+		uint32_t i;
+		for (i = 0; i < uNum; ++i) {
+			FlattenReply(flat, uFirst + i, (redis_reply_t *)nx_array_at(r->arrval, i));
+		}
+		break;
+	}
+
+	default:
+		std::string sDesc = "\n\n\n[KjReplyBuilder::FlattenReply()] type is invalid -- ";
+		sDesc += std::to_string(r->type);
+		sDesc += " !!!\n";
+		fprintf(stderr, sDesc.c_str());
+		throw CRedisError(sDesc.c_str());
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+KjReplyBuilder::FlattenText(CRedisFlatReply& flat, uint32_t idx, redis_reply_t *r) {
+	CRedisFlatReply::node_t& node = flat.NodeAt(idx);
+	size_t len = 0;
+
+	if (r->bytes > 0) {
+		char *p = flat.Alloc(r->bytes);
+		redis_reply_as_string(r, p, &len);
+		node._data = p;
+	}
+	node._size = (uint32_t)len;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+std::string
+KjReplyBuilder::ReplyText(redis_reply_t *r) {
+	std::string str;
+	size_t len;
+
+	if (r->bytes > 0) {
+		str.resize(r->bytes);
+		redis_reply_as_string(r, (char *)str.c_str(), &len);
+	}
+	return str;
 }
 
 //------------------------------------------------------------------------------
@@ -149,19 +592,48 @@ void
 KjReplyBuilder::PushReply(redis_reply_t *r) {
 	CRedisReply reply;
 
+	if (_refVisitor
+		|| _refSink) {
+		// streamed or sunk, the elements or bytes are gone
+		reply.set(_refVisitor ? _nStreamedNum : _nSunkBytes);
+		_refVisitor = nullptr;
+		_refSink = nullptr;
+		++_nAvailableNum;
+		_available_replies.emplace_back(std::move(reply));
+		_slab.reset();
+		return;
+	}
+
 	switch (r->type) {
 	case REDIS_REPLY_LEADING_TYPE_SIMPLE_STRING:
 	case REDIS_REPLY_LEADING_TYPE_ERROR_STRING:
 	case REDIS_REPLY_LEADING_TYPE_INTEGER:
 	case REDIS_REPLY_LEADING_TYPE_BULK_STRING:
+	case REDIS_REPLY_LEADING_TYPE_NULL:
+	case REDIS_REPLY_LEADING_TYPE_DOUBLE:
+	case REDIS_REPLY_LEADING_TYPE_BOOLEAN:
+	case REDIS_REPLY_LEADING_TYPE_BIG_NUMBER:
+	case REDIS_REPLY_LEADING_TYPE_BLOB_ERROR:
+	case REDIS_REPLY_LEADING_TYPE_VERBATIM_STRING:
 		SetReply(reply, r);
 		break;
 
-	case REDIS_REPLY_LEADING_TYPE_ARRAY: {
-		SetArrayReply(reply, r->elemtype, r->arrval);
+	case REDIS_REPLY_LEADING_TYPE_ARRAY:
+	case REDIS_REPLY_LEADING_TYPE_MAP:
+	case REDIS_REPLY_LEADING_TYPE_SET:
+	case REDIS_REPLY_LEADING_TYPE_PUSH: {
+		if (!SetFlatReply(reply, r))
+			SetArrayReply(reply, r->type, r->arrval);
 		break;
 	}
 
+	case REDIS_REPLY_LEADING_TYPE_ATTRIBUTE: {
+		// not a reply by itself, its strings stay in the slab of the coming reply
+		SetArrayReply(reply, r->type, r->arrval);
+		_vPendingAttrs = std::move(reply.as_array());
+		return;
+	}
+
 	default:
 		std::string sError = "Invalid leading type -- ";
 		sError.append(std::to_string(r->type));
@@ -170,7 +642,17 @@ KjReplyBuilder::PushReply(redis_reply_t *r) {
 		break;
 	}
 
+	if (_vPendingAttrs.size() > 0) {
+		reply.set_attributes(std::move(_vPendingAttrs));
+		_vPendingAttrs.clear();
+	}
+
+	if (!reply.is_push())
+		++_nAvailableNum;
 	_available_replies.emplace_back(std::move(reply));
+
+	// the slab is owned by the reply now
+	_slab.reset();
 }
 
 //------------------------------------------------------------------------------
@@ -183,5 +665,8 @@ KjReplyBuilder::PopReply() {
 	CRedisReply& r = _available_replies.front();
 	CRedisReply reply = std::move(r);
 	_available_replies.pop_front();
+
+	if (!reply.is_push())
+		--_nAvailableNum;
 	return reply;
 }
\ No newline at end of file
@@ -25,6 +25,7 @@ extern "C" {
 #endif 
 
 #include "base/RedisReply.h"
+#include "base/RedisFlatReply.h"
 
 class KjReplyBuilder {
 public:
@@ -59,8 +60,32 @@ public:
 	void Reset() {
 		reset_reply_parser(_parser);
 		_available_replies.clear();
+		_slab.reset();
+		_vPendingAttrs.clear();
+		_nAvailableNum = 0;
+		_refVisitor = nullptr;
+		_refSink = nullptr;
 	}
 
+	//! bulk strings are parsed into a slab shared by the reply, see CRedisReply::as_view()
+	void SetViewMode(bool bView);
+
+	char * AllocBulkString(size_t size);
+
+	//! streaming: "provider" returns the visitor of the n-th reply after the ones available (push frames not
+	//! counted), nullptr means it is built as usual. A streamed reply comes out as its element num
+	using stream_provider_t = CRedisCallback<const redis_element_cb_t *(size_t nth)>;
+	void SetStreamProvider(stream_provider_t&& provider);
+
+	int VisitElement(redis_reply_t *r, int depth);
+
+	//! sinking: "provider" returns the sink of the n-th reply after the ones available, as above. A top level
+	//! bulk string goes to it piece by piece and comes out as its length
+	using sink_provider_t = CRedisCallback<const redis_bulk_chunk_cb_t *(size_t nth)>;
+	void SetSinkProvider(sink_provider_t&& provider);
+
+	int SinkBulkString(redis_reply_t *r, const char *data, size_t len, size_t remain);
+
 private:
 	//! build reply. Return whether the reply has been fully built or not
 	bool BuildReply(bip_buf_t& bb);
@@ -68,6 +93,14 @@ private:
 	void SetReply(CRedisReply& reply, redis_reply_t *r);
 	void SetArrayReply(CRedisReply& reply, uint8_t arrtype, nx_array_t *arrval);
 
+	//! aggregate into one CRedisFlatReply, no CRedisReply per element. False when it carries
+	//! attributes inside, those go through SetArrayReply()
+	bool SetFlatReply(CRedisReply& reply, redis_reply_t *r);
+	void FlattenReply(CRedisFlatReply& flat, uint32_t idx, redis_reply_t *r);
+	void FlattenText(CRedisFlatReply& flat, uint32_t idx, redis_reply_t *r);
+
+	std::string ReplyText(redis_reply_t *r);
+
 public:
 	void PushReply(redis_reply_t *r);
 	CRedisReply PopReply();
@@ -76,6 +109,24 @@ private:
 	redis_reply_parser_t *_parser;
 
 	std::deque<CRedisReply> _available_replies;
+
+	bool _bViewMode = false;
+	redis_reply_slab_ptr_t _slab;
+
+	//! RESP3 attribute ahead of the coming reply
+	std::vector<CRedisReply> _vPendingAttrs;
+
+	//! available replies which are not push frames
+	size_t _nAvailableNum = 0;
+
+	stream_provider_t _streamProvider;
+	const redis_element_cb_t *_refVisitor = nullptr;
+	int64_t _nStreamedNum = 0;
+	std::string _sElementText;
+
+	sink_provider_t _sinkProvider;
+	const redis_bulk_chunk_cb_t *_refSink = nullptr;
+	int64_t _nSunkBytes = 0;
 };
 
 /* EOF */
\ No newline at end of file
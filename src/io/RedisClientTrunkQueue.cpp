@@ -30,16 +30,18 @@ CRedisClientTrunkQueue::~CRedisClientTrunkQueue() {
 
 */
 void
-CRedisClientTrunkQueue::Add(std::function<void()>&& workCb) {
+CRedisClientTrunkQueue::Add(CCamelReaderWriterQueue::CallbackEntry&& workCb) {
 
 	_callbacks->Add(std::move(workCb));
 
- 	// write opcode to pipe
- 	++_refRedisHandle->_trunkOpCodeSend;
+	// write opcode to pipe -- unless one is already waiting to be read
+	if (!_signal.Raise())
+		return;
 
-	kj::AsyncIoStream& pipeEndPoint = _refRedisHandle->_refPipeWorker->endpointContext->GetEndpoint();
-	pipeEndPoint.write((const void *)&_refRedisHandle->_trunkOpCodeSend, 1);
-	redis_get_servercore()->PipeNotify(pipeEndPoint, _refRedisHandle->_trunkOpCodeSend);
+ 	++_opCodeSend;
+
+	kj::AsyncIoStream& pipeEndPoint = _refPipeWorker->endpointContext->GetEndpoint();
+	redis_get_servercore()->PipeNotify(pipeEndPoint, _opCodeSend);
 }
 
 //------------------------------------------------------------------------------
@@ -49,11 +51,65 @@ CRedisClientTrunkQueue::Add(std::function<void()>&& workCb) {
 void
 CRedisClientTrunkQueue::Add(redis_reply_cb_t&& cb, CRedisReply&& r) {
 
-	auto workCb = std::bind([](redis_reply_cb_t& on_got_reply, CRedisReply& reply) {
-  		on_got_reply(std::move(reply));
-  	}, std::move(cb), std::move(r));
+	if (!_openBatch) {
+		if (!_recycledBatches.try_dequeue(_openBatch)) {
+			_vBatch.emplace_back(new reply_batch_t);
+			_openBatch = _vBatch.back().get();
+		}
+
+		// after the current turn, when every reply of the read is in
+		redis_get_servercore()->ScheduleEvalLaterFunc([this]() {
+			FlushBatch();
+		});
+	}
+
+	_openBatch->emplace_back();
+	reply_item_t& item = _openBatch->back();
+	item._cb = std::move(cb);
+	item._reply = std::move(r);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisClientTrunkQueue::FlushBatch() {
+
+	reply_batch_t *batch = _openBatch;
+	_openBatch = nullptr;
+
+	if (batch) {
+		Add([this, batch]() {
+			RunBatch(batch);
+		});
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisClientTrunkQueue::RunBatch(reply_batch_t *batch) {
+
+	// the position is kept before each call, a throwing callback leaves the rest of the batch to RunOnce()
+	_runningBatch = batch;
+	while (_nRunningIdx < batch->size()) {
+		reply_item_t& item = (*batch)[_nRunningIdx++];
+		item._cb(std::move(item._reply));
+	}
+
+	// finished and given back already by a RunOnce() nested in a callback
+	if (_runningBatch != batch)
+		return;
+
+	_runningBatch = nullptr;
+	_nRunningIdx = 0;
 
- 	Add(std::move(workCb));
+	// capacity is kept for the next round
+	batch->clear();
+	_recycledBatches.enqueue(batch);
 }
 
 /* -- EOF -- */
\ No newline at end of file
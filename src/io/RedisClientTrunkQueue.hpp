@@ -5,16 +5,25 @@
 
 	(C) 2016 n.lee
 */
+#include <vector>
+#include <memory>
+
 #include "base/CamelReaderWriterQueue.h"
 #include "base/IRedisService.h"
 
 #include "KjRedisClientWorkQueue.hpp"
+#include "KjRedisWakeupSignal.hpp"
 
 class CRedisClient;
 
 //------------------------------------------------------------------------------
 /**
 @brief CRedisClientTrunkQueue
+
+//!
+//! replies completed by the pipe worker in one event loop turn -- all of one read -- are handed
+//! to RunOnce() as one batch, with one opcode. Batches are recycled, their storage is kept
+//!
 */
 class CRedisClientTrunkQueue {
 public:
@@ -22,6 +31,12 @@ public:
 	~CRedisClientTrunkQueue();
 
 	void RunOnce() {
+		_signal.Clear();
+
+		// a batch cut short by a throwing callback goes on first
+		if (_runningBatch)
+			RunBatch(_runningBatch);
+
 		_callbacks->RunOnce();
 	}
 
@@ -29,16 +44,52 @@ public:
 		_callbacks->Close();
 	}
 
-	void Add(std::function<void()>&& workCb);
+	void Add(CCamelReaderWriterQueue::CallbackEntry&& workCb);
 
+	//! pipe worker thread only
 	void Add(redis_reply_cb_t&&, CRedisReply&&);
 
+private:
+	struct reply_item_t {
+		redis_reply_cb_t _cb;
+		CRedisReply _reply;
+	};
+	using reply_batch_t = std::vector<reply_item_t>;
+
+	//! pipe worker: hand over the open batch, scheduled by the first reply of it
+	void FlushBatch();
+
+	//! main thread: run the callbacks and give the batch back. An exception of a callback goes to the
+	//! caller of RunOnce() as it did before batching, the replies behind it are kept for the next RunOnce()
+	void RunBatch(reply_batch_t *batch);
+
 private:
 	CCamelReaderWriterQueuePtr _callbacks;
 
+	//! batch being filled by the pipe worker
+	reply_batch_t *_openBatch = nullptr;
+
+	//! main thread: batch being run and its next item
+	reply_batch_t *_runningBatch = nullptr;
+	size_t _nRunningIdx = 0;
+
+	//! run batches on their way back to the pipe worker
+	moodycamel::ReaderWriterQueue<reply_batch_t *> _recycledBatches;
+
+	//! every batch ever created, only the pipe worker appends
+	std::vector<std::unique_ptr<reply_batch_t>> _vBatch;
+
+	//! replies added before RunOnce() share one opcode
+	KjRedisWakeupSignal _signal;
+
 public:
 	CRedisClient *_refRedisHandle;
 
+	//! threads
+	svrcore_pipeworker_t *_refPipeWorker = nullptr;
+	char _opCodeSend = 0;
+	char _opCodeRecvBuf[1024];
+
 };
 using CRedisClientTrunkQueuePtr = std::shared_ptr<CRedisClientTrunkQueue>;
 
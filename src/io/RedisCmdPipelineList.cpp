@@ -0,0 +1,123 @@
+//------------------------------------------------------------------------------
+//  RedisCmdPipelineList.cpp
+//  (C) 2016 n.lee
+//------------------------------------------------------------------------------
+#include "RedisCmdPipelineList.hpp"
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+CRedisCmdPipelineList::~CRedisCmdPipelineList() {
+	node_t *node, *next;
+
+	for (node = _head; node; node = next) {
+		next = node->_next;
+		delete node;
+	}
+
+	for (node = _free; node; node = next) {
+		next = node->_next;
+		delete node;
+	}
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+CRedisCmdPipelineList::iterator
+CRedisCmdPipelineList::emplace(iterator pos, redis_cmd_pipepline_t&& cp) {
+
+	node_t *node = AllocNode();
+	node->_cp = std::move(cp);
+
+	node_t *next = pos._node;
+	node_t *prev = next ? next->_prev : _tail;
+
+	node->_prev = prev;
+	node->_next = next;
+
+	if (prev)
+		prev->_next = node;
+	else
+		_head = node;
+
+	if (next)
+		next->_prev = node;
+	else
+		_tail = node;
+
+	++_size;
+	return iterator(node);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+CRedisCmdPipelineList::iterator
+CRedisCmdPipelineList::erase(iterator pos) {
+
+	node_t *node = pos._node;
+	node_t *next = node->_next;
+
+	if (node->_prev)
+		node->_prev->_next = next;
+	else
+		_head = next;
+
+	if (next)
+		next->_prev = node->_prev;
+	else
+		_tail = node->_prev;
+
+	--_size;
+	FreeNode(node);
+	return iterator(next);
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+CRedisCmdPipelineList::node_t *
+CRedisCmdPipelineList::AllocNode() {
+
+	if (_free) {
+		node_t *node = _free;
+		_free = node->_next;
+		--_freeNum;
+		return node;
+	}
+	return new node_t;
+}
+
+//------------------------------------------------------------------------------
+/**
+
+*/
+void
+CRedisCmdPipelineList::FreeNode(node_t *node) {
+
+	redis_cmd_pipepline_t& cp = node->_cp;
+
+	if (_recycleCb)
+		_recycleCb(cp);
+
+	// a buffer nobody took is released here, not kept by an idle node
+	std::string().swap(cp._commands);
+	cp._reply_cb = nullptr;
+	cp._dispose_cb = nullptr;
+	cp._deadline.reset();
+	cp._element_cb = nullptr;
+	cp._chunk_cb = nullptr;
+	cp._segment_cb = nullptr;
+
+	node->_prev = nullptr;
+	node->_next = _free;
+	_free = node;
+	++_freeNum;
+}
+
+/** -- EOF -- **/
@@ -0,0 +1,135 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+	@class CRedisCmdPipelineList
+
+	(C) 2016 n.lee
+*/
+#include <iterator>
+
+#include "base/RedisReply.h"
+
+//------------------------------------------------------------------------------
+/**
+	@brief CRedisCmdPipelineList
+
+//!
+//! cmd pipelines of one connection, in order: a linked list of pooled nodes. Nodes of finished
+//! pipelines go to a free list and are reused, so the steady state allocates nothing. The deque
+//! subset the connection uses is kept, with the same names
+//!
+*/
+class CRedisCmdPipelineList {
+public:
+	CRedisCmdPipelineList() = default;
+	~CRedisCmdPipelineList();
+
+	CRedisCmdPipelineList(const CRedisCmdPipelineList&) = delete;
+	CRedisCmdPipelineList& operator=(const CRedisCmdPipelineList&) = delete;
+
+	struct node_t {
+		redis_cmd_pipepline_t _cp;
+		node_t *_prev = nullptr;
+		node_t *_next = nullptr;
+	};
+
+	class iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = redis_cmd_pipepline_t;
+		using difference_type = ptrdiff_t;
+		using pointer = redis_cmd_pipepline_t *;
+		using reference = redis_cmd_pipepline_t&;
+
+		iterator(node_t *node = nullptr) : _node(node) {}
+
+		redis_cmd_pipepline_t& operator*() const {
+			return _node->_cp;
+		}
+
+		redis_cmd_pipepline_t *operator->() const {
+			return &_node->_cp;
+		}
+
+		iterator& operator++() {
+			_node = _node->_next;
+			return *this;
+		}
+
+		bool operator==(const iterator& other) const {
+			return _node == other._node;
+		}
+
+		bool operator!=(const iterator& other) const {
+			return _node != other._node;
+		}
+
+	private:
+		friend class CRedisCmdPipelineList;
+		node_t *_node;
+	};
+
+	//! called with every pipeline leaving the list, before its node is reset -- e.g. to hand the
+	//! command buffer back to the thread which built it
+	using recycle_cb_t = CRedisCallback<void(redis_cmd_pipepline_t&)>;
+
+	void SetRecycleCb(recycle_cb_t&& cb) {
+		_recycleCb = std::move(cb);
+	}
+
+public:
+	iterator begin() {
+		return iterator(_head);
+	}
+
+	iterator end() {
+		return iterator(nullptr);
+	}
+
+	size_t size() const {
+		return _size;
+	}
+
+	bool empty() const {
+		return 0 == _size;
+	}
+
+	redis_cmd_pipepline_t& front() {
+		return _head->_cp;
+	}
+
+	void emplace_back(redis_cmd_pipepline_t&& cp) {
+		emplace(end(), std::move(cp));
+	}
+
+	//! insert ahead of "pos", returns the new one
+	iterator emplace(iterator pos, redis_cmd_pipepline_t&& cp);
+
+	void pop_front() {
+		erase(begin());
+	}
+
+	//! returns the next one
+	iterator erase(iterator pos);
+
+	//! nodes kept for reuse
+	size_t FreeSize() const {
+		return _freeNum;
+	}
+
+private:
+	node_t *AllocNode();
+	void FreeNode(node_t *node);
+
+private:
+	node_t *_head = nullptr;
+	node_t *_tail = nullptr;
+	size_t _size = 0;
+
+	node_t *_free = nullptr;
+	size_t _freeNum = 0;
+
+	recycle_cb_t _recycleCb;
+};
+
+/*EOF*/
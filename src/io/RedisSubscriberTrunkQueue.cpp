@@ -30,7 +30,7 @@ CRedisSubscriberTrunkQueue::~CRedisSubscriberTrunkQueue() {
 
 */
 void
-CRedisSubscriberTrunkQueue::Add(std::function<void()>&& workCb) {
+CRedisSubscriberTrunkQueue::Add(CCamelReaderWriterQueue::CallbackEntry&& workCb) {
 
 	_callbacks->Add(std::move(workCb));
 